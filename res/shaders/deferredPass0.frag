@@ -8,11 +8,8 @@ layout (location = 0) out vec4 diffuseColor;
 layout (location = 1) out vec3 positions;
 layout (location = 2) out vec3 normals;
 
-uniform struct ProjectorData{
-	vec3 position;
-	vec3 direction;
-	sampler2D texture;
-} projectorData;
+// FrameData comes from frameData.glsl
+uniform sampler2D projectorTexture;
 
 void main()
 {
@@ -21,15 +18,15 @@ void main()
   normals	= vec3(normalToFrag.xyz);
 
 
-	vec3 pv = normalize(positionToFrag.xyz - projectorData.position);	
-	float dist = length(positionToFrag.xyz - projectorData.position);	
-	vec3 d = normalize(projectorData.direction);
+	vec3 pv = normalize(positionToFrag.xyz - frame.surfaceProjector.position.xyz);	
+	float dist = length(positionToFrag.xyz - frame.surfaceProjector.position.xyz);	
+	vec3 d = normalize(frame.surfaceProjector.direction.xyz);
 
 	if((dot(pv, d)) > abs(cos(10 * 0.0174533)))
 	{
 		vec2 st = vec2(0.5, 100 * dot(pv, d));
 		
-		diffuseColor = texture2D(projectorData.texture, st);
+		diffuseColor = texture2D(projectorTexture, st);
     
     if(length(diffuseColor) < 0.2)
     {
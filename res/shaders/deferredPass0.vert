@@ -4,19 +4,26 @@ layout (location = 0) in vec3 position;
 layout (location = 1) in vec3 normal;
 layout (location = 2) in vec2 texCoords0;
 
-uniform vec3 color;
-uniform mat4 projectionMatrix;
-uniform mat4 modelViewMatrix;
-uniform mat4 modelMatrix;
+// FrameData comes from frameData.glsl
+// per-object constants, bound from the renderer's uniform ring buffer (SceneObject::Constants)
+layout (std140) uniform ObjectData
+{
+  mat4 modelViewMatrix;
+  mat4 modelMatrix;
+  vec4 color;
+};
 
 out vec3 vertexColorToFrag;
 out vec4 positionToFrag;
 out vec3 normalToFrag;
 
+// the depth pre-pass (depthPrePass.vert) has to produce the very same depth
+invariant gl_Position;
+
 void main()
 {  
-  vertexColorToFrag = color / 255.0;
+  vertexColorToFrag = color.rgb / 255.0;
   positionToFrag = modelMatrix * vec4(position, 1.0);  
   normalToFrag = normal;
-  gl_Position = projectionMatrix * modelViewMatrix * vec4(position, 1.0);
+  gl_Position = frame.projectionMatrix * modelViewMatrix * vec4(position, 1.0);
 }
\ No newline at end of file
@@ -0,0 +1,37 @@
+#version 430 core
+
+// deferredPass0.vert for glMultiDrawElementsIndirect: one draw can't rebind the ObjectData block per object
+
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec3 normal;
+layout (location = 3) in uint drawId;   // per instance attribute, offset by the command's baseInstance
+
+// FrameData comes from frameData.glsl
+struct ObjectData
+{
+  mat4 modelViewMatrix;
+  mat4 modelMatrix;
+  vec4 color;
+};
+
+// every object's constants for the frame (SceneObject::Constants), picked by drawId
+layout (std430) readonly buffer ObjectDataArray
+{
+  ObjectData objects[];
+};
+
+out vec3 vertexColorToFrag;
+out vec4 positionToFrag;
+out vec3 normalToFrag;
+
+// the depth pre-pass (depthPrePassIndirect.vert) has to produce the very same depth
+invariant gl_Position;
+
+void main()
+{
+  ObjectData object = objects[drawId];
+  vertexColorToFrag = object.color.rgb / 255.0;
+  positionToFrag = object.modelMatrix * vec4(position, 1.0);
+  normalToFrag = normal;
+  gl_Position = frame.projectionMatrix * object.modelViewMatrix * vec4(position, 1.0);
+}
\ No newline at end of file
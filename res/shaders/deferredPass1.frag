@@ -5,36 +5,36 @@ uniform sampler2D _position;
 uniform sampler2D _normals;
 
 
-uniform vec3 cameraPosition;
-uniform vec3 lightPosition;
-
 const int numLights = 3;
-uniform vec3 lights[numLights];
-uniform vec3 lightColors[numLights];
+
+// DeferredRenderer::LightConstants
+layout (std140) uniform LightData
+{
+  vec4 positions[numLights];
+  vec4 colors[numLights];
+} lighting;
 
 
 layout (location = 0) out vec4 color;
 
 in vec2 texCoords0ToFrag;
 
-uniform struct ProjectorData{
-	vec3 position;
-	vec3 direction;
-	sampler2D texture;
-} projectorData;
+// FrameData comes from frameData.glsl
+uniform sampler2D projectorTexture;
 
 
 vec4 computeLightColor(int i, vec4 diffuseColor, vec4 position, vec3 normal)
 {
-	vec3 lightColor = lightColors[i];
+	vec3 lightColor = lighting.colors[i].rgb;
+	vec3 lightPosition = lighting.positions[i].xyz;
 
 	// normalize the incoming n, l anf v vectors
 	vec3 n = normalize(normal);
-	vec3 l = normalize(lights[i]);
-	vec3 v = normalize(lights[i] - position.xyz);
+	vec3 l = normalize(lightPosition);
+	vec3 v = normalize(lightPosition - position.xyz);
 	
 	// the reflection of the light source into the rendered surface
-	vec3 r = reflect(normalize(lights[i] - cameraPosition), n);
+	vec3 r = reflect(normalize(lightPosition - frame.cameraPosition.xyz), n);
 	
 	// the diffuse and specular components for each fragment
 	vec3 ambient = lightColor * 0.1;
@@ -59,17 +59,17 @@ void main()
 		color += computeLightColor(i, diffuseColor, position, normal);
 	}
 
-	vec3 pv = normalize(position.xyz - projectorData.position);
+	vec3 pv = normalize(position.xyz - frame.lightProjector.position.xyz);
 	
-	float dist = length(position.xyz - projectorData.position);
+	float dist = length(position.xyz - frame.lightProjector.position.xyz);
 	
-	vec3 d = normalize(projectorData.direction);
+	vec3 d = normalize(frame.lightProjector.direction.xyz);
 
 	if((dot(pv, d)) > abs(cos(10 * 0.0174533)))
 	{
 		// vec2 st = vec2(0.5, 10 * dot(pv, d));
 		
-		// color = vec4(1.0, 0.0, 0.0, 1.0) + texture2D(projectorData.texture, st);
+		// color = vec4(1.0, 0.0, 0.0, 1.0) + texture2D(projectorTexture, st);
 		color = mix(color, vec4(1), 0.3);
 	}
 }
@@ -0,0 +1,20 @@
+#version 330 core
+
+layout (location = 0) in vec3 position;
+
+// FrameData comes from frameData.glsl
+// same block as deferredPass0.vert, only the transform is used
+layout (std140) uniform ObjectData
+{
+  mat4 modelViewMatrix;
+  mat4 modelMatrix;
+  vec4 color;
+};
+
+// must match deferredPass0.vert bit for bit, the G-buffer pass tests with GL_EQUAL
+invariant gl_Position;
+
+void main()
+{
+  gl_Position = frame.projectionMatrix * modelViewMatrix * vec4(position, 1.0);
+}
@@ -0,0 +1,26 @@
+#version 430 core
+
+layout (location = 0) in vec3 position;
+layout (location = 3) in uint drawId;
+
+// FrameData comes from frameData.glsl
+struct ObjectData
+{
+  mat4 modelViewMatrix;
+  mat4 modelMatrix;
+  vec4 color;
+};
+
+// every object's constants for the frame (SceneObject::Constants), picked by drawId
+layout (std430) readonly buffer ObjectDataArray
+{
+  ObjectData objects[];
+};
+
+// must match deferredPass0Indirect.vert bit for bit, the G-buffer pass tests with GL_EQUAL
+invariant gl_Position;
+
+void main()
+{
+  gl_Position = frame.projectionMatrix * objects[drawId].modelViewMatrix * vec4(position, 1.0);
+}
@@ -0,0 +1,17 @@
+// per-frame data shared by every program (DeferredRenderer::FrameConstants); Shader::fromFiles() puts this file
+// right after the #version line of every shader it loads
+struct Projector
+{
+  vec4 position;
+  vec4 direction;
+};
+
+layout (std140) uniform FrameData
+{
+  mat4 viewMatrix;
+  mat4 projectionMatrix;
+  mat4 inverseProjectionMatrix;
+  vec4 cameraPosition;
+  Projector surfaceProjector;   // painted into the G-buffer
+  Projector lightProjector;     // highlights the lit image
+} frame;
@@ -0,0 +1,25 @@
+#version 330 core
+
+// one level of the Hi-Z pyramid, as HiZPyramid::build() makes it: level 0 is the depth as it is, every other
+// level the farthest of the 2 x 2 texels of the one below. the source's base level is the level to read
+uniform sampler2D source;
+uniform bool reduce;
+
+layout (location = 0) out float depth;
+
+void main()
+{
+  ivec2 target = ivec2(gl_FragCoord.xy);
+  if (!reduce)
+  {
+    depth = texelFetch(source, target, 0).r;
+    return;
+  }
+
+  // odd sizes round up, the last texel of a row or column then covers one texel of the level below
+  ivec2 last = textureSize(source, 0) - 1;
+  ivec2 p0 = target * 2;
+  ivec2 p1 = min(p0 + 1, last);
+  depth = max(max(texelFetch(source, p0, 0).r, texelFetch(source, ivec2(p1.x, p0.y), 0).r),
+              max(texelFetch(source, ivec2(p0.x, p1.y), 0).r, texelFetch(source, p1, 0).r));
+}
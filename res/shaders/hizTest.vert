@@ -0,0 +1,62 @@
+#version 330 core
+
+// the box test of HiZPyramid::visible() against the pyramid of the current frame. drawn as a single point inside
+// an occlusion query: the point lands on screen when the box may be visible, and is clipped away when it is hidden
+uniform mat4 modelViewProjection;
+uniform vec3 boundsMin;
+uniform vec3 boundsMax;
+uniform sampler2D hiZ;
+uniform vec2 size;      // of the depth in level 0 texels, the pyramid is padded beyond it
+
+const float nearW = 1e-5;
+
+void main()
+{
+  vec4 visible = vec4(0.0, 0.0, 0.0, 1.0);
+  vec4 hidden = vec4(2.0, 2.0, 2.0, 1.0);
+
+  vec2 minWindow = vec2(1e30);
+  vec2 maxWindow = vec2(-1e30);
+  float minDepth = 1.0;
+  for (int corner = 0; corner < 8; ++corner)
+  {
+    vec3 position = vec3((corner & 1) != 0 ? boundsMax.x : boundsMin.x,
+                         (corner & 2) != 0 ? boundsMax.y : boundsMin.y,
+                         (corner & 4) != 0 ? boundsMax.z : boundsMin.z);
+    vec4 clip = modelViewProjection * vec4(position, 1.0);
+    // reaching behind the eye, nothing can be said
+    if (clip.w < nearW || clip.z < -clip.w)
+    {
+      gl_Position = visible;
+      return;
+    }
+    vec3 ndc = clip.xyz / clip.w;
+    vec2 window = (ndc.xy * 0.5 + 0.5) * size;
+    minWindow = min(minWindow, window);
+    maxWindow = max(maxWindow, window);
+    minDepth = min(minDepth, ndc.z * 0.5 + 0.5);
+  }
+
+  // off screen is the frustum's business
+  ivec2 last = ivec2(size) - 1;
+  ivec2 t0 = max(ivec2(floor(minWindow)), ivec2(0));
+  ivec2 t1 = min(ivec2(floor(maxWindow)), last);
+  if (any(greaterThan(t0, t1)))
+  {
+    gl_Position = visible;
+    return;
+  }
+
+  // the finest level where the rectangle touches at most 2 x 2 texels
+  int level = 0;
+  while (any(greaterThan((t1 >> level) - (t0 >> level), ivec2(1))))
+  {
+    ++level;
+  }
+  t0 >>= level;
+  t1 >>= level;
+
+  float farthest = max(max(texelFetch(hiZ, t0, level).r, texelFetch(hiZ, ivec2(t1.x, t0.y), level).r),
+                       max(texelFetch(hiZ, ivec2(t0.x, t1.y), level).r, texelFetch(hiZ, t1, level).r));
+  gl_Position = minDepth <= farthest ? visible : hidden;
+}
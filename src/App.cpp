@@ -1,80 +1,347 @@
 #include "utils/debugout.h"
 
-#include <glfw3.h>
-#include <gl/GL.h>
-#include <gl/GLU.h>
-#include <iostream>
+#include <string>
+#include <cstdlib>
+#include <algorithm>
+#include <thread>
+#include <chrono>
+#include <vector>
 
-#pragma comment (lib, "glfw3.lib")
+#ifdef _WIN32
 #pragma comment (lib, "opengl32.lib")
-#pragma comment (lib, "glu32.lib")
+#endif
 
 #include "opengl/objects/cube.h"
 #include "opengl/objects/plane.h"
 #include "opengl/camera.h"
 #include "opengl/glutils.h"
-#include "opengl/DeferredRenderer.h"
+#include "opengl/deferredrenderer.h"
+#include "opengl/geometryarena.h"
+#include "opengl/gputimer.h"
+#include "platform/platform.h"
 #include "motionModel/motionModel.h"
+#include "motionModel/cameraPath.h"
+#include "utils/jobsystem.h"
+#include "utils/logger.h"
+#include "utils/framepipeline.h"
+#include "utils/profiler.h"
+#include "tools/scenes.h"
+#include "tools/headless.h"
+#include "tools/benchmarks.h"
 
+namespace {
+  // what the simulation hands over to the GL thread
+  struct FrameSnapshot
+  {
+    Camera camera;
+    DeferredRenderer::Visibility visibility;
+  };
 
+  // frames per thread count when benchmarking the recording
+  const size_t BenchmarkFrames = 120;
 
-struct WindowSetup {
-  static const int REFRESH_RATE = 60;// Hz
-  static const int WIDTH = 1024;
-  static const int HEIGHT = 768;  
-  static const float ASPECT;
-};
-
-const float WindowSetup::ASPECT = static_cast<float>(WIDTH) / static_cast<float>(HEIGHT);
+  // saves the profiler's trace when main returns, whichever way; declared before everything else, it's the last
+  // to go, after every thread is joined or idle
+  struct TraceOnExit
+  {
+    std::string path;
 
-const size_t numCubes = 500;
+    ~TraceOnExit()
+    {
+      if (path.empty())
+      {
+        return;
+      }
+      if (!Profiler::enabled())
+      {
+        debugLogAt(LogLevel::Warning, "No trace, profiling isn't compiled in (ENABLE_PROFILING)");
+      }
+      else if (Profiler::writeTrace(path))
+      {
+        // what was recorded since the last frame() too
+        Profiler::frame();
+        Profiler::logHistograms();
+        debugLog("Trace saved to %", path);
+      }
+      else
+      {
+        debugLogAt(LogLevel::Error, "Failed to write the trace %", path);
+      }
+    }
+  };
+}
 
-int main()
+// --cubes N                scene size, 500 by default
+// --benchmark-recording    re-records every frame with 1 .. N job system threads, reports the average record time
+//                          per thread count and exits
+// --benchmark-jobs         times batches of small jobs on the job system against std::async and exits
+// --benchmark-log          times debugLog calls, on one thread and on all of them at once, and exits
+// --benchmark-raster       software G-buffer pass with 1 .. N threads, reports triangles per second and exits
+// --benchmark-gl-calls     runs the GL renderer on MockGL, without a window, and reports its GL calls per frame
+// --count-gl               counts and times the GL calls, logged with the other statistics
+// --no-pipeline            simulates each frame right before submitting it, instead of alongside the previous one
+// --uncapped               doesn't wait for vsync
+// --seed N                 places the cubes the same way every run; by default the layout changes with the time
+// --hiz                    culls in two phases against a Hi-Z pyramid of the previous frames' depth
+// --occlusion              culls in the window what the nearest objects hide in a small CPU depth buffer
+// --headless image.ppm     renders the first frame with the software renderer, no window or GL, and saves it
+// --headless-gl image.ppm  renders with the GL renderer on a context without a window (EGL on Linux, no display
+//                          server needed), reports the time per frame and saves the last one
+// --capture frames/f.png   renders --frames frames offscreen and streams them to frames/f0000.png ... (PPM
+//                          unless .png) on a writer thread; the GL renderer, headless as with --headless-gl
+// --capture video.mp4      the same into a video, through ffmpeg, or raw yuv420p without it for a .yuv
+// --frames N               with --headless-gl or --capture, the number of frames, 1 by default
+// --reference image.ppm    with --headless or --headless-gl, fails unless the render matches this image
+// --record path.cam        saves the camera of every frame of the windowed session to path.cam on exit
+// --replay path.cam        moves the camera along a recorded path instead of by the keyboard, in the window until
+//                          the path ends, or with --headless-gl or --capture for as many frames as it has
+// --benchmark-path path.cam  replays a recorded path headless, reports frame and pass time percentiles and exits
+// --trace trace.json       on exit saves the profiled scopes of the last frames for chrome://tracing or Perfetto;
+//                          needs a build with ENABLE_PROFILING
+// --log log.txt            writes what is logged to log.txt as well
+int main(int argc, char** argv)
 {
-  if (!glfwInit()) 
+  PROFILE_THREAD("GL");
+
+  size_t numCubes = 500;
+  bool benchmarkRecording = false;
+  bool benchmarkJobs = false;
+  bool benchmarkLog = false;
+  bool benchmarkRaster = false;
+  bool benchmarkGLCalls = false;
+  bool countGL = false;
+  bool pipelined = true;
+  bool uncapped = false;
+  bool hiZ = false;
+  bool occlusion = false;
+  unsigned int seed = 0;
+  std::string headlessImage;
+  std::string headlessGLImage;
+  std::string capturePath;
+  size_t headlessFrames = 0;
+  std::string referenceImage;
+  std::string recordPath;
+  std::string replayPath;
+  std::string benchmarkPath;
+  std::string tracePath;
+  std::string logPath;
+  for (int i = 1; i < argc; ++i)
   {
-    debugLog(">>> Failed to initialize GLFW!");
-    std::cout << "Failed to initialize GLFW!" << std::endl;
-    return -1;
+    std::string argument = argv[i];
+    if (argument == "--cubes" && i + 1 < argc)
+    {
+      numCubes = static_cast<size_t>(std::strtoul(argv[++i], nullptr, 10));
+    }
+    else if (argument == "--benchmark-recording")
+    {
+      benchmarkRecording = true;
+    }
+    else if (argument == "--benchmark-jobs")
+    {
+      benchmarkJobs = true;
+    }
+    else if (argument == "--benchmark-log")
+    {
+      benchmarkLog = true;
+    }
+    else if (argument == "--benchmark-raster")
+    {
+      benchmarkRaster = true;
+    }
+    else if (argument == "--benchmark-gl-calls")
+    {
+      benchmarkGLCalls = true;
+    }
+    else if (argument == "--count-gl")
+    {
+      countGL = true;
+    }
+    else if (argument == "--no-pipeline")
+    {
+      pipelined = false;
+    }
+    else if (argument == "--uncapped")
+    {
+      uncapped = true;
+    }
+    else if (argument == "--hiz")
+    {
+      hiZ = true;
+    }
+    else if (argument == "--occlusion")
+    {
+      occlusion = true;
+    }
+    else if (argument == "--seed" && i + 1 < argc)
+    {
+      seed = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+    }
+    else if (argument == "--headless" && i + 1 < argc)
+    {
+      headlessImage = argv[++i];
+    }
+    else if (argument == "--headless-gl" && i + 1 < argc)
+    {
+      headlessGLImage = argv[++i];
+    }
+    else if (argument == "--capture" && i + 1 < argc)
+    {
+      capturePath = argv[++i];
+    }
+    else if (argument == "--frames" && i + 1 < argc)
+    {
+      headlessFrames = static_cast<size_t>(std::strtoul(argv[++i], nullptr, 10));
+    }
+    else if (argument == "--reference" && i + 1 < argc)
+    {
+      referenceImage = argv[++i];
+    }
+    else if (argument == "--record" && i + 1 < argc)
+    {
+      recordPath = argv[++i];
+    }
+    else if (argument == "--replay" && i + 1 < argc)
+    {
+      replayPath = argv[++i];
+    }
+    else if (argument == "--benchmark-path" && i + 1 < argc)
+    {
+      benchmarkPath = argv[++i];
+    }
+    else if (argument == "--trace" && i + 1 < argc)
+    {
+      tracePath = argv[++i];
+    }
+    else if (argument == "--log" && i + 1 < argc)
+    {
+      logPath = argv[++i];
+    }
   }
+  TraceOnExit traceOnExit{ tracePath };
 
-  
-  glfwWindowHint(GLFW_REFRESH_RATE, WindowSetup::REFRESH_RATE);
-  glfwWindowHint(GLFW_DOUBLEBUFFER, GLFW_TRUE);
-  
-  GLFWwindow* window = glfwCreateWindow(WindowSetup::WIDTH, WindowSetup::HEIGHT, "Deferred Rendering", NULL, NULL);
-  
-  glfwShowWindow(window);
+  // the modes that report and exit print to the console, once, in place of the debugger's output or stderr
+  auto reports = benchmarkRecording || benchmarkJobs || benchmarkLog || benchmarkRaster || benchmarkGLCalls || !benchmarkPath.empty() || !headlessImage.empty() || !headlessGLImage.empty() || !capturePath.empty();
+  if (reports)
+  {
+    std::vector<std::unique_ptr<LogSink>> console;
+    console.push_back(std::make_unique<ConsoleLogSink>());
+    Logger::instance().replaceSinks(std::move(console));
+  }
+
+  if (!logPath.empty())
+  {
+    auto logFile = FileLogSink::createUnique(logPath);
+    if (!logFile)
+    {
+      debugLogAt(LogLevel::Error, "Failed to open the log %", logPath);
+      return -1;
+    }
+    Logger::instance().addSink(std::move(logFile));
+  }
 
-  /*auto cube = CubeVBO::createUnique();*/
-  glfwMakeContextCurrent(window);
+  std::unique_ptr<CameraPath> replay;
+  if (!replayPath.empty() || !benchmarkPath.empty())
+  {
+    auto& path = benchmarkPath.empty() ? replayPath : benchmarkPath;
+    replay = CameraPath::load(path);
+    if (!replay)
+    {
+      debugLogAt(LogLevel::Error, "Failed to load the camera path %", path);
+      return -1;
+    }
+  }
+
+  if (!benchmarkPath.empty())
+  {
+    return benchmarkCameraPath(numCubes, seed ? seed : 1, hiZ, *replay);
+  }
+
+  if (benchmarkLog)
+  {
+    benchmarkLogger();
+    return 0;
+  }
+
+  if (benchmarkJobs)
+  {
+    ::benchmarkJobs();
+    return 0;
+  }
+
+  if (benchmarkRaster)
+  {
+    ::benchmarkRaster(numCubes, seed ? seed : 1);
+    return 0;
+  }
+
+  if (benchmarkGLCalls)
+  {
+    ::benchmarkGLCalls(numCubes, seed ? seed : 1);
+    return 0;
+  }
+
+  if (!headlessImage.empty())
+  {
+    return renderHeadless(numCubes, seed ? seed : 1, hiZ, headlessImage, referenceImage);
+  }
+
+  if (!headlessGLImage.empty() || !capturePath.empty())
+  {
+    if (!headlessFrames)
+    {
+      headlessFrames = replay ? replay->frames() : 1;
+    }
+    return renderHeadlessGL(numCubes, seed ? seed : 1, hiZ, headlessFrames, headlessGLImage, capturePath, referenceImage, replay.get());
+  }
+
+  auto platform = Platform::createWindowed(WindowSetup::WIDTH, WindowSetup::HEIGHT, "Deferred Rendering", WindowSetup::REFRESH_RATE);
+  if (!platform)
+  {
+    debugLogAt(LogLevel::Error, "Failed to create a window");
+    return -1;
+  }
+
+  if (uncapped)
+  {
+    platform->setSwapInterval(0);
+  }
 
   std::vector<std::unique_ptr<CubeVBO>> cubes;
   cubes.resize(numCubes);
 
-  SYSTEMTIME time;
-  GetSystemTime(&time);
-  LONG timeMS = (time.wSecond * 1000) + time.wMilliseconds;
-  srand(timeMS);
+  srand(seed ? seed : static_cast<unsigned int>(Platform::wallClockMilliseconds()));
   
+  // one worker per core, shared by everything that runs per frame; outlives the renderer
+  auto jobSystem = JobSystem::createUnique(0);
+
   auto deferredRenderer = DeferredRenderer::createUnique(WindowSetup::WIDTH, WindowSetup::HEIGHT, 8);
+  deferredRenderer->jobSystem() = jobSystem.get();
+  // falls back to one draw per object when GL 4.3 isn't there
+  deferredRenderer->options().multiDrawIndirect = true;
+  deferredRenderer->options().hiZCulling = hiZ;
+  deferredRenderer->options().occlusionCulling = occlusion;
 
   for (auto& cube : cubes)
   {
-    auto r0 = rand() / static_cast<float>(RAND_MAX);
-    auto r1 = rand() / static_cast<float>(RAND_MAX);
-    auto r2 = rand() / static_cast<float>(RAND_MAX);
-
     cube = CubeVBO::createUnique(deferredRenderer->pass0());
-    cube->color() = { 214.0f * r0, 64.0f * r0, 187.0f * r0 };
-    cube->color() = { 255, 200, 0 };
-    cube->position() = {-100.0f + (200.0f * r1), 1, -100.0f + (200.0f * r2)};
+    placeCube(*cube);
   }
 
   auto plane = PlaneVBO::createUnique(deferredRenderer->pass0());
-  plane->color() = { 230, 149, 18 };
+  plane->color() = PlaneColor;
+
+  // null where there are no timestamp queries, the passes just aren't timed on the GPU then
+  auto gpuTimer = GpuTimer::createUnique();
+
+  std::vector<SceneObject*> sceneObjects;
+  sceneObjects.push_back(plane.get());
+  for (auto& cube : cubes)
+  {
+    sceneObjects.push_back(cube.get());
+  }
 
 
+  // projection only; position and attitude come from the motion model, per snapshot
   Camera camera;  
   camera.mode() = Camera::Mode::PERSPECTIVE;
   camera.perspectiveData() = { 45.0f, WindowSetup::ASPECT, 0.1f, 1000.0f };
@@ -83,37 +350,184 @@ int main()
   motionModel.eyePosition() = { 0, 4, 20 };
   motionModel.deltaPos() = 0.2f;
   motionModel.deltaAtt() = 1;
+  motionModel.timeStep() = 1.0 / WindowSetup::REFRESH_RATE;
+  motionModel.platform() = platform.get();
+  motionModel.reset();
+
+  auto recording = recordPath.empty() ? std::unique_ptr<CameraPath>() : CameraPath::createUnique();
+  size_t simulatedFrames = 0;
+
+  using Clock = std::chrono::high_resolution_clock;
+  auto lastSimulation = Clock::now();
 
-  while (!glfwWindowShouldClose(window))
+  // motion and culling of the next frame run on the simulation thread while this one is submitted. the benchmark
+  // swaps the job system between frames, which the simulation would still be using
+  auto framePipeline = FramePipeline<FrameSnapshot>::createUnique([&](FrameSnapshot& snapshot)
   {
-    motionModel.computeMotion();
+    PROFILE_SCOPE("Simulate");
+    // the eye moves at the same speed whatever the frame rate, in at most maxSteps steps a frame
+    auto now = Clock::now();
+    motionModel.update(std::chrono::duration<double>(now - lastSimulation).count());
+    lastSimulation = now;
 
-    camera.position() = motionModel.eyePosition();
-    camera.attitude() = motionModel.eyeAttitude();
+    snapshot.camera = camera;
+    if (replay)
+    {
+      replay->apply(simulatedFrames, snapshot.camera);
+    }
+    else
+    {
+      snapshot.camera.position() = motionModel.interpolatedPosition();
+      snapshot.camera.attitude() = motionModel.interpolatedAttitude();
+    }
+    ++simulatedFrames;
+    deferredRenderer->cull(sceneObjects, snapshot.camera, snapshot.visibility);
+  }, pipelined && !benchmarkRecording);
 
-    //glClearColor(18.f/255.f, 230.f/255.f, 223.f/255.f, 1.0f);
-    //glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  auto renderFrame = [&]()
+  {
+    const FrameSnapshot* acquired;
+    {
+      PROFILE_SCOPE("Wait for simulation");
+      acquired = &framePipeline->acquire();
+    }
+    const auto& snapshot = *acquired;
 
-    //glEnable(GL_DEPTH_TEST);
-    deferredRenderer->attach();    
-    auto projectionMatrix = camera.projectionMatrix();
-    auto viewMatrix = camera.viewMatrix();
-    
-    plane->draw(projectionMatrix, viewMatrix);
+    // here rather than in the simulation, which runs a frame ahead: the path has the frames that were drawn
+    if (recording)
+    {
+      recording->record(snapshot.camera.position(), snapshot.camera.attitude());
+    }
 
-    for (auto& cube : cubes)
     {
-      cube->draw(projectionMatrix, viewMatrix);
+      PROFILE_SCOPE("Frame");
+      if (gpuTimer)
+      {
+        gpuTimer->beginFrame();
+      }
+      {
+        GpuTimer::Scope gpuScope(gpuTimer.get(), "GPU G-buffer pass");
+        {
+          PROFILE_SCOPE("Attach");
+          deferredRenderer->attach();
+        }
+        {
+          PROFILE_SCOPE("Draw objects");
+          deferredRenderer->drawObjects(sceneObjects, snapshot.camera, &snapshot.visibility);
+        }
+        {
+          PROFILE_SCOPE("Detach");
+          deferredRenderer->detach();
+        }
+      }
+      {
+        PROFILE_SCOPE("Render");
+        GpuTimer::Scope gpuScope(gpuTimer.get(), "GPU lighting pass");
+        deferredRenderer->render(snapshot.camera);
+      }
+      {
+        PROFILE_SCOPE("Debug");
+        GpuTimer::Scope gpuScope(gpuTimer.get(), "GPU debug");
+        deferredRenderer->debug();
+      }
+      {
+        PROFILE_SCOPE("Swap");
+        platform->swapBuffers();
+        platform->pollEvents();
+      }
     }
-    deferredRenderer->detach();
+    Profiler::frame();
 
-    deferredRenderer->render(camera);
+    OPENGL_CHECK_ERROR();
+  };
 
-    deferredRenderer->debug();
+  if (benchmarkRecording)
+  {
+    // the indirect path records a handful of commands whatever the scene, only the direct one scales
+    auto& options = deferredRenderer->options();
+    options.multiDrawIndirect = false;
+    options.reuseCommands = false;
 
-    glfwSwapBuffers(window);
-    glfwPollEvents();
+    auto maxThreads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    double singleThreaded = 0.0;
+    for (size_t threads = 1; threads <= maxThreads && !platform->shouldClose(); ++threads)
+    {
+      jobSystem = JobSystem::createUnique(threads);
+      deferredRenderer->jobSystem() = jobSystem.get();
+      double total = 0.0;
+      for (size_t frame = 0; frame < BenchmarkFrames; ++frame)
+      {
+        renderFrame();
+        total += deferredRenderer->statistics().recordMilliseconds;
+      }
+      auto average = total / BenchmarkFrames;
+      if (threads == 1)
+      {
+        singleThreaded = average;
+      }
+      auto speedup = average > 0.0 ? singleThreaded / average : 0.0;
+      debugLog("Recording % objects: % threads, % ms (% x)", sceneObjects.size(), threads, average, speedup);
+    }
+    return 0;
+  }
 
-    OPENGL_CHECK_ERROR();
+  GLDispatch::setCounting(countGL, countGL);
+  auto intervalStart = Clock::now();
+
+  size_t frame = 0;
+  while (!platform->shouldClose() && !(replay && frame >= replay->frames()))
+  {
+    renderFrame();
+
+    if (++frame % 600 == 0)
+    {
+      auto frameMilliseconds = std::chrono::duration<double, std::milli>(Clock::now() - intervalStart).count() / 600.0;
+      intervalStart = Clock::now();
+      debugLog("Frame: % ms, simulation %", frameMilliseconds, framePipeline->pipelined() ? "pipelined" : "inline");
+
+      const auto& statistics = deferredRenderer->statistics();
+      debugLog("G-buffer: % fragments/pixel, depth pre-pass % (saves % x)", statistics.overdrawRatio(), deferredRenderer->options().depthPrePass ? "on" : "off", statistics.prePassSavings());
+      debugLog("G-buffer: % objects drawn, % culled, % draw calls", statistics.drawnObjects, statistics.culledObjects, statistics.drawCalls);
+      debugLog("Occlusion: % objects hidden by % occluders, % ms", statistics.occludedObjects, statistics.occluders, statistics.occlusionMilliseconds);
+      if (deferredRenderer->options().hiZCulling)
+      {
+        debugLog("Hi-Z: % objects deferred to the second phase", statistics.hiZDeferred);
+      }
+      debugLog("Commands: % bytes, % (record % ms on % threads, replay % ms)", statistics.commandBytes, statistics.commandsReused ? "reused" : "recorded", statistics.recordMilliseconds, statistics.recordingThreads, statistics.replayMilliseconds);
+      if (GLDispatch::counting())
+      {
+        auto calls = GLDispatch::calls();
+        logGLCalls("window", calls, 600);
+        debugLog("GL call time per frame: binds % ms, uniforms % ms, draws % ms, other % ms", calls.milliseconds(GLDispatch::Kind::Bind) / 600.0, calls.milliseconds(GLDispatch::Kind::Uniform) / 600.0, calls.milliseconds(GLDispatch::Kind::Draw) / 600.0, calls.milliseconds(GLDispatch::Kind::Other) / 600.0);
+        GLDispatch::resetCalls();
+      }
+
+      if (gpuTimer)
+      {
+        logGpuPasses(*gpuTimer);
+      }
+      if (Profiler::enabled())
+      {
+        Profiler::logHistograms();
+      }
+
+      auto& geometryArena = GeometryArena::instance();
+      auto geometry = geometryArena.statistics();
+      debugLog("Geometry arena: % meshes, % / % vertices, % / % indices, % free blocks, fragmentation %", geometry.meshes, geometry.verticesUsed, geometry.vertexCapacity, geometry.indicesUsed, geometry.indexCapacity, geometry.freeBlocks, geometry.fragmentation);
+      if (geometry.fragmentation > 0.5f)
+      {
+        geometryArena.defragment();
+      }
+    }
+  }
+
+  if (recording)
+  {
+    if (!recording->save(recordPath))
+    {
+      debugLogAt(LogLevel::Error, "Failed to save the camera path %", recordPath);
+      return -1;
+    }
+    debugLog("Recorded % frames of camera path to %", recording->frames(), recordPath);
   }
 }
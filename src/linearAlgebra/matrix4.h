@@ -14,6 +14,7 @@
 #define __MATRIX4_H__
 
 #include <memory.h>
+#include <cmath>
 #include "vector3.h"
 #include "../utils/constants.h"
 
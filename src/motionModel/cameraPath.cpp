@@ -0,0 +1,78 @@
+#include "cameraPath.h"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+
+#include "../opengl/camera.h"
+#include "../utils/debugout.h"
+
+namespace {
+  const char Magic[4] = { 'C', 'P', 'T', 'H' };
+  const uint32_t Version = 1;
+  const size_t FloatsPerPose = 6;
+}
+
+std::unique_ptr<CameraPath> CameraPath::load(const std::string& path)
+{
+  std::ifstream file(path, std::ios::binary);
+  char magic[4];
+  uint32_t version = 0;
+  uint32_t count = 0;
+  file.read(magic, sizeof(magic));
+  file.read(reinterpret_cast<char*>(&version), sizeof(version));
+  file.read(reinterpret_cast<char*>(&count), sizeof(count));
+  if (!file || std::memcmp(magic, Magic, sizeof(Magic)) != 0 || version != Version)
+  {
+    debugLog(">>> % is not a camera path", path);
+    return std::unique_ptr<CameraPath>();
+  }
+
+  std::vector<float> floats(count * FloatsPerPose);
+  file.read(reinterpret_cast<char*>(floats.data()), static_cast<std::streamsize>(floats.size() * sizeof(float)));
+  if (!file)
+  {
+    debugLog(">>> Camera path % is cut short", path);
+    return std::unique_ptr<CameraPath>();
+  }
+
+  auto cameraPath = createUnique();
+  cameraPath->m_poses.resize(count);
+  auto value = floats.data();
+  for (auto& pose : cameraPath->m_poses)
+  {
+    pose.position = { value[0], value[1], value[2] };
+    pose.attitude = { value[3], value[4], value[5] };
+    value += FloatsPerPose;
+  }
+  return cameraPath;
+}
+
+bool CameraPath::save(const std::string& path) const
+{
+  std::vector<float> floats;
+  floats.reserve(m_poses.size() * FloatsPerPose);
+  for (const auto& pose : m_poses)
+  {
+    floats.insert(floats.end(), { pose.position.x, pose.position.y, pose.position.z, pose.attitude.h, pose.attitude.p, pose.attitude.r });
+  }
+
+  std::ofstream file(path, std::ios::binary);
+  auto count = static_cast<uint32_t>(m_poses.size());
+  file.write(Magic, sizeof(Magic));
+  file.write(reinterpret_cast<const char*>(&Version), sizeof(Version));
+  file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+  file.write(reinterpret_cast<const char*>(floats.data()), static_cast<std::streamsize>(floats.size() * sizeof(float)));
+  return static_cast<bool>(file);
+}
+
+void CameraPath::apply(size_t frame, Camera& camera) const
+{
+  if (m_poses.empty())
+  {
+    return;
+  }
+  const auto& pose = m_poses[frame < m_poses.size() ? frame : m_poses.size() - 1];
+  camera.position() = pose.position;
+  camera.attitude() = pose.attitude;
+}
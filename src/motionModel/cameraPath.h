@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../linearAlgebra/vector3.h"
+
+class Camera;
+
+// The eye, frame by frame: recorded from a session and replayed to move the camera the same way on every run,
+// whatever the keyboard or the frame rate, so that benchmarks compare like with like. Saved as a small binary
+// file, a header then six floats a frame, little endian as on every platform this builds on.
+class CameraPath
+{
+public:
+  struct Pose
+  {
+    vector3<float> position;
+    vector3<float> attitude;
+  };
+
+  static std::unique_ptr<CameraPath> createUnique()
+  {
+    return std::make_unique<CameraPath>();
+  }
+
+  // nullptr if the file can't be read or isn't a camera path
+  static std::unique_ptr<CameraPath> load(const std::string& path);
+
+  bool save(const std::string& path) const;
+
+  void record(const vector3<float>& position, const vector3<float>& attitude)
+  {
+    m_poses.push_back({ position, attitude });
+  }
+
+  size_t frames() const
+  {
+    return m_poses.size();
+  }
+
+  // moves camera where it was in frame, the last frame's pose past the end; nothing when there are none
+  void apply(size_t frame, Camera& camera) const;
+
+protected:
+  std::vector<Pose> m_poses;
+};
@@ -1,7 +1,7 @@
 #include "motionModel.h"
 #include "../linearAlgebra/matrix4.h"
 #include "../utils/debugout.h"
-#include <Windows.h>
+#include "../platform/platform.h"
 
 
 namespace {
@@ -18,7 +18,12 @@ namespace {
 
 void MotionModel::computeMotion()
 {
-  if (GetAsyncKeyState(VK_UP) & 0x8000)
+  auto keyDown = [this](Platform::Key key)
+  {
+    return m_platform && m_platform->keyDown(key);
+  };
+
+  if (keyDown(Platform::Key::Up))
   {
     vector3<float> forward(0, 0, -1);
 
@@ -28,7 +33,7 @@ void MotionModel::computeMotion()
     m_eyePosition += forward;
   }
 
-  if (GetAsyncKeyState(VK_DOWN) & 0x8000)
+  if (keyDown(Platform::Key::Down))
   {
     vector3<float> backward(0, 0, 1);
 
@@ -38,7 +43,7 @@ void MotionModel::computeMotion()
     m_eyePosition += backward;
   }
 
-  if (GetAsyncKeyState(VK_NUMPAD9) & 0x8000)
+  if (keyDown(Platform::Key::Numpad9))
   {
     vector3<float> up(0, 1, 0);
 
@@ -48,7 +53,7 @@ void MotionModel::computeMotion()
     m_eyePosition += up;
   }
 
-  if (GetAsyncKeyState(VK_NUMPAD3) & 0x8000)
+  if (keyDown(Platform::Key::Numpad3))
   {
     vector3<float> down(0, -1, 0);
 
@@ -58,30 +63,69 @@ void MotionModel::computeMotion()
     m_eyePosition += down;
   }
   
-  if (GetAsyncKeyState(VK_LEFT) & 0x8000)
+  if (keyDown(Platform::Key::Left))
   {
     m_eyeAttitude.h -= m_deltaAtt;
   }
-  if (GetAsyncKeyState(VK_RIGHT) & 0x8000)
+  if (keyDown(Platform::Key::Right))
   {
     m_eyeAttitude.h += m_deltaAtt;
   }
-  if (GetAsyncKeyState(VK_NUMPAD2) & 0x8000)
+  if (keyDown(Platform::Key::Numpad2))
   {
     m_eyeAttitude.p += m_deltaAtt;
   }
-  if (GetAsyncKeyState(VK_NUMPAD8) & 0x8000)
+  if (keyDown(Platform::Key::Numpad8))
   {
     m_eyeAttitude.p -= m_deltaAtt;
   }
-  if (GetAsyncKeyState(VK_NUMPAD6) & 0x8000)
+  if (keyDown(Platform::Key::Numpad6))
   {
     m_eyeAttitude.r += m_deltaAtt;
   }
-  if (GetAsyncKeyState(VK_NUMPAD4) & 0x8000)
+  if (keyDown(Platform::Key::Numpad4))
   {
     m_eyeAttitude.r -= m_deltaAtt;
   }
 
 }
 
+void MotionModel::reset()
+{
+  m_previousPosition = m_eyePosition;
+  m_previousAttitude = m_eyeAttitude;
+  m_accumulator = 0.0;
+}
+
+size_t MotionModel::update(double elapsed)
+{
+  m_accumulator += elapsed;
+
+  size_t steps = 0;
+  while (m_accumulator >= m_timeStep && steps < m_maxSteps)
+  {
+    m_previousPosition = m_eyePosition;
+    m_previousAttitude = m_eyeAttitude;
+    computeMotion();
+    m_accumulator -= m_timeStep;
+    ++steps;
+  }
+
+  // a stall longer than maxSteps steps isn't caught up, the simulation just runs late
+  if (m_accumulator >= m_timeStep)
+  {
+    m_accumulator = 0.0;
+  }
+
+  return steps;
+}
+
+vector3<float> MotionModel::interpolatedPosition() const
+{
+  return m_previousPosition + (m_eyePosition - m_previousPosition) * alpha();
+}
+
+vector3<float> MotionModel::interpolatedAttitude() const
+{
+  return m_previousAttitude + (m_eyeAttitude - m_previousAttitude) * alpha();
+}
@@ -1,13 +1,59 @@
 #pragma once
 
+#include <cstddef>
+
 #include "../utils/defines.h"
 #include "../linearAlgebra/vector3.h"
+
+class Platform;
+
 class MotionModel
 {
   DECLARE_PROTECTED_TRIVIAL_ATTRIBUTE(vector3<float>, eyePosition);
   DECLARE_PROTECTED_TRIVIAL_ATTRIBUTE(vector3<float>, eyeAttitude);
   DECLARE_PROTECTED_TRIVIAL_ATTRIBUTE(float, deltaPos);
   DECLARE_PROTECTED_TRIVIAL_ATTRIBUTE(float, deltaAtt);
+  DECLARE_PROTECTED_TRIVIAL_ATTRIBUTE(double, timeStep);   // seconds simulated by one computeMotion()
+  DECLARE_PROTECTED_TRIVIAL_ATTRIBUTE(size_t, maxSteps);   // per update(), the rest of a long stall is dropped
+
+  MotionModel()
+  {
+    m_deltaPos = 0.0f;
+    m_deltaAtt = 0.0f;
+    m_timeStep = 1.0 / 60.0;
+    m_maxSteps = 5;
+    m_platform = nullptr;
+    m_accumulator = 0.0;
+  }
+
+  // whose keys move the eye; not owned, may be null, then it stays put
+  const Platform*& platform()
+  {
+    return m_platform;
+  }
 
+  // one fixed step
   void computeMotion();
-};
\ No newline at end of file
+
+  // makes the eye as set the starting point of the interpolation; call after moving it by hand
+  void reset();
+
+  // advances by elapsed seconds in whole time steps and returns the number taken; whatever is left over
+  // is carried to the next call and sets how far between the last two steps the interpolated eye is
+  size_t update(double elapsed);
+
+  // the eye between the previous step and the latest one, for rendering at any rate
+  vector3<float> interpolatedPosition() const;
+  vector3<float> interpolatedAttitude() const;
+
+protected:
+  float alpha() const
+  {
+    return m_timeStep > 0.0 ? static_cast<float>(m_accumulator / m_timeStep) : 1.0f;
+  }
+
+  const Platform* m_platform;
+  vector3<float> m_previousPosition;
+  vector3<float> m_previousAttitude;
+  double m_accumulator;
+};
@@ -3,29 +3,14 @@
 #include "glutils.h"
 
 #include "VertexBufferObject.h"
+#include "commandbuffer.h"
 
 VertexBufferObject::VertexBufferObject(const std::vector<vector3<float>>& vertices, const std::vector<unsigned int>& indices, const std::vector<vector3<float>>& normals)
 {
-  auto& vertexBuffer = buffer(Names::Vertex);
-  glGenBuffers(1, &vertexBuffer);
-  glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
-  glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(vector3<float>), vertices.data(), GL_STATIC_DRAW);
-
-  auto& normalBuffer = buffer(Names::Normal);
-  glGenBuffers(1, &normalBuffer);
-  glBindBuffer(GL_ARRAY_BUFFER, normalBuffer);
-  glBufferData(GL_ARRAY_BUFFER, normals.size() * sizeof(vector3<float>), normals.data(), GL_STATIC_DRAW);
-
-
-  auto& indexBuffer = buffer(Names::Index);
-  glGenBuffers(1, &indexBuffer);
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(int), indices.data(), GL_STATIC_DRAW);
-
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+  m_geometry = GeometryArena::instance().allocate(vertices, normals, indices);
 
   m_numElements = indices.size();
+  m_numVertices = vertices.size();
 }
 
 std::unique_ptr<VertexBufferObject> VertexBufferObject::createUnique(const std::vector<vector3<float>>& vertices, const std::vector<unsigned int>& indices, const std::vector<vector3<float>>& normals)
@@ -39,32 +24,37 @@ VertexBufferObject::~VertexBufferObject()
 {
   if (haveOpenGLContext())
   {
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-    glDeleteBuffers(1, &buffer(Names::Vertex));
-    glDeleteBuffers(1, &buffer(Names::Normal));
-    glDeleteBuffers(1, &buffer(Names::Index));
+    GeometryArena::instance().free(m_geometry);
   }
 }
 
 void VertexBufferObject::draw()
 {
+  if (m_geometry == GeometryArena::InvalidHandle)
+  {
+    return;
+  }
+
   glEnableClientState(GL_VERTEX_ARRAY);
-  
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer(Names::Index));
 
-  glBindBuffer(GL_ARRAY_BUFFER, buffer(Names::Vertex));  
-  glEnableVertexAttribArray(0);
-  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
-  
-  
-  glBindBuffer(GL_ARRAY_BUFFER, buffer(Names::Normal));  
-  glEnableVertexAttribArray(1);
-  glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
-  
+  auto& arena = GeometryArena::instance();
+  arena.bind();
+  const auto& range = arena.range(m_geometry);
 
   glPolygonMode(m_mode.faceMode, m_mode.fillMode);
-  glDrawElements(m_mode.drawMode, static_cast<GLsizei>(m_numElements), GL_UNSIGNED_INT, nullptr);
+  glDrawElementsBaseVertex(m_mode.drawMode, static_cast<GLsizei>(range.numIndices), GL_UNSIGNED_INT, reinterpret_cast<const void*>(range.firstIndex * sizeof(GLuint)), static_cast<GLint>(range.firstVertex));
 
   glDisableClientState(GL_VERTEX_ARRAY);
 }
+
+void VertexBufferObject::record(CommandBuffer& commands) const
+{
+  if (m_geometry == GeometryArena::InvalidHandle)
+  {
+    return;
+  }
+
+  const auto& range = GeometryArena::instance().range(m_geometry);
+  commands.polygonMode(m_mode.faceMode, m_mode.fillMode);
+  commands.drawElementsBaseVertex(m_mode.drawMode, static_cast<GLsizei>(range.numIndices), static_cast<GLuint>(range.firstIndex), static_cast<GLint>(range.firstVertex));
+}
\ No newline at end of file
@@ -2,23 +2,17 @@
 
 #include <vector>
 #include <memory>
-#include <gl/GL.h>
+#include "glplatform.h"
 
 #include "../linearAlgebra/vector3.h"
 #include "../utils/defines.h"
+#include "geometryarena.h"
+
+class CommandBuffer;
 
 class VertexBufferObject
 {
 public:
-  enum class Names
-  {
-    Vertex = 0,
-    Normal,
-
-    Index,
-    Count
-  };
-
   struct Mode
   {
     GLuint drawMode = GL_TRIANGLES;
@@ -39,24 +33,31 @@ public:
   DECLARE_PROTECTED_TRIVIAL_ATTRIBUTE(Mode, mode);
 
 public:
-  // don't use Names::Count; i don't want to place a guard here;
-  GLuint buffer(Names name) const
+  // the vertices and indices live in GeometryArena::instance(); the handle identifies them there
+  GeometryArena::Handle geometry() const
   {
-    return m_buffer[static_cast<size_t>(name)];
+    return m_geometry;
   }
 
-  void draw();
-protected:
+  size_t numElements() const
+  {
+    return m_numElements;
+  }
 
-  // not for public use
-  GLuint& buffer(Names name)
+  size_t numVertices() const
   {
-    return m_buffer[static_cast<size_t>(name)];
+    return m_numVertices;
   }
 
-  GLuint m_buffer[static_cast<size_t>(Names::Count)];
+  void draw();
+
+  // records the draw; the stream has to bind the geometry arena before
+  void record(CommandBuffer& commands) const;
+protected:
+  GeometryArena::Handle m_geometry = GeometryArena::InvalidHandle;
 
-  size_t m_numElements;
+  size_t m_numElements = 0;
+  size_t m_numVertices = 0;
 };
 
-using VertexBufferObjectPtr = std::unique_ptr<VertexBufferObject>;
\ No newline at end of file
+using VertexBufferObjectPtr = std::unique_ptr<VertexBufferObject>;
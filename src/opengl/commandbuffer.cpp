@@ -0,0 +1,76 @@
+#include "commandbuffer.h"
+#include "geometryarena.h"
+#include "glutils.h"
+
+void CommandBuffer::execute(const Context& context) const
+{
+  auto at = m_stream.data();
+  auto end = at + m_stream.size();
+  while (at < end)
+  {
+    auto op = static_cast<Op>(*at++);
+    switch (op)
+    {
+    case Op::UseProgram:
+    {
+      GLuint program = 0;
+      at = read(at, program);
+      glUseProgram(program);
+      break;
+    }
+    case Op::BindRingRange:
+    {
+      RingRange range;
+      at = read(at, range);
+      glBindBufferRange(range.target, range.binding, context.ringBuffer, context.ringBase + range.offset, range.size);
+      break;
+    }
+    case Op::BindGeometry:
+      GeometryArena::instance().bind();
+      break;
+    case Op::BindDrawIds:
+    {
+      GLuint buffer = 0;
+      at = read(at, buffer);
+      glBindBuffer(GL_ARRAY_BUFFER, buffer);
+      glEnableVertexAttribArray(3);
+      glVertexAttribIPointer(3, 1, GL_UNSIGNED_INT, 0, nullptr);
+      glVertexAttribDivisorARB(3, 1);
+      break;
+    }
+    case Op::UnbindDrawIds:
+      glVertexAttribDivisorARB(3, 0);
+      glDisableVertexAttribArray(3);
+      glBindBuffer(GL_ARRAY_BUFFER, 0);
+      break;
+    case Op::PolygonMode:
+    {
+      PolygonModeArgs args;
+      at = read(at, args);
+      glPolygonMode(args.face, args.mode);
+      break;
+    }
+    case Op::DrawElementsBaseVertex:
+    {
+      DrawElements args;
+      at = read(at, args);
+      glDrawElementsBaseVertex(args.mode, args.count, GL_UNSIGNED_INT, reinterpret_cast<const void*>(args.firstIndex * sizeof(GLuint)), args.baseVertex);
+      break;
+    }
+    case Op::MultiDrawElementsIndirect:
+    {
+      MultiDraw args;
+      at = read(at, args);
+      glBindBuffer(GL_DRAW_INDIRECT_BUFFER, context.ringBuffer);
+      glMultiDrawElementsIndirect(args.mode, GL_UNSIGNED_INT, reinterpret_cast<const void*>(context.ringBase + args.offset), args.drawCount, 0);
+      glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+      break;
+    }
+    default:
+      debugLog(">>> Command buffer: unknown opcode %, replay stopped", static_cast<int>(op));
+      return;
+    }
+  }
+
+  OPENGL_CHECK_ERROR();
+}
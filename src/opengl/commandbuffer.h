@@ -0,0 +1,172 @@
+#pragma once
+
+#include "glplatform.h"
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "opengl_ext.h"
+
+// GL work recorded as a linear byte stream (one opcode byte followed by its packed arguments) and issued later
+// by execute(). Recording touches no GL state, so a stream can be built ahead of time and replayed for as many
+// frames as its inputs stay the same. Ranges of the uniform ring are recorded relative to the frame's region and
+// resolved against the region given to execute(), which is what lets a recording outlive the frame it was made in.
+class CommandBuffer
+{
+public:
+  enum class Op : uint8_t
+  {
+    UseProgram = 0,
+    BindRingRange,
+    BindGeometry,
+    BindDrawIds,
+    UnbindDrawIds,
+    PolygonMode,
+    DrawElementsBaseVertex,
+    MultiDrawElementsIndirect,
+  };
+
+  // what the recorded ring offsets are relative to
+  struct Context
+  {
+    GLuint ringBuffer = 0;
+    GLintptr ringBase = 0;
+  };
+
+  void clear()
+  {
+    m_stream.clear();
+    m_commands = 0;
+    m_draws = 0;
+  }
+
+  void useProgram(GLuint program)
+  {
+    write(Op::UseProgram, program);
+  }
+
+  // target is GL_UNIFORM_BUFFER or GL_SHADER_STORAGE_BUFFER; offset is relative to the ring's frame region
+  void bindRingRange(GLenum target, GLuint binding, GLintptr offset, GLsizeiptr size)
+  {
+    write(Op::BindRingRange, RingRange{ target, binding, offset, size });
+  }
+
+  // the geometry arena's vertex attributes and index buffer
+  void bindGeometry()
+  {
+    write(Op::BindGeometry);
+  }
+
+  // attribute 3, one id per instance, for the indirect programs
+  void bindDrawIds(GLuint buffer)
+  {
+    write(Op::BindDrawIds, buffer);
+  }
+
+  void unbindDrawIds()
+  {
+    write(Op::UnbindDrawIds);
+  }
+
+  void polygonMode(GLenum face, GLenum mode)
+  {
+    write(Op::PolygonMode, PolygonModeArgs{ face, mode });
+  }
+
+  void drawElementsBaseVertex(GLenum mode, GLsizei count, GLuint firstIndex, GLint baseVertex)
+  {
+    write(Op::DrawElementsBaseVertex, DrawElements{ mode, count, firstIndex, baseVertex });
+    ++m_draws;
+  }
+
+  // the commands are read from the ring, offset relative to the frame region
+  void multiDrawElementsIndirect(GLenum mode, GLintptr offset, GLsizei drawCount)
+  {
+    write(Op::MultiDrawElementsIndirect, MultiDraw{ mode, offset, drawCount });
+    ++m_draws;
+  }
+
+  // the other stream's commands after this one's; chunks recorded apart are merged this way
+  void append(const CommandBuffer& other)
+  {
+    m_stream.insert(m_stream.end(), other.m_stream.begin(), other.m_stream.end());
+    m_commands += other.m_commands;
+    m_draws += other.m_draws;
+  }
+
+  void execute(const Context& context) const;
+
+  size_t bytes() const
+  {
+    return m_stream.size();
+  }
+
+  size_t commands() const
+  {
+    return m_commands;
+  }
+
+  // draw calls the stream issues
+  size_t draws() const
+  {
+    return m_draws;
+  }
+
+protected:
+  struct RingRange
+  {
+    GLenum target;
+    GLuint binding;
+    GLintptr offset;
+    GLsizeiptr size;
+  };
+
+  struct PolygonModeArgs
+  {
+    GLenum face;
+    GLenum mode;
+  };
+
+  struct DrawElements
+  {
+    GLenum mode;
+    GLsizei count;
+    GLuint firstIndex;
+    GLint baseVertex;
+  };
+
+  struct MultiDraw
+  {
+    GLenum mode;
+    GLintptr offset;
+    GLsizei drawCount;
+  };
+
+  void write(Op op)
+  {
+    m_stream.push_back(static_cast<uint8_t>(op));
+    ++m_commands;
+  }
+
+  template<typename Args>
+  void write(Op op, const Args& args)
+  {
+    write(op);
+    auto at = m_stream.size();
+    m_stream.resize(at + sizeof(Args));
+    memcpy(m_stream.data() + at, &args, sizeof(Args));
+  }
+
+  // the stream is packed, arguments are copied out rather than read in place
+  template<typename Args>
+  static const uint8_t* read(const uint8_t* at, Args& args)
+  {
+    memcpy(&args, at, sizeof(Args));
+    return at + sizeof(Args);
+  }
+
+  std::vector<uint8_t> m_stream;
+  size_t m_commands = 0;
+  size_t m_draws = 0;
+};
@@ -2,8 +2,12 @@
 #include "opengl_ext.h"
 #include "glutils.h"
 
+#include <algorithm>
+#include <chrono>
+
 
 #include "../utils/debugout.h"
+#include "../utils/profiler.h"
 
 namespace {
   static auto vertices = {
@@ -56,6 +60,14 @@ namespace {
 
 std::unique_ptr<Screen> screen;
 
+namespace {
+  // objects per job: small enough to spread 500 cubes over a few cores, large enough to keep the per-chunk overhead out of sight
+  const size_t ObjectsPerChunk = 64;
+
+  // the nearest objects rasterized as occluders; a few dozen boxes hide most of what is behind them
+  const size_t MaxOccluders = 64;
+}
+
 namespace 
 {
   void createRenderBuffer(GLuint &bufferID, GLenum attachment, size_t width, size_t height, GLenum internalformat, size_t antialiasing)
@@ -90,6 +102,39 @@ namespace
     // Attach the texture to the FBO
     glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, textureID, 0);
   }
+
+  // distance in front of the camera; row vector convention, the camera looks down -Z
+  float viewDepth(const matrix4<float>& viewMatrix, const vector3<float>& position)
+  {
+    const float* view = viewMatrix.get_openglmatrix();
+    return -(position.x * view[2] + position.y * view[6] + position.z * view[10] + view[14]);
+  }
+
+  void toVec4(const vector3<float>& v, float w, float* out)
+  {
+    out[0] = v.x;
+    out[1] = v.y;
+    out[2] = v.z;
+    out[3] = w;
+  }
+
+  const uint64_t FnvBasis = 14695981039346656037ull;
+
+  uint64_t fnv1a(uint64_t hash, const void* data, size_t size)
+  {
+    auto bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; ++i)
+    {
+      hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+    return hash;
+  }
+
+  enum QueryPass
+  {
+    PrePass = 0,
+    GBufferPass = 1,
+  };
 }
 
 std::unique_ptr<DeferredRenderer> DeferredRenderer::createUnique(size_t width, size_t height, size_t antialiasing)
@@ -139,15 +184,53 @@ std::unique_ptr<DeferredRenderer> DeferredRenderer::createUnique(size_t width, s
 
   deferredRenderer->m_pass0 = Shader::fromFiles("res/shaders/deferredPass0.vert", "res/shaders/deferredPass0.frag");
   deferredRenderer->m_pass1 = Shader::fromFiles("res/shaders/deferredPass1.vert", "res/shaders/deferredPass1.frag");
+  deferredRenderer->m_depthPrePass = Shader::fromFiles("res/shaders/depthPrePass.vert", "res/shaders/depthPrePass.frag");
+  for (auto program : { deferredRenderer->m_pass0.get(), deferredRenderer->m_pass1.get(), deferredRenderer->m_depthPrePass.get() })
+  {
+    program->bindUniformBlock("ObjectData", UniformBlock::Object);
+    program->bindUniformBlock("FrameData", UniformBlock::Frame);
+    program->bindUniformBlock("LightData", UniformBlock::Lights);
+  }
 
-  deferredRenderer->m_projector.position() = { 0, 30, 0 };
-  deferredRenderer->m_projector.attitude() = { -2, -1, 0 };
+  // the indirect variants need GL 4.3; without it they stay empty and drawObjects() keeps to the direct path
+  if (glMultiDrawElementsIndirect)
+  {
+    deferredRenderer->m_pass0Indirect = Shader::fromFiles("res/shaders/deferredPass0Indirect.vert", "res/shaders/deferredPass0.frag");
+    deferredRenderer->m_depthPrePassIndirect = Shader::fromFiles("res/shaders/depthPrePassIndirect.vert", "res/shaders/depthPrePass.frag");
+    for (auto program : { deferredRenderer->m_pass0Indirect.get(), deferredRenderer->m_depthPrePassIndirect.get() })
+    {
+      program->bindUniformBlock("FrameData", UniformBlock::Frame);
+      program->bindStorageBlock("ObjectDataArray", StorageBlock::Objects);
+    }
+  }
+  else
+  {
+    deferredRenderer->m_pass0Indirect = std::make_unique<Shader>();
+    deferredRenderer->m_depthPrePassIndirect = std::make_unique<Shader>();
+  }
+
+  // a first guess; writeFrameConstants() replaces it with a bigger ring when a frame's data doesn't fit.
+  // allocate() returns null once a region is full, the callers skip what they couldn't place
+  deferredRenderer->m_uniformRing = UniformRingBuffer::createUnique(64 * 1024);
+
+  deferredRenderer->m_hiZ = HiZBuffer::createUnique(width, height);
+  // the point the test lands on screen writes nothing, any program without outputs does for the fragments
+  deferredRenderer->m_hiZTest = Shader::fromFiles("res/shaders/hizTest.vert", "res/shaders/depthPrePass.frag");
+
+  glGenQueries(static_cast<GLsizei>(QueryLatency * 2), &deferredRenderer->m_fragmentQueries[0][0]);
+  deferredRenderer->m_statistics.pixels = width * height;
+
+  auto lighting = SceneLighting::standard();
+  deferredRenderer->m_projector.position() = lighting.lightProjector.position;
+  deferredRenderer->m_projector.attitude() = lighting.lightProjector.direction;
   // deferredRenderer->projector.createTexture();
 
-  deferredRenderer->m_projectorPass0.position() = { 0, 30, 0 };
-  deferredRenderer->m_projectorPass0.attitude() = { -1, -1, 0 };
+  deferredRenderer->m_projectorPass0.position() = lighting.surfaceProjector.position;
+  deferredRenderer->m_projectorPass0.attitude() = lighting.surfaceProjector.direction;
   deferredRenderer->m_projectorPass0.createTexture();
 
+  deferredRenderer->m_lights = lighting.lights;
+
   if (!screen)
   {
     screen = std::make_unique<Screen>();
@@ -166,6 +249,12 @@ DeferredRenderer::~DeferredRenderer()
   glDeleteRenderbuffers(1, &colorBuffer(Names::Position));
   glDeleteRenderbuffers(1, &colorBuffer(Names::Normals));
   glDeleteRenderbuffers(1, &m_depthBuffer);
+  glDeleteQueries(static_cast<GLsizei>(QueryLatency * 2), &m_fragmentQueries[0][0]);
+  glDeleteBuffers(1, &m_drawIds);
+  if (!m_hiZQueries.empty())
+  {
+    glDeleteQueries(static_cast<GLsizei>(m_hiZQueries.size()), m_hiZQueries.data());
+  }
 }
 
 void DeferredRenderer::attach()
@@ -175,22 +264,680 @@ void DeferredRenderer::attach()
   glPushAttrib(GL_VIEWPORT_BIT);
   glViewport(0, 0, static_cast<GLsizei>(m_width), static_cast<GLsizei>(m_height));
 
+  // black, which is what SoftwareRenderer clears its G-buffer to as well
+  glClearColor(0, 0, 0, 1.0f);
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-  glClearColor(18.f / 255.f, 230.f / 255.f, 223.f / 255.f, 1.0f);
 
   glEnable(GL_DEPTH_TEST);
 
   glDrawBuffers(3, m_bufferTargets);
   
-  m_pass0->attach();
-
-  m_pass0->set("projectorData.position", glUniform3fv, 1, static_cast<const float*>(m_projectorPass0.position()));
-  m_pass0->set("projectorData.direction", glUniform3fv, 1, static_cast<const float*>(m_projectorPass0.attitude()));
-  m_pass0->set("projectorData.texture", glUniform1i, 0);
+  m_pass0->set("projectorTexture", glUniform1i, 0);
+  if (m_pass0Indirect->program())
+  {
+    m_pass0Indirect->set("projectorTexture", glUniform1i, 0);
+  }
   
   m_projectorPass0.draw(matrix4<float>(), matrix4<float>());
 }
 
+void DeferredRenderer::drawObjects(const std::vector<SceneObject*>& objects, const Camera& camera, const Visibility* visibility)
+{
+  using Clock = std::chrono::high_resolution_clock;
+
+  auto indirect = m_options.multiDrawIndirect && prepareIndirect(objects);
+
+  if (!visibility)
+  {
+    cull(objects, camera, m_visibility);
+    visibility = &m_visibility;
+  }
+  buildRenderQueue(objects, camera, *visibility);
+  auto written = writeFrameConstants(objects, camera, indirect);
+  if (written && indirect)
+  {
+    written = (!m_options.depthPrePass || writeIndirectCommands(RenderQueue::Pass::DepthPrePass)) && writeIndirectCommands(RenderQueue::Pass::GBuffer);
+  }
+  if (!written)
+  {
+    debugLogAt(LogLevel::Error, "DeferredRenderer: the uniform ring is full, frame % not drawn", m_frameIndex);
+    m_statistics.drawnObjects = 0;
+    m_statistics.drawCalls = 0;
+    return;
+  }
+
+  auto& prePassCommands = m_passCommands[static_cast<size_t>(RenderQueue::Pass::DepthPrePass)];
+  auto& gBufferCommands = m_passCommands[static_cast<size_t>(RenderQueue::Pass::GBuffer)];
+
+  // with a still camera and scene the queue comes out the same, and so would the streams
+  auto signature = commandsSignature(indirect, objects.size());
+  m_statistics.commandsReused = m_options.reuseCommands && m_commandsRecorded && signature == m_commandsSignature;
+  m_statistics.recordMilliseconds = 0.0;
+  if (!m_statistics.commandsReused)
+  {
+    PROFILE_SCOPE("Record commands");
+    auto recordStart = Clock::now();
+    prePassCommands.clear();
+    if (m_options.depthPrePass)
+    {
+      recordPass(RenderQueue::Pass::DepthPrePass, indirect, prePassCommands);
+    }
+    gBufferCommands.clear();
+    recordPass(RenderQueue::Pass::GBuffer, indirect, gBufferCommands);
+    m_statistics.recordMilliseconds = std::chrono::duration<double, std::milli>(Clock::now() - recordStart).count();
+
+    m_commandsSignature = signature;
+    m_commandsRecorded = true;
+  }
+  m_statistics.recordingThreads = m_jobSystem ? m_jobSystem->threadCount() : 1;
+  m_statistics.drawCalls = prePassCommands.draws() + gBufferCommands.draws();
+  m_statistics.commandBytes = prePassCommands.bytes() + gBufferCommands.bytes();
+
+  // read back the queries issued QueryLatency frames ago before their slot gets reused
+  collectStatistics();
+  auto slot = m_frameIndex % QueryLatency;
+
+  CommandBuffer::Context context;
+  context.ringBuffer = m_uniformRing->buffer();
+  context.ringBase = m_uniformRing->frameOffset();
+
+  PROFILE_SCOPE("Replay commands");
+  auto replayStart = Clock::now();
+  if (m_options.depthPrePass)
+  {
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthFunc(GL_LESS);
+
+    glBeginQuery(GL_SAMPLES_PASSED, m_fragmentQueries[slot][PrePass]);
+    prePassCommands.execute(context);
+    glEndQuery(GL_SAMPLES_PASSED);
+
+    // depth is final; every G-buffer fragment that survives is a visible one
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glDepthMask(GL_FALSE);
+    glDepthFunc(GL_EQUAL);
+  }
+
+  glBeginQuery(GL_SAMPLES_PASSED, m_fragmentQueries[slot][GBufferPass]);
+  gBufferCommands.execute(context);
+  glEndQuery(GL_SAMPLES_PASSED);
+
+  if (m_options.depthPrePass)
+  {
+    // glClear honors the depth mask, restore it for the next frame
+    glDepthMask(GL_TRUE);
+    glDepthFunc(GL_LESS);
+  }
+  m_statistics.replayMilliseconds = std::chrono::duration<double, std::milli>(Clock::now() - replayStart).count();
+
+  if (m_options.hiZCulling && m_hiZ)
+  {
+    drawDeferred(objects, camera);
+  }
+
+  m_queryPending[slot] = true;
+  m_queryPrePass[slot] = m_options.depthPrePass;
+  ++m_frameIndex;
+
+  OPENGL_CHECK_ERROR();
+}
+
+bool DeferredRenderer::writeFrameConstants(const std::vector<SceneObject*>& objects, const Camera& camera, bool indirect)
+{
+  auto frameSize = m_uniformRing->alignUp(sizeof(FrameConstants));
+  auto lightSize = m_uniformRing->alignUp(sizeof(LightConstants));
+  // a std430 array of Constants has no padding; single UBO bindings need every object on an aligned offset
+  m_objectConstantsStride = indirect ? sizeof(SceneObject::Constants) : m_uniformRing->alignUp(sizeof(SceneObject::Constants));
+  auto objectsSize = m_objectConstantsStride * objects.size();
+  // the indirect commands of both passes go into the ring as well
+  auto commandsSize = indirect ? 2 * (m_uniformRing->alignUp(objects.size() * sizeof(DrawElementsIndirectCommand))) : 0;
+  // the second phase draws one by one, out of aligned copies when the objects are packed
+  auto deferredSize = indirect ? m_deferredObjects.size() * m_uniformRing->alignUp(sizeof(SceneObject::Constants)) : 0;
+  // render() writes its own FrameData and LightData into the same region
+  auto frameBytes = 2 * (frameSize + lightSize) + m_uniformRing->alignUp(objectsSize) + commandsSize + deferredSize;
+  if (frameBytes > m_uniformRing->bytesPerFrame())
+  {
+    // the old buffer stays alive in the driver until the frames still using it retire
+    m_uniformRing = UniformRingBuffer::createUnique(frameBytes * 2);
+  }
+
+  m_uniformRing->beginFrame();
+  if (!writeFrameData(camera))
+  {
+    return false;
+  }
+
+  auto viewMatrix = camera.viewMatrix();
+  auto data = static_cast<uint8_t*>(m_uniformRing->allocate(objectsSize, m_objectConstantsOffset));
+  if (!data)
+  {
+    return false;
+  }
+
+  // every object owns its slot, the chunks can be written in any order
+  auto stride = m_objectConstantsStride;
+  parallelFor(objects.size(), ObjectsPerChunk, [&](size_t begin, size_t end)
+  {
+    for (auto i = begin; i < end; ++i)
+    {
+      objects[i]->constants(viewMatrix, *reinterpret_cast<SceneObject::Constants*>(data + i * stride));
+    }
+  });
+  m_uniformRing->flush();
+
+  if (indirect && objectsSize)
+  {
+    m_uniformRing->bindStorage(static_cast<GLuint>(StorageBlock::Objects), m_objectConstantsOffset, static_cast<GLsizeiptr>(objectsSize));
+  }
+  return true;
+}
+
+bool DeferredRenderer::writeFrameData(const Camera& camera)
+{
+  GLintptr frameOffset = 0, lightOffset = 0;
+  auto framePointer = static_cast<FrameConstants*>(m_uniformRing->allocate(sizeof(FrameConstants), frameOffset));
+  auto lightsPointer = static_cast<LightConstants*>(m_uniformRing->allocate(sizeof(LightConstants), lightOffset));
+  if (!framePointer || !lightsPointer)
+  {
+    return false;
+  }
+
+  auto viewMatrix = camera.viewMatrix();
+  auto projectionMatrix = camera.projectionMatrix();
+  auto& frame = *framePointer;
+  memcpy(frame.viewMatrix, viewMatrix.get_openglmatrix(), sizeof(frame.viewMatrix));
+  memcpy(frame.projectionMatrix, projectionMatrix.get_openglmatrix(), sizeof(frame.projectionMatrix));
+  memcpy(frame.inverseProjectionMatrix, projectionMatrix.inverse().get_openglmatrix(), sizeof(frame.inverseProjectionMatrix));
+  toVec4(camera.position(), 1.0f, frame.cameraPosition);
+  toVec4(m_projectorPass0.position(), 1.0f, frame.surfaceProjector[0]);
+  toVec4(m_projectorPass0.attitude(), 0.0f, frame.surfaceProjector[1]);
+  toVec4(m_projector.position(), 1.0f, frame.lightProjector[0]);
+  toVec4(m_projector.attitude(), 0.0f, frame.lightProjector[1]);
+
+  auto& lights = *lightsPointer;
+  for (size_t i = 0; i < NumLights; ++i)
+  {
+    toVec4(m_lights[i].position, 1.0f, lights.positions[i]);
+    toVec4(m_lights[i].color, 0.0f, lights.colors[i]);
+  }
+  m_uniformRing->flush();
+
+  m_uniformRing->bind(static_cast<GLuint>(UniformBlock::Frame), frameOffset, sizeof(FrameConstants));
+  m_uniformRing->bind(static_cast<GLuint>(UniformBlock::Lights), lightOffset, sizeof(LightConstants));
+  return true;
+}
+
+void DeferredRenderer::cull(const std::vector<SceneObject*>& objects, const Camera& camera, Visibility& visibility) const
+{
+  PROFILE_SCOPE("Cull");
+  auto viewMatrix = camera.viewMatrix();
+  Frustum frustum(viewMatrix * camera.projectionMatrix());
+  auto frustumCulling = m_options.frustumCulling;
+  auto sortFrontToBack = m_options.sortFrontToBack;
+
+  auto& viewDepths = visibility.viewDepths;
+  auto& distances = visibility.distances;
+  viewDepths.resize(objects.size());
+  distances.resize(objects.size());
+  parallelFor(objects.size(), ObjectsPerChunk, [&](size_t begin, size_t end)
+  {
+    for (auto i = begin; i < end; ++i)
+    {
+      auto object = objects[i];
+      // objects without a bound are never culled
+      if (frustumCulling && object->boundingRadius() > 0.0f && !frustum.intersectsSphere(object->position(), object->boundingRadius()))
+      {
+        viewDepths[i] = Visibility::Outside;
+        continue;
+      }
+      distances[i] = viewDepth(viewMatrix, object->position());
+      viewDepths[i] = sortFrontToBack ? std::max(distances[i], 0.0f) : 0.0f;
+    }
+  });
+
+  visibility.occluders = 0;
+  visibility.occlusionMilliseconds = 0.0;
+  if (m_options.occlusionCulling)
+  {
+    cullOccluded(objects, camera, visibility);
+  }
+
+  // what the last pyramid to come back hides waits for this frame's depth; the pyramid brings the camera it was
+  // rendered with, the boxes are projected through that one
+  auto pyramid = m_options.hiZCulling ? latestPyramid() : nullptr;
+  if (pyramid)
+  {
+    parallelFor(objects.size(), ObjectsPerChunk, [&](size_t begin, size_t end)
+    {
+      vector3<float> minimum, maximum;
+      for (auto i = begin; i < end; ++i)
+      {
+        auto object = objects[i];
+        if (viewDepths[i] < 0.0f || !object->meshData())
+        {
+          continue;
+        }
+        object->meshData()->bounds(minimum, maximum);
+        if (!pyramid->visible(minimum, maximum, object->transformMatrix()))
+        {
+          viewDepths[i] = Visibility::Deferred;
+        }
+      }
+    });
+  }
+}
+
+void DeferredRenderer::cullOccluded(const std::vector<SceneObject*>& objects, const Camera& camera, Visibility& visibility) const
+{
+  PROFILE_SCOPE("Occlusion");
+  using Clock = std::chrono::high_resolution_clock;
+  auto start = Clock::now();
+
+  auto& buffer = visibility.occlusionBuffer;
+  if (!buffer.width())
+  {
+    buffer.resize(OcclusionBuffer::DefaultWidth, OcclusionBuffer::DefaultHeight);
+  }
+  buffer.clear(camera.viewMatrix() * camera.projectionMatrix());
+
+  // the nearest meshes in front of the eye; ties go by index so that the pick doesn't depend on the order of the sort
+  auto& viewDepths = visibility.viewDepths;
+  auto& candidates = visibility.occluderCandidates;
+  candidates.clear();
+  for (size_t i = 0; i < objects.size(); ++i)
+  {
+    if (viewDepths[i] >= 0.0f && visibility.distances[i] > 0.0f && objects[i]->meshData())
+    {
+      candidates.emplace_back(visibility.distances[i], static_cast<uint32_t>(i));
+    }
+  }
+  auto numOccluders = std::min(MaxOccluders, candidates.size());
+  std::nth_element(candidates.begin(), candidates.begin() + numOccluders, candidates.end());
+
+  for (size_t c = 0; c < numOccluders; ++c)
+  {
+    auto object = objects[candidates[c].second];
+    buffer.rasterize(*object->meshData(), object->transformMatrix());
+  }
+
+  // the occluders themselves are drawn whatever the buffer says
+  parallelFor(candidates.size() - numOccluders, ObjectsPerChunk, [&](size_t begin, size_t end)
+  {
+    for (auto c = numOccluders + begin; c < numOccluders + end; ++c)
+    {
+      auto i = candidates[c].second;
+      auto object = objects[i];
+      if (!buffer.visible(*object->meshData(), object->transformMatrix()))
+      {
+        viewDepths[i] = Visibility::Occluded;
+      }
+    }
+  });
+
+  visibility.occluders = numOccluders;
+  visibility.occlusionMilliseconds = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+void DeferredRenderer::buildRenderQueue(const std::vector<SceneObject*>& objects, const Camera& camera, const Visibility& visibility)
+{
+  auto farPlane = camera.mode() == Camera::Mode::PERSPECTIVE ? camera.perspectiveData().farPlane : camera.parallelData().zFar;
+
+  // the tests ran in parallel, the queue is filled in object order so that it comes out the same
+  m_renderQueue.clear();
+  m_statistics.culledObjects = 0;
+  m_statistics.occludedObjects = 0;
+  m_statistics.occluders = visibility.occluders;
+  m_statistics.occlusionMilliseconds = visibility.occlusionMilliseconds;
+  m_deferredObjects.clear();
+  for (size_t i = 0; i < objects.size(); ++i)
+  {
+    auto object = objects[i];
+    auto index = static_cast<uint32_t>(i);
+
+    auto depth = visibility.viewDepths[i];
+    if (depth == Visibility::Deferred)
+    {
+      m_deferredObjects.push_back(index);
+      continue;
+    }
+    if (depth < 0.0f)
+    {
+      ++m_statistics.culledObjects;
+      m_statistics.occludedObjects += depth == Visibility::Occluded ? 1 : 0;
+      continue;
+    }
+
+    auto program = object->shader() ? object->shader()->program() : 0;
+
+    // the pre-pass has no state worth grouping by, it goes purely front to back
+    if (m_options.depthPrePass)
+    {
+      m_renderQueue.push(RenderQueue::makeKey(RenderQueue::Pass::DepthPrePass, 0, 0, depth, farPlane), object, index);
+    }
+    m_renderQueue.push(RenderQueue::makeKey(RenderQueue::Pass::GBuffer, program, object->meshID(), depth, farPlane), object, index);
+  }
+
+  m_renderQueue.sort();
+  m_statistics.hiZDeferred = m_deferredObjects.size();
+  m_statistics.drawnObjects = objects.size() - m_statistics.culledObjects - m_statistics.hiZDeferred;
+}
+
+void DeferredRenderer::drawDeferred(const std::vector<SceneObject*>& objects, const Camera& camera)
+{
+  PROFILE_SCOPE("Hi-Z second phase");
+  auto viewMatrix = camera.viewMatrix();
+  auto viewProjection = viewMatrix * camera.projectionMatrix();
+  m_hiZ->build(m_gBuffer, viewProjection);
+
+  auto numDeferred = m_deferredObjects.size();
+  if (numDeferred)
+  {
+    if (m_hiZQueries.size() < numDeferred)
+    {
+      auto first = m_hiZQueries.size();
+      m_hiZQueries.resize(numDeferred);
+      glGenQueries(static_cast<GLsizei>(numDeferred - first), &m_hiZQueries[first]);
+    }
+
+    // one point per box, landing on screen when the pyramid doesn't hide the box; nothing is written
+    glDisable(GL_DEPTH_TEST);
+    glDepthMask(GL_FALSE);
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, m_hiZ->texture());
+    glActiveTexture(GL_TEXTURE0);
+    m_hiZTest->attach();
+    m_hiZTest->set("hiZ", glUniform1i, 1);
+    m_hiZTest->set("size", glUniform2f, static_cast<float>(m_width), static_cast<float>(m_height));
+    vector3<float> minimum, maximum;
+    for (size_t k = 0; k < numDeferred; ++k)
+    {
+      auto object = objects[m_deferredObjects[k]];
+      object->meshData()->bounds(minimum, maximum);
+      auto modelViewProjection = object->transformMatrix() * viewProjection;
+      m_hiZTest->set("modelViewProjection", glUniformMatrix4fv, 1, static_cast<GLboolean>(GL_FALSE), modelViewProjection.get_openglmatrix());
+      m_hiZTest->set("boundsMin", glUniform3f, minimum.x, minimum.y, minimum.z);
+      m_hiZTest->set("boundsMax", glUniform3f, maximum.x, maximum.y, maximum.z);
+      glBeginQuery(GL_ANY_SAMPLES_PASSED, m_hiZQueries[k]);
+      glDrawArrays(GL_POINTS, 0, 1);
+      glEndQuery(GL_ANY_SAMPLES_PASSED);
+    }
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glDepthMask(GL_TRUE);
+    glEnable(GL_DEPTH_TEST);
+
+    // packed constants can't be bound one object at a time, those objects get an aligned copy
+    auto aligned = m_uniformRing->alignUp(m_objectConstantsStride) == m_objectConstantsStride;
+    auto alignedStride = m_uniformRing->alignUp(sizeof(SceneObject::Constants));
+    GLintptr copies = 0;
+    if (!aligned)
+    {
+      auto data = static_cast<uint8_t*>(m_uniformRing->allocate(numDeferred * alignedStride, copies));
+      if (data)
+      {
+        for (size_t k = 0; k < numDeferred; ++k)
+        {
+          objects[m_deferredObjects[k]]->constants(viewMatrix, *reinterpret_cast<SceneObject::Constants*>(data + k * alignedStride));
+        }
+        m_uniformRing->flush();
+      }
+      else
+      {
+        debugLogAt(LogLevel::Error, "DeferredRenderer: the uniform ring is full, % deferred objects not drawn", numDeferred);
+        numDeferred = 0;
+      }
+    }
+
+    // the GPU skips the draws whose test came out empty, the CPU never waits on a result
+    for (size_t k = 0; k < numDeferred; ++k)
+    {
+      auto object = objects[m_deferredObjects[k]];
+      auto offset = aligned ? m_objectConstantsOffset + static_cast<GLintptr>(m_deferredObjects[k] * m_objectConstantsStride) : copies + static_cast<GLintptr>(k * alignedStride);
+      object->shader()->attach();
+      m_uniformRing->bind(static_cast<GLuint>(UniformBlock::Object), offset, sizeof(SceneObject::Constants));
+      glBeginConditionalRender(m_hiZQueries[k], GL_QUERY_WAIT);
+      object->drawMesh();
+      glEndConditionalRender();
+    }
+  }
+
+  // the pyramid of some earlier frame is done copying out; the next cull() goes by it
+  auto pyramid = m_hiZ->read();
+  if (pyramid)
+  {
+    std::lock_guard<std::mutex> lock(m_pyramidMutex);
+    m_pyramid = std::move(pyramid);
+  }
+  OPENGL_CHECK_ERROR();
+}
+
+bool DeferredRenderer::prepareIndirect(const std::vector<SceneObject*>& objects)
+{
+  if (!glMultiDrawElementsIndirect || !m_pass0Indirect->program() || !m_depthPrePassIndirect->program())
+  {
+    return false;
+  }
+
+  // every mesh already sits in the geometry arena, only objects without one can't go indirect
+  for (auto object : objects)
+  {
+    auto mesh = object->mesh();
+    if (!mesh || mesh->geometry() == GeometryArena::InvalidHandle)
+    {
+      return false;
+    }
+  }
+
+  if (m_drawIdCapacity < objects.size())
+  {
+    m_drawIdCapacity = objects.size() * 2;
+    std::vector<GLuint> drawIds(m_drawIdCapacity);
+    for (size_t i = 0; i < drawIds.size(); ++i)
+    {
+      drawIds[i] = static_cast<GLuint>(i);
+    }
+    if (!m_drawIds)
+    {
+      glGenBuffers(1, &m_drawIds);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, m_drawIds);
+    glBufferData(GL_ARRAY_BUFFER, drawIds.size() * sizeof(GLuint), drawIds.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+  }
+
+  return true;
+}
+
+bool DeferredRenderer::writeIndirectCommands(RenderQueue::Pass pass)
+{
+  auto& batches = m_indirectBatches[static_cast<size_t>(pass)];
+  for (auto& batch : batches)
+  {
+    batch.commands.clear();
+  }
+
+  // one command list per draw mode, each in queue order
+  size_t numCommands = 0;
+  m_renderQueue.submit(pass, [&](const RenderQueue::Item& item)
+  {
+    auto mesh = item.object->mesh();
+    const auto& range = GeometryArena::instance().range(mesh->geometry());
+    const auto& mode = mesh->mode();
+
+    auto batch = std::find_if(batches.begin(), batches.end(), [&mode](const IndirectBatch& batch)
+    {
+      return batch.mode.drawMode == mode.drawMode && batch.mode.fillMode == mode.fillMode && batch.mode.faceMode == mode.faceMode;
+    });
+    if (batch == batches.end())
+    {
+      batches.push_back({ mode, {}, 0 });
+      batch = batches.end() - 1;
+    }
+
+    batch->commands.push_back({ static_cast<GLuint>(range.numIndices), 1, static_cast<GLuint>(range.firstIndex), static_cast<GLint>(range.firstVertex), item.index });
+    ++numCommands;
+  });
+
+  if (!numCommands)
+  {
+    return true;
+  }
+
+  GLintptr offset = 0;
+  auto commands = static_cast<DrawElementsIndirectCommand*>(m_uniformRing->allocate(numCommands * sizeof(DrawElementsIndirectCommand), offset));
+  if (!commands)
+  {
+    return false;
+  }
+  offset -= m_uniformRing->frameOffset();
+  for (auto& batch : batches)
+  {
+    memcpy(commands, batch.commands.data(), batch.commands.size() * sizeof(DrawElementsIndirectCommand));
+    commands += batch.commands.size();
+    batch.offset = offset;
+    offset += batch.commands.size() * sizeof(DrawElementsIndirectCommand);
+  }
+  m_uniformRing->flush();
+  return true;
+}
+
+void DeferredRenderer::recordPass(RenderQueue::Pass pass, bool indirect, CommandBuffer& commands)
+{
+  auto prePass = pass == RenderQueue::Pass::DepthPrePass;
+
+  commands.bindGeometry();
+
+  if (indirect)
+  {
+    // every object goes through the indirect variant of the pass's program, whatever program it was given
+    commands.useProgram(prePass ? m_depthPrePassIndirect->program() : m_pass0Indirect->program());
+    commands.bindDrawIds(m_drawIds);
+    for (const auto& batch : m_indirectBatches[static_cast<size_t>(pass)])
+    {
+      if (batch.commands.empty())
+      {
+        continue;
+      }
+      commands.polygonMode(batch.mode.faceMode, batch.mode.fillMode);
+      commands.multiDrawElementsIndirect(batch.mode.drawMode, batch.offset, static_cast<GLsizei>(batch.commands.size()));
+    }
+    commands.unbindDrawIds();
+    return;
+  }
+
+  if (prePass)
+  {
+    commands.useProgram(m_depthPrePass->program());
+  }
+
+  auto items = m_renderQueue.range(pass);
+  auto numItems = static_cast<size_t>(items.second - items.first);
+  auto numChunks = (numItems + ObjectsPerChunk - 1) / ObjectsPerChunk;
+  if (m_chunkCommands.size() < numChunks)
+  {
+    m_chunkCommands.resize(numChunks);
+  }
+
+  parallelFor(numItems, ObjectsPerChunk, [&](size_t first, size_t last)
+  {
+    PROFILE_SCOPE("Record chunk");
+    auto chunk = first / ObjectsPerChunk;
+    auto begin = items.first + first;
+    auto end = items.first + last;
+    // a chunk picks up the program where the previous one left it, as a single recording would
+    GLuint program = 0;
+    if (!prePass && begin != items.first)
+    {
+      program = (begin - 1)->object->shader()->program();
+    }
+
+    auto& chunkCommands = m_chunkCommands[chunk];
+    chunkCommands.clear();
+    recordItems(begin, end, program, prePass, chunkCommands);
+  });
+
+  for (size_t chunk = 0; chunk < numChunks; ++chunk)
+  {
+    commands.append(m_chunkCommands[chunk]);
+  }
+}
+
+void DeferredRenderer::recordItems(const RenderQueue::Item* begin, const RenderQueue::Item* end, GLuint program, bool prePass, CommandBuffer& commands) const
+{
+  // the queue groups the G-buffer items by program, so switching only happens at group boundaries
+  auto objectConstants = m_objectConstantsOffset - m_uniformRing->frameOffset();
+  for (auto item = begin; item != end; ++item)
+  {
+    if (!prePass && item->object->shader()->program() != program)
+    {
+      program = item->object->shader()->program();
+      commands.useProgram(program);
+    }
+    auto offset = objectConstants + static_cast<GLintptr>(item->index * m_objectConstantsStride);
+    commands.bindRingRange(GL_UNIFORM_BUFFER, static_cast<GLuint>(UniformBlock::Object), offset, sizeof(SceneObject::Constants));
+    item->object->recordMesh(commands);
+  }
+}
+
+uint64_t DeferredRenderer::commandsSignature(bool indirect, size_t numObjects) const
+{
+  uint64_t signature = fnv1a(FnvBasis, &indirect, sizeof(indirect));
+  signature = fnv1a(signature, &m_options.depthPrePass, sizeof(m_options.depthPrePass));
+  signature = fnv1a(signature, &numObjects, sizeof(numObjects));
+  signature = fnv1a(signature, &m_objectConstantsStride, sizeof(m_objectConstantsStride));
+
+  // ranges baked into the draws move when the arena gets defragmented
+  auto generation = GeometryArena::instance().generation();
+  signature = fnv1a(signature, &generation, sizeof(generation));
+
+  // the sorted queue: program, mesh and order of every draw
+  for (const auto& item : m_renderQueue.items())
+  {
+    signature = fnv1a(signature, &item.key, sizeof(item.key));
+    signature = fnv1a(signature, &item.index, sizeof(item.index));
+  }
+
+  for (const auto& batches : m_indirectBatches)
+  {
+    for (const auto& batch : batches)
+    {
+      auto size = batch.commands.size();
+      signature = fnv1a(signature, &batch.offset, sizeof(batch.offset));
+      signature = fnv1a(signature, &size, sizeof(size));
+    }
+  }
+
+  return signature;
+}
+
+void DeferredRenderer::collectStatistics()
+{
+  auto slot = m_frameIndex % QueryLatency;
+  if (!m_queryPending[slot])
+  {
+    return;
+  }
+
+  // never stall on the GPU; if the results are late just keep the previous numbers
+  GLuint available = GL_FALSE;
+  glGetQueryObjectuiv(m_fragmentQueries[slot][GBufferPass], GL_QUERY_RESULT_AVAILABLE, &available);
+  if (!available)
+  {
+    return;
+  }
+
+  glGetQueryObjectuiv(m_fragmentQueries[slot][GBufferPass], GL_QUERY_RESULT, &m_statistics.gBufferFragments);
+  m_statistics.prePassFragments = 0;
+  if (m_queryPrePass[slot])
+  {
+    glGetQueryObjectuiv(m_fragmentQueries[slot][PrePass], GL_QUERY_RESULT, &m_statistics.prePassFragments);
+  }
+  m_queryPending[slot] = false;
+}
+
 void DeferredRenderer::detach()
 {
   glActiveTexture(GL_TEXTURE0);
@@ -313,32 +1060,22 @@ void DeferredRenderer::render(const Camera& camera)
   glEnable(GL_TEXTURE_2D);
   glBindTexture(GL_TEXTURE_2D, texture(Names::Normals));
 
-  vector3<float> lightPosition[3] = {
-    { 10, 30, 0 },
-    { -40, 30, 45 },
-    { 60, 25, -40 }
-  };
-  vector3<float> lightColors[3] = {
-    { 1, 1, 0 },
-    { 1, 0, 1 },
-    { 0, 1, 1 }
-  };
+  // camera, projectors and lights come from the FrameData / LightData blocks, written again for this camera;
+  // without a drawObjects() before it the ring region is opened here, and ended below either way
+  if (!m_uniformRing->open())
+  {
+    m_uniformRing->beginFrame();
+  }
+  if (!writeFrameData(camera))
+  {
+    debugLogAt(LogLevel::Error, "DeferredRenderer: the uniform ring is full, lighting with the camera of drawObjects()");
+  }
 
-  auto camTransform = camera.viewMatrix();
-  
-  m_pass1->set("projectorData.position", glUniform3fv, 1, static_cast<const float*>(m_projector.position()));
-  m_pass1->set("projectorData.direction", glUniform3fv, 1, static_cast<const float*>(m_projector.attitude()));
-  m_pass1->set("projectorData.texture", glUniform1i, 3);
+  m_pass1->set("projectorTexture", glUniform1i, 3);
   m_projector.draw(projection, modelView);
 
   m_pass1->set("projectionMatrix", glUniformMatrix4fv, 1, static_cast<GLboolean>(GL_FALSE), projection);
   m_pass1->set("modelViewMatrix", glUniformMatrix4fv, 1, static_cast<GLboolean>(GL_FALSE), modelView);
-  m_pass1->set("lights[0]", glUniform3fv, 1, static_cast<const float*>(lightPosition[0]));
-  m_pass1->set("lights[1]", glUniform3fv, 1, static_cast<const float*>(lightPosition[1]));
-  m_pass1->set("lights[2]", glUniform3fv, 1, static_cast<const float*>(lightPosition[2]));
-  m_pass1->set("lightColors[0]", glUniform3fv, 1, static_cast<const float*>(lightColors[0]));
-  m_pass1->set("lightColors[1]", glUniform3fv, 1, static_cast<const float*>(lightColors[1]));
-  m_pass1->set("lightColors[2]", glUniform3fv, 1, static_cast<const float*>(lightColors[2]));
 
   screen->draw();
   m_pass1->detach();
@@ -355,4 +1092,7 @@ void DeferredRenderer::render(const Camera& camera)
   glActiveTexture(GL_TEXTURE0);
   glBindTexture(GL_TEXTURE_2D, 0);
   glDisable(GL_TEXTURE_2D);
+
+  // the ring region of this frame is read up to here
+  m_uniformRing->endFrame();
 }
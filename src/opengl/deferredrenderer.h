@@ -1,13 +1,25 @@
 #pragma once
 
-#include <Windows.h>
-#include <gl/GL.h>
+#include "glplatform.h"
 
+#include <array>
 #include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
 #include "shaders.h"
 #include "VertexBufferObject.h"
 #include "camera.h"
 #include "projector.h"
+#include "sceneobject.h"
+#include "renderqueue.h"
+#include "uniformringbuffer.h"
+#include "frustum.h"
+#include "occlusionbuffer.h"
+#include "hizbuffer.h"
+#include "commandbuffer.h"
+#include "scenelighting.h"
+#include "../utils/jobsystem.h"
 
 class DeferredRenderer
 {
@@ -20,6 +32,58 @@ public:
     Num,
   };
 
+  struct Options
+  {
+    bool depthPrePass = false;      // lay down depth with a position-only program, then fill the G-buffer with GL_EQUAL
+    bool sortFrontToBack = true;    // sort by view depth within each program / mesh group
+    bool frustumCulling = true;     // skip objects whose bounding sphere is outside the view frustum
+    bool occlusionCulling = false;  // rasterize the nearest objects into a small CPU depth buffer, skip what they hide
+    bool multiDrawIndirect = false; // draw each pass with glMultiDrawElementsIndirect straight out of the geometry arena (GL 4.3)
+    bool reuseCommands = true;      // replay the last recording while the queue stays the same
+    bool hiZCulling = false;        // defer what the last read back Hi-Z pyramid hides until this frame's depth is in
+  };
+
+  // fragment counts of the most recent frame whose occlusion queries came back
+  struct Statistics
+  {
+    GLuint prePassFragments = 0;
+    GLuint gBufferFragments = 0;
+    size_t pixels = 0;
+
+    // of the last frame
+    size_t drawnObjects = 0;
+    size_t culledObjects = 0;         // outside the frustum or occluded
+    size_t occludedObjects = 0;
+    size_t occluders = 0;
+    double occlusionMilliseconds = 0.0; // occluders and tests, on the thread that culled
+    size_t hiZDeferred = 0;           // hidden by an earlier frame's pyramid, drawn after the G-buffer pass if this one's says so
+    size_t drawCalls = 0;
+    size_t commandBytes = 0;          // recorded streams of both passes
+    bool commandsReused = false;      // the streams of the previous frame were replayed as they were
+    double recordMilliseconds = 0.0;  // building the streams, no GL involved
+    size_t recordingThreads = 0;
+    double replayMilliseconds = 0.0;  // issuing them, i.e. the time spent in the driver
+
+    // fragments written to the G-buffer per screen pixel; with the pre-pass on this drops to the coverage (<= 1)
+    float overdrawRatio() const
+    {
+      return pixels ? static_cast<float>(gBufferFragments) / static_cast<float>(pixels) : 0.0f;
+    }
+
+    // fragments the G-buffer pass would have shaded without the pre-pass, per fragment it actually shaded
+    float prePassSavings() const
+    {
+      return gBufferFragments ? static_cast<float>(prePassFragments) / static_cast<float>(gBufferFragments) : 0.0f;
+    }
+  };
+
+  static const size_t QueryLatency = 3; // frames between issuing a query and reading it back
+
+  static const size_t NumLights = SceneLighting::NumLights;
+
+  using Light = SceneLighting::Light;
+  using Lights = SceneLighting::Lights;
+
   static std::unique_ptr<DeferredRenderer> createUnique(size_t width, size_t height, size_t antialiasing);
 
   DeferredRenderer()
@@ -31,7 +95,17 @@ public:
     m_depthBuffer = 0;
     m_width = 0;
     m_height = 0;
-
+    memset(m_fragmentQueries, 0, sizeof(m_fragmentQueries));
+    memset(m_queryPending, 0, sizeof(m_queryPending));
+    memset(m_queryPrePass, 0, sizeof(m_queryPrePass));
+    m_frameIndex = 0;
+    m_objectConstantsOffset = 0;
+    m_objectConstantsStride = 0;
+    m_drawIds = 0;
+    m_drawIdCapacity = 0;
+    m_commandsSignature = 0;
+    m_commandsRecorded = false;
+    m_jobSystem = nullptr;
   }
 
   ~DeferredRenderer();
@@ -40,6 +114,35 @@ public:
 
   void detach();
 
+  // what frustum and occlusion culling leave of a frame's objects
+  struct Visibility
+  {
+    static constexpr float Outside = -1.0f;
+    static constexpr float Occluded = -2.0f;
+    static constexpr float Deferred = -3.0f;  // hidden by the Hi-Z pyramid of an earlier frame, tested again in this one
+
+    std::vector<float> viewDepths;  // per object, Outside or Occluded when culled, Deferred when left for later
+    size_t occluders = 0;
+    double occlusionMilliseconds = 0.0;
+
+    // cull()'s scratch, kept to reuse its storage
+    OcclusionBuffer occlusionBuffer;
+    std::vector<float> distances;   // from the eye per object inside the frustum, for picking the occluders
+    std::vector<std::pair<float, uint32_t>> occluderCandidates;
+  };
+
+  // reads only the options, the objects and the camera, so it may run on another thread ahead of drawObjects()
+  void cull(const std::vector<SceneObject*>& objects, const Camera& camera, Visibility& visibility) const;
+
+  // with Options::occlusionCulling, after the frustum test: the nearest visible meshes are rasterized into the
+  // visibility's occlusion buffer and every other mesh's bounding box is tested against them
+  void cullOccluded(const std::vector<SceneObject*>& objects, const Camera& camera, Visibility& visibility) const;
+
+  // fills the G-buffer with the given objects; call between attach() and detach(), and follow with render().
+  // culls the objects itself unless given the result of cull() for the same objects and camera.
+  // with Options::hiZCulling in two phases: the objects cull() didn't defer, then the Hi-Z pyramid of their depth,
+  // then the deferred objects it doesn't hide
+  void drawObjects(const std::vector<SceneObject*>& objects, const Camera& camera, const Visibility* visibility = nullptr);
 
   const GLuint& texture(Names name) const
   {
@@ -61,9 +164,102 @@ public:
     return m_pass0.get();
   }
 
+  // lights the G-buffer as seen from the camera, normally the one of the drawObjects() before it;
+  // ends the frame's region of the uniform ring
   void render(const Camera& camera);
 
+  const Statistics& statistics() const
+  {
+    return m_statistics;
+  }
+
+  DECLARE_PROTECTED_TRIVIAL_ATTRIBUTE(Options, options);
+  DECLARE_PROTECTED_TRIVIAL_ATTRIBUTE(Lights, lights);
+
+public:
+  // culling, object constants and recording are spread over it; not owned, may be null
+  JobSystem*& jobSystem()
+  {
+    return m_jobSystem;
+  }
+
 protected:
+  // std140 mirror of the FrameData block
+  struct FrameConstants
+  {
+    float viewMatrix[16];
+    float projectionMatrix[16];
+    float inverseProjectionMatrix[16];
+    float cameraPosition[4];
+    float surfaceProjector[2][4];   // position, direction
+    float lightProjector[2][4];
+  };
+
+  // std140 mirror of the LightData block
+  struct LightConstants
+  {
+    float positions[NumLights][4];
+    float colors[NumLights][4];
+  };
+
+  void buildRenderQueue(const std::vector<SceneObject*>& objects, const Camera& camera, const Visibility& visibility);
+
+  // the second phase: builds the Hi-Z pyramid of the G-buffer's depth, tests the deferred objects against it with
+  // occlusion queries and draws each under its query's conditional render; then picks up a finished readback
+  void drawDeferred(const std::vector<SceneObject*>& objects, const Camera& camera);
+
+  // the newest pyramid read back, or null; cull() may run on another thread than drawObjects()
+  std::shared_ptr<const HiZPyramid> latestPyramid() const
+  {
+    std::lock_guard<std::mutex> lock(m_pyramidMutex);
+    return m_pyramid;
+  }
+
+  // writes the frame's uniform data into the ring: FrameData and LightData, which stay bound until render(),
+  // then every object's constants in one linear pass, in the order of the objects vector.
+  // indirect draws read the objects as one tightly packed storage block instead. false if the ring had no room
+  bool writeFrameConstants(const std::vector<SceneObject*>& objects, const Camera& camera, bool indirect);
+
+  // FrameData and LightData for the camera, written into the ring's open region and bound; false if it had no room
+  bool writeFrameData(const Camera& camera);
+
+  // false if some object can't be drawn indirectly
+  bool prepareIndirect(const std::vector<SceneObject*>& objects);
+
+  // sorts the pass's items into one DrawElementsIndirectCommand list per draw mode and writes them into the ring;
+  // false if the ring had no room
+  bool writeIndirectCommands(RenderQueue::Pass pass);
+
+  // the GL work of one pass as a command stream; only reads the queue, the indirect batches and the ring layout.
+  // the direct draw list is cut in chunks recorded on the job system and appended in queue order, so the stream
+  // comes out the same whatever the number of threads
+  void recordPass(RenderQueue::Pass pass, bool indirect, CommandBuffer& commands);
+
+  // the draws of items [begin, end) of a pass; program is the one bound before the first of them
+  void recordItems(const RenderQueue::Item* begin, const RenderQueue::Item* end, GLuint program, bool prePass, CommandBuffer& commands) const;
+
+  // function(begin, end) over [0, count) on the job system, or inline without one
+  template<typename Function>
+  void parallelFor(size_t count, size_t grain, const Function& function) const
+  {
+    if (m_jobSystem)
+    {
+      m_jobSystem->parallelFor(count, grain, function);
+    }
+    else
+    {
+      // the job system's ranges, recordPass() keeps a command buffer per range
+      for (size_t begin = 0; begin < count; begin += grain)
+      {
+        function(begin, begin + grain < count ? begin + grain : count);
+      }
+    }
+  }
+
+  // everything the recorded streams depend on; equal signatures mean the last recording can be replayed
+  uint64_t commandsSignature(bool indirect, size_t numObjects) const;
+
+  void collectStatistics();
 
   // Do not use Names::Num :)
   GLuint& texture(Names name) 
@@ -91,7 +287,60 @@ protected:
 
   std::unique_ptr<Shader> m_pass0;
   std::unique_ptr<Shader> m_pass1;
+  std::unique_ptr<Shader> m_depthPrePass;
 
   Projector m_projector;
   Projector m_projectorPass0;
+
+  RenderQueue m_renderQueue;
+
+  // layout fixed by glMultiDrawElementsIndirect
+  struct DrawElementsIndirectCommand
+  {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;  // the object's index; reaches the shader through the drawId attribute
+  };
+
+  struct IndirectBatch
+  {
+    VertexBufferObject::Mode mode;
+    std::vector<DrawElementsIndirectCommand> commands;
+    GLintptr offset;  // of the commands in the ring, relative to the frame region
+  };
+
+  std::unique_ptr<Shader> m_pass0Indirect;
+  std::unique_ptr<Shader> m_depthPrePassIndirect;
+  std::vector<IndirectBatch> m_indirectBatches[static_cast<size_t>(RenderQueue::Pass::Num)];
+  GLuint m_drawIds;         // 0, 1, 2 ... one per object, read per instance
+  size_t m_drawIdCapacity;
+
+  std::unique_ptr<UniformRingBuffer> m_uniformRing;
+  GLintptr m_objectConstantsOffset;   // this frame's first object in the ring
+  size_t m_objectConstantsStride;     // SceneObject::Constants padded to the UBO offset alignment
+
+  // [frame slot][0 - pre-pass, 1 - G-buffer pass] GL_SAMPLES_PASSED queries
+  GLuint m_fragmentQueries[QueryLatency][2];
+  bool m_queryPending[QueryLatency];
+  bool m_queryPrePass[QueryLatency];
+  size_t m_frameIndex;
+
+  CommandBuffer m_passCommands[static_cast<size_t>(RenderQueue::Pass::Num)];
+  std::vector<CommandBuffer> m_chunkCommands;   // one per chunk, kept to reuse their storage
+  Visibility m_visibility;    // when drawObjects() has to cull
+  uint64_t m_commandsSignature;
+  bool m_commandsRecorded;
+
+  std::unique_ptr<HiZBuffer> m_hiZ;
+  std::unique_ptr<Shader> m_hiZTest;
+  std::vector<uint32_t> m_deferredObjects;  // indices of this frame's Visibility::Deferred objects
+  std::vector<GLuint> m_hiZQueries;         // GL_ANY_SAMPLES_PASSED, one per deferred object
+  std::shared_ptr<const HiZPyramid> m_pyramid;
+  mutable std::mutex m_pyramidMutex;
+
+  Statistics m_statistics;
+
+  JobSystem* m_jobSystem;
 };
\ No newline at end of file
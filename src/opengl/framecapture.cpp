@@ -0,0 +1,179 @@
+#include "framecapture.h"
+#include "glutils.h"
+
+#include <chrono>
+#include <cstring>
+
+#include "../software/framesink.h"
+#include "../utils/debugout.h"
+#include "../utils/profiler.h"
+
+namespace {
+  // a second at a time, with a log line each, rather than forever on a lost context
+  const GLuint64 WaitNanoseconds = 1000000000;
+}
+
+std::unique_ptr<FrameCapture> FrameCapture::createUnique(size_t width, size_t height, FrameSink* sink)
+{
+  auto capture = std::make_unique<FrameCapture>();
+  capture->m_width = width;
+  capture->m_height = height;
+  capture->m_sink = sink;
+
+  // RGBA is what drivers read back without converting; the sinks drop the alpha
+  glGenRenderbuffers(1, &capture->m_color);
+  glBindRenderbuffer(GL_RENDERBUFFER, capture->m_color);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, static_cast<GLsizei>(width), static_cast<GLsizei>(height));
+  glGenRenderbuffers(1, &capture->m_depth);
+  glBindRenderbuffer(GL_RENDERBUFFER, capture->m_depth);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, static_cast<GLsizei>(width), static_cast<GLsizei>(height));
+  glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+  glGenFramebuffers(1, &capture->m_framebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, capture->m_framebuffer);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, capture->m_color);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, capture->m_depth);
+  GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  if (status != GL_FRAMEBUFFER_COMPLETE)
+  {
+    debugLog("Frame capture initialization failed.");
+    return std::unique_ptr<FrameCapture>();
+  }
+
+  for (auto& readback : capture->m_readbacks)
+  {
+    glGenBuffers(1, &readback.buffer);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+    glBufferData(GL_PIXEL_PACK_BUFFER, static_cast<GLsizeiptr>(width * height * 4), nullptr, GL_STREAM_READ);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  OPENGL_CHECK_ERROR();
+
+  return capture;
+}
+
+FrameCapture::~FrameCapture()
+{
+  if (haveOpenGLContext())
+  {
+    for (auto& readback : m_readbacks)
+    {
+      if (readback.fence)
+      {
+        glDeleteSync(readback.fence);
+      }
+      glDeleteBuffers(1, &readback.buffer);
+    }
+    glDeleteFramebuffers(1, &m_framebuffer);
+    glDeleteRenderbuffers(1, &m_depth);
+    glDeleteRenderbuffers(1, &m_color);
+  }
+}
+
+void FrameCapture::attach()
+{
+  glPushAttrib(GL_VIEWPORT_BIT);
+  glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+  glViewport(0, 0, static_cast<GLsizei>(m_width), static_cast<GLsizei>(m_height));
+}
+
+void FrameCapture::detach()
+{
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  glPopAttrib();
+}
+
+void FrameCapture::capture(const std::string& path)
+{
+  // only still there after finish() wasn't called and the ring wrapped; the frame two back is handed over below
+  auto& readback = m_readbacks[m_frame % ReadbackFrames];
+  if (readback.fence)
+  {
+    complete(readback);
+  }
+
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffer);
+  glReadBuffer(GL_COLOR_ATTACHMENT0);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+  glReadPixels(0, 0, static_cast<GLsizei>(m_width), static_cast<GLsizei>(m_height), GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+  readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  readback.path = path;
+  ++m_frame;
+  ++m_statistics.captured;
+
+  auto& oldest = m_readbacks[m_frame % ReadbackFrames];
+  if (oldest.fence)
+  {
+    complete(oldest);
+  }
+  OPENGL_CHECK_ERROR();
+}
+
+void FrameCapture::finish()
+{
+  for (size_t age = 0; age < ReadbackFrames; ++age)
+  {
+    auto& readback = m_readbacks[(m_frame + age) % ReadbackFrames];
+    if (readback.fence)
+    {
+      complete(readback);
+    }
+  }
+}
+
+void FrameCapture::complete(Readback& readback)
+{
+  PROFILE_SCOPE("Map readback");
+  using Clock = std::chrono::high_resolution_clock;
+  auto start = Clock::now();
+
+  auto result = glClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+  if (result == GL_TIMEOUT_EXPIRED)
+  {
+    ++m_statistics.stalls;
+    while ((result = glClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT, WaitNanoseconds)) == GL_TIMEOUT_EXPIRED)
+    {
+      debugLog(">>> Frame capture: still waiting for the readback of %", readback.path);
+    }
+  }
+  glDeleteSync(readback.fence);
+  readback.fence = nullptr;
+  if (result == GL_WAIT_FAILED)
+  {
+    debugLog(">>> Frame capture: waiting for the readback of % failed, the frame is dropped", readback.path);
+    return;
+  }
+
+  // before mapping, a sink that is behind is waited for with nothing held
+  auto frame = m_sink->acquire();
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+  auto pixels = static_cast<const uint8_t*>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, static_cast<GLsizeiptr>(m_width * m_height * 4), GL_MAP_READ_BIT));
+  if (pixels)
+  {
+    // GL's rows go bottom up, the frame's top down
+    auto rowBytes = m_width * 4;
+    frame->width = m_width;
+    frame->height = m_height;
+    frame->rgba.resize(m_height * rowBytes);
+    for (size_t y = 0; y < m_height; ++y)
+    {
+      std::memcpy(frame->rgba.data() + y * rowBytes, pixels + (m_height - 1 - y) * rowBytes, rowBytes);
+    }
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    frame->path = std::move(readback.path);
+  }
+  else
+  {
+    debugLog(">>> Frame capture: mapping the readback of % failed, the frame is dropped", readback.path);
+    frame->width = 0;
+    frame->height = 0;
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  m_sink->submit(std::move(frame));
+
+  m_statistics.mapMilliseconds += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+  OPENGL_CHECK_ERROR();
+}
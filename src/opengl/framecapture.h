@@ -0,0 +1,93 @@
+#pragma once
+
+#include "glplatform.h"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "opengl_ext.h"
+
+class FrameSink;
+
+// Frames drawn into a framebuffer of their own instead of the window's and read back through a ring of pixel
+// buffers. The copy of frame N is started when it is captured and only mapped when frame N + 2 is, by when the
+// GPU is long done with it: the readback overlaps the next two frames and the GL thread doesn't wait on the GPU.
+// Mapped frames go to a FrameSink, an ImageWriter saving them or a VideoEncoder, which works on them on threads
+// of its own.
+class FrameCapture
+{
+public:
+  static const size_t ReadbackFrames = 3;
+
+  struct Statistics
+  {
+    size_t captured = 0;
+    size_t stalls = 0;              // readbacks the GPU wasn't done with when their turn came, waited for
+    double mapMilliseconds = 0.0;   // on the GL thread, waiting for the GPU and the sink, mapping and copying out
+  };
+
+  // sink is not owned and has to outlive the capture; nullptr if the framebuffer can't be made
+  static std::unique_ptr<FrameCapture> createUnique(size_t width, size_t height, FrameSink* sink);
+
+  FrameCapture()
+  {
+    m_framebuffer = 0;
+    m_color = 0;
+    m_depth = 0;
+    m_width = 0;
+    m_height = 0;
+    m_sink = nullptr;
+    for (auto& readback : m_readbacks)
+    {
+      readback.buffer = 0;
+      readback.fence = nullptr;
+    }
+    m_frame = 0;
+  }
+
+  ~FrameCapture();
+
+  // what is drawn between the two goes to the capture framebuffer, DeferredRenderer::render() for one; the
+  // viewport covers it and is put back after
+  void attach();
+  void detach();
+
+  // starts copying what was drawn out, to be saved to path, and hands the frame captured two before to the sink
+  void capture(const std::string& path);
+
+  // waits for the frames still being read back and hands them to the sink
+  void finish();
+
+  GLuint framebuffer() const
+  {
+    return m_framebuffer;
+  }
+
+  const Statistics& statistics() const
+  {
+    return m_statistics;
+  }
+
+protected:
+  struct Readback
+  {
+    GLuint buffer;
+    GLsync fence;   // null when there is nothing to read
+    std::string path;
+  };
+
+  // maps the copy in readback, waiting for it if need be, and hands it to the sink
+  void complete(Readback& readback);
+
+  GLuint m_framebuffer;
+  GLuint m_color;
+  GLuint m_depth;
+  size_t m_width;
+  size_t m_height;
+  FrameSink* m_sink;
+
+  Readback m_readbacks[ReadbackFrames];
+  size_t m_frame;
+  Statistics m_statistics;
+};
@@ -0,0 +1,45 @@
+#include "frustum.h"
+
+#include <cmath>
+
+Frustum::Frustum(const matrix4<float>& viewProjection)
+{
+  // clip = v * M, so clip coordinate j is the dot product with column j
+  const float* m = viewProjection.get_openglmatrix();
+  auto column = [m](int j, int i)
+  {
+    return m[i * 4 + j];
+  };
+
+  // left, right, bottom, top, near, far: w + x, w - x, w + y, w - y, w + z, w - z
+  for (int plane = 0; plane < 6; ++plane)
+  {
+    auto axis = plane / 2;
+    auto sign = (plane % 2) ? -1.0f : 1.0f;
+    for (int i = 0; i < 4; ++i)
+    {
+      m_planes[plane][i] = column(3, i) + sign * column(axis, i);
+    }
+
+    auto length = std::sqrt(m_planes[plane][0] * m_planes[plane][0] + m_planes[plane][1] * m_planes[plane][1] + m_planes[plane][2] * m_planes[plane][2]);
+    if (length > 0.0f)
+    {
+      for (auto& coefficient : m_planes[plane])
+      {
+        coefficient /= length;
+      }
+    }
+  }
+}
+
+bool Frustum::intersectsSphere(const vector3<float>& center, float radius) const
+{
+  for (const auto& plane : m_planes)
+  {
+    if (plane[0] * center.x + plane[1] * center.y + plane[2] * center.z + plane[3] < -radius)
+    {
+      return false;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "../linearAlgebra/vector3.h"
+#include "../linearAlgebra/matrix4.h"
+
+// The six clip planes of a view-projection matrix, in world space.
+class Frustum
+{
+public:
+  Frustum() = default;
+
+  // viewProjection = viewMatrix * projectionMatrix, in the row vector convention used by the renderer
+  explicit Frustum(const matrix4<float>& viewProjection);
+
+  // conservative: may keep a sphere that only touches the frustum's corners
+  bool intersectsSphere(const vector3<float>& center, float radius) const;
+
+protected:
+  // a * x + b * y + c * z + d >= 0 on the inner side; (a, b, c) is unit length
+  float m_planes[6][4] = {};
+};
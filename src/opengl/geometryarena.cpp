@@ -0,0 +1,210 @@
+#include "geometryarena.h"
+#include "glutils.h"
+
+#include <algorithm>
+#include <cstddef>
+
+#include "../utils/debugout.h"
+
+namespace {
+  // goes through the copy targets so the draw bindings are left alone
+  void copyBuffer(GLuint source, GLuint destination, size_t sourceOffset, size_t destinationOffset, size_t size)
+  {
+    glBindBuffer(GL_COPY_READ_BUFFER, source);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, destination);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(sourceOffset), static_cast<GLintptr>(destinationOffset), static_cast<GLsizeiptr>(size));
+  }
+
+  GLuint createBuffer(size_t size)
+  {
+    GLuint buffer = 0;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(size), nullptr, GL_STATIC_DRAW);
+    return buffer;
+  }
+}
+
+GeometryArena& GeometryArena::instance()
+{
+  // room for a few thousand small meshes before the first grow. never destroyed: global objects holding
+  // meshes (the lighting pass screen quad) may outlive any static, the buffers go away with the context
+  static GeometryArena* arena = new GeometryArena(64 * 1024, 256 * 1024);
+  return *arena;
+}
+
+GeometryArena::GeometryArena(size_t vertexCapacity, size_t indexCapacity) :
+  m_vertices(vertexCapacity),
+  m_indices(indexCapacity)
+{
+  m_vertexBuffer = createBuffer(vertexCapacity * sizeof(Vertex));
+  m_indexBuffer = createBuffer(indexCapacity * sizeof(GLuint));
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+GeometryArena::~GeometryArena()
+{
+  if (haveOpenGLContext())
+  {
+    glDeleteBuffers(1, &m_vertexBuffer);
+    glDeleteBuffers(1, &m_indexBuffer);
+  }
+}
+
+GeometryArena::Handle GeometryArena::allocate(const std::vector<vector3<float>>& vertices, const std::vector<vector3<float>>& normals, const std::vector<unsigned int>& indices)
+{
+  if (vertices.empty() || indices.empty())
+  {
+    return InvalidHandle;
+  }
+
+  Range range;
+  range.numVertices = vertices.size();
+  range.numIndices = indices.size();
+
+  range.firstVertex = m_vertices.allocate(range.numVertices);
+  if (range.firstVertex == RangeAllocator::InvalidOffset)
+  {
+    auto capacity = std::max(m_vertices.capacity() * 2, m_vertices.capacity() + range.numVertices);
+    resize(m_vertexBuffer, m_vertices.capacity() * sizeof(Vertex), capacity * sizeof(Vertex));
+    m_vertices.grow(capacity);
+    range.firstVertex = m_vertices.allocate(range.numVertices);
+  }
+
+  range.firstIndex = m_indices.allocate(range.numIndices);
+  if (range.firstIndex == RangeAllocator::InvalidOffset)
+  {
+    auto capacity = std::max(m_indices.capacity() * 2, m_indices.capacity() + range.numIndices);
+    resize(m_indexBuffer, m_indices.capacity() * sizeof(GLuint), capacity * sizeof(GLuint));
+    m_indices.grow(capacity);
+    range.firstIndex = m_indices.allocate(range.numIndices);
+  }
+
+  // a mesh without normals (or with fewer) gets zero ones
+  std::vector<Vertex> interleaved(range.numVertices);
+  for (size_t i = 0; i < range.numVertices; ++i)
+  {
+    interleaved[i].position = vertices[i];
+    interleaved[i].normal = i < normals.size() ? normals[i] : vector3<float>(0.0f, 0.0f, 0.0f);
+  }
+
+  glBindBuffer(GL_COPY_WRITE_BUFFER, m_vertexBuffer);
+  glBufferSubData(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(range.firstVertex * sizeof(Vertex)), static_cast<GLsizeiptr>(interleaved.size() * sizeof(Vertex)), interleaved.data());
+  glBindBuffer(GL_COPY_WRITE_BUFFER, m_indexBuffer);
+  glBufferSubData(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(range.firstIndex * sizeof(GLuint)), static_cast<GLsizeiptr>(indices.size() * sizeof(GLuint)), indices.data());
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  OPENGL_CHECK_ERROR();
+
+  Handle handle = InvalidHandle;
+  if (!m_freeHandles.empty())
+  {
+    handle = m_freeHandles.back();
+    m_freeHandles.pop_back();
+  }
+  else
+  {
+    m_meshes.emplace_back();
+    handle = static_cast<Handle>(m_meshes.size());
+  }
+
+  auto& mesh = m_meshes[handle - 1];
+  mesh.range = range;
+  mesh.live = true;
+
+  return handle;
+}
+
+void GeometryArena::free(Handle handle)
+{
+  if (handle == InvalidHandle || !m_meshes[handle - 1].live)
+  {
+    return;
+  }
+
+  auto& mesh = m_meshes[handle - 1];
+  m_vertices.free(mesh.range.firstVertex, mesh.range.numVertices);
+  m_indices.free(mesh.range.firstIndex, mesh.range.numIndices);
+  mesh.live = false;
+  m_freeHandles.push_back(handle);
+}
+
+void GeometryArena::bind() const
+{
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+
+  glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<const void*>(offsetof(Vertex, position)));
+  glEnableVertexAttribArray(1);
+  glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<const void*>(offsetof(Vertex, normal)));
+}
+
+void GeometryArena::defragment()
+{
+  // copying inside one buffer with overlapping ranges is undefined, so compact into fresh buffers
+  auto vertexBuffer = createBuffer(m_vertices.capacity() * sizeof(Vertex));
+  auto indexBuffer = createBuffer(m_indices.capacity() * sizeof(GLuint));
+
+  std::vector<Mesh*> live;
+  for (auto& mesh : m_meshes)
+  {
+    if (mesh.live)
+    {
+      live.push_back(&mesh);
+    }
+  }
+  std::sort(live.begin(), live.end(), [](const Mesh* a, const Mesh* b)
+  {
+    return a->range.firstVertex < b->range.firstVertex;
+  });
+
+  size_t vertices = 0, indices = 0;
+  for (auto mesh : live)
+  {
+    auto& range = mesh->range;
+    copyBuffer(m_vertexBuffer, vertexBuffer, range.firstVertex * sizeof(Vertex), vertices * sizeof(Vertex), range.numVertices * sizeof(Vertex));
+    copyBuffer(m_indexBuffer, indexBuffer, range.firstIndex * sizeof(GLuint), indices * sizeof(GLuint), range.numIndices * sizeof(GLuint));
+    range.firstVertex = vertices;
+    range.firstIndex = indices;
+    vertices += range.numVertices;
+    indices += range.numIndices;
+  }
+  glBindBuffer(GL_COPY_READ_BUFFER, 0);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+  glDeleteBuffers(1, &m_vertexBuffer);
+  glDeleteBuffers(1, &m_indexBuffer);
+  m_vertexBuffer = vertexBuffer;
+  m_indexBuffer = indexBuffer;
+
+  m_vertices.reset(vertices, live.size());
+  m_indices.reset(indices, live.size());
+  ++m_generation;
+
+  OPENGL_CHECK_ERROR();
+}
+
+GeometryArena::Statistics GeometryArena::statistics() const
+{
+  Statistics statistics;
+  statistics.vertexCapacity = m_vertices.capacity();
+  statistics.verticesUsed = m_vertices.used();
+  statistics.indexCapacity = m_indices.capacity();
+  statistics.indicesUsed = m_indices.used();
+  statistics.meshes = m_vertices.allocations();
+  statistics.freeBlocks = m_vertices.freeBlocks() + m_indices.freeBlocks();
+  statistics.fragmentation = std::max(m_vertices.fragmentation(), m_indices.fragmentation());
+  return statistics;
+}
+
+void GeometryArena::resize(GLuint& buffer, size_t oldSize, size_t newSize)
+{
+  auto resized = createBuffer(newSize);
+  copyBuffer(buffer, resized, 0, 0, oldSize);
+  glBindBuffer(GL_COPY_READ_BUFFER, 0);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  glDeleteBuffers(1, &buffer);
+  buffer = resized;
+
+  debugLog("Geometry arena: buffer grown to % bytes", newSize);
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "glplatform.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "opengl_ext.h"
+#include "../linearAlgebra/vector3.h"
+#include "../utils/rangeallocator.h"
+
+// One vertex buffer (interleaved position / normal) and one index buffer shared by every mesh. Meshes get
+// ranges of both through a handle; the ranges may move on defragment(), the handle stays. Indices are kept
+// mesh relative, draws add the range's first vertex as the base vertex.
+class GeometryArena
+{
+public:
+  using Handle = uint32_t;
+  static const Handle InvalidHandle = 0;
+
+  struct Vertex
+  {
+    vector3<float> position;
+    vector3<float> normal;
+  };
+
+  // in vertices and indices, not bytes
+  struct Range
+  {
+    size_t firstVertex = 0;
+    size_t numVertices = 0;
+    size_t firstIndex = 0;
+    size_t numIndices = 0;
+  };
+
+  struct Statistics
+  {
+    size_t vertexCapacity = 0;
+    size_t verticesUsed = 0;
+    size_t indexCapacity = 0;
+    size_t indicesUsed = 0;
+    size_t meshes = 0;
+    size_t freeBlocks = 0;        // vertex and index free lists together
+    float fragmentation = 0.0f;   // the worse of the two pools, see RangeAllocator::fragmentation()
+  };
+
+  // the arena all VertexBufferObjects allocate from; created on first use, which needs a GL context
+  static GeometryArena& instance();
+
+  GeometryArena(size_t vertexCapacity, size_t indexCapacity);
+
+  ~GeometryArena();
+
+  // InvalidHandle for an empty mesh; grows the buffers when out of space
+  Handle allocate(const std::vector<vector3<float>>& vertices, const std::vector<vector3<float>>& normals, const std::vector<unsigned int>& indices);
+
+  void free(Handle handle);
+
+  const Range& range(Handle handle) const
+  {
+    return m_meshes[handle - 1].range;
+  }
+
+  // sets up attributes 0 (position) and 1 (normal) and the index buffer
+  void bind() const;
+
+  // packs the live ranges to the front of the buffers, in their current order
+  void defragment();
+
+  Statistics statistics() const;
+
+  // changes whenever ranges move, i.e. on defragment()
+  size_t generation() const
+  {
+    return m_generation;
+  }
+
+protected:
+  struct Mesh
+  {
+    Range range;
+    bool live = false;
+  };
+
+  // reallocates the buffer and keeps its content
+  void resize(GLuint& buffer, size_t oldSize, size_t newSize);
+
+  GLuint m_vertexBuffer;
+  GLuint m_indexBuffer;
+
+  RangeAllocator m_vertices;
+  RangeAllocator m_indices;
+
+  std::vector<Mesh> m_meshes;   // by handle - 1
+  std::vector<Handle> m_freeHandles;
+
+  size_t m_generation = 0;
+};
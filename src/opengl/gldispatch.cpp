@@ -0,0 +1,144 @@
+#include "gldispatch.h"
+
+#include <cstring>
+
+namespace {
+  bool startsWith(const char* name, const char* prefix)
+  {
+    return strncmp(name, prefix, strlen(prefix)) == 0;
+  }
+
+  GLDispatch::Kind kindOf(const char* name)
+  {
+    if (startsWith(name, "glBind") || strcmp(name, "glUseProgram") == 0)
+    {
+      return GLDispatch::Kind::Bind;
+    }
+    if (startsWith(name, "glUniform") || startsWith(name, "glProgramUniform"))
+    {
+      return GLDispatch::Kind::Uniform;
+    }
+    if (startsWith(name, "glDraw") || startsWith(name, "glMultiDraw"))
+    {
+      return GLDispatch::Kind::Draw;
+    }
+    return GLDispatch::Kind::Other;
+  }
+}
+
+void GLDispatch::setBackend(Backend* backend)
+{
+  s_backend = backend;
+  ++s_generation;
+}
+
+void GLDispatch::setDriver(ProcAddress procAddress, CurrentContext currentContext)
+{
+  s_procAddress = procAddress;
+  s_currentContext = currentContext;
+  ++s_generation;
+}
+
+void GLDispatch::setCounting(bool counting, bool timing, bool logging)
+{
+  s_counting = counting;
+  s_timing = counting && timing;
+  s_logging = counting && logging;
+  ++s_generation;
+}
+
+GLDispatch::Calls GLDispatch::calls()
+{
+  Calls result;
+  for (const auto& entry : s_entries)
+  {
+    auto kind = static_cast<size_t>(entry.kind);
+    result.counts[kind] += entry.calls;
+    result.times[kind] += static_cast<double>(entry.nanoseconds) * 1e-6;
+  }
+  return result;
+}
+
+size_t GLDispatch::calls(const char* name)
+{
+  for (const auto& entry : s_entries)
+  {
+    if (entry.name == name)
+    {
+      return entry.calls;
+    }
+  }
+  return 0;
+}
+
+void GLDispatch::resetCalls()
+{
+  for (auto& entry : s_entries)
+  {
+    entry.calls = 0;
+    entry.nanoseconds = 0;
+  }
+  s_log.clear();
+}
+
+bool GLDispatch::haveContext()
+{
+  if (s_backend)
+  {
+    return true;
+  }
+  if (s_currentContext)
+  {
+    return s_currentContext();
+  }
+#ifdef _WIN32
+  return wglGetCurrentContext() != NULL;
+#else
+  return false;
+#endif
+}
+
+void* GLDispatch::resolve(const char* name, void* stub)
+{
+  return s_backend ? s_backend->resolve(name, stub) : resolveDriver(name);
+}
+
+size_t GLDispatch::entryIndex(const char* name)
+{
+  // once per entry point and backend switch, a few hundred at most
+  for (size_t i = 0; i < s_entries.size(); ++i)
+  {
+    if (s_entries[i].name == name)
+    {
+      return i;
+    }
+  }
+  Entry entry;
+  entry.name = name;
+  entry.kind = kindOf(name);
+  s_entries.push_back(entry);
+  return s_entries.size() - 1;
+}
+
+void* GLDispatch::resolveDriver(const char* name)
+{
+  if (s_procAddress)
+  {
+    return s_procAddress(name);
+  }
+#ifdef _WIN32
+  // wglGetProcAddress only knows what came after GL 1.1, and some drivers answer 1, 2, 3 or -1 for missing ones
+  auto function = reinterpret_cast<void*>(wglGetProcAddress(name));
+  auto value = reinterpret_cast<intptr_t>(function);
+  if (value >= -1 && value <= 3)
+  {
+    static HMODULE openGL = LoadLibraryA("opengl32.dll");
+    function = openGL ? reinterpret_cast<void*>(GetProcAddress(openGL, name)) : nullptr;
+  }
+  return function;
+#else
+  // outside Windows only a platform's loader knows where the driver is
+  (void)name;
+  return nullptr;
+#endif
+}
@@ -0,0 +1,208 @@
+#pragma once
+
+#include "glplatform.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Where the GL entry points come from. By default the driver's (wglGetProcAddress, opengl32.dll for GL 1.1), or
+// whatever loader the Platform that made the context installs; a Backend such as MockGL can take its place, so
+// that the renderer runs without a driver or a context.
+// Every call can also be counted and timed per entry point, to track what a frame costs in GL calls.
+// opengl_ext.h routes every entry point the tree uses through here, GL 1.1 included.
+class GLDispatch
+{
+public:
+  class Backend
+  {
+  public:
+    virtual ~Backend() = default;
+
+    // the backend's implementation of the named entry point; stub does nothing and returns zero, for the ones
+    // the backend doesn't care about. nullptr for the ones it doesn't support, as a driver without the extension
+    virtual void* resolve(const char* name, void* stub) = 0;
+  };
+
+  // what the calls are counted as, told by the name
+  enum class Kind
+  {
+    Bind = 0,   // glBind*, glUseProgram
+    Uniform,    // glUniform*, glProgramUniform*
+    Draw,       // glDraw*, glMultiDraw*
+    Other,
+    Num,
+  };
+
+  struct Calls
+  {
+    size_t counts[static_cast<size_t>(Kind::Num)] = {};
+    double times[static_cast<size_t>(Kind::Num)] = {};  // milliseconds, with timing on
+
+    size_t count(Kind kind) const
+    {
+      return counts[static_cast<size_t>(kind)];
+    }
+
+    double milliseconds(Kind kind) const
+    {
+      return times[static_cast<size_t>(kind)];
+    }
+
+    size_t total() const
+    {
+      size_t result = 0;
+      for (auto count : counts)
+      {
+        result += count;
+      }
+      return result;
+    }
+  };
+
+  // every entry point goes to backend from the next call on, to the driver again with nullptr. not owned
+  static void setBackend(Backend* backend);
+
+  // how the driver's entry points are found and whether there's a current context, for contexts made by other
+  // means than wgl (GLFW, EGL); nullptr for either goes back to the default
+  using ProcAddress = void* (*)(const char* name);
+  using CurrentContext = bool (*)();
+  static void setDriver(ProcAddress procAddress, CurrentContext currentContext);
+
+  static Backend* backend()
+  {
+    return s_backend;
+  }
+
+  // counts every call per entry point; timing adds about as much as a cheap call costs, and logging keeps the
+  // names in call order, for tests
+  static void setCounting(bool counting, bool timing = false, bool logging = false);
+
+  static bool counting()
+  {
+    return s_counting;
+  }
+
+  // since the last resetCalls()
+  static Calls calls();
+  static size_t calls(const char* name);
+  static const std::vector<const char*>& log()
+  {
+    return s_log;
+  }
+  static void resetCalls();
+
+  // a backend always has one
+  static bool haveContext();
+
+  // for GLEntryPoint
+  static uint32_t generation()
+  {
+    return s_generation;
+  }
+  static void* resolve(const char* name, void* stub);
+  static size_t entryIndex(const char* name);
+
+  // counts one call while in scope
+  class Call
+  {
+  public:
+    explicit Call(size_t index) :
+      m_index(index)
+    {
+      auto& entry = s_entries[index];
+      ++entry.calls;
+      if (s_logging)
+      {
+        s_log.push_back(entry.name.c_str());
+      }
+      if (s_timing)
+      {
+        m_start = Clock::now();
+      }
+    }
+
+    ~Call()
+    {
+      if (s_timing)
+      {
+        s_entries[m_index].nanoseconds += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - m_start).count());
+      }
+    }
+
+  protected:
+    using Clock = std::chrono::steady_clock;
+
+    size_t m_index;
+    Clock::time_point m_start;
+  };
+
+protected:
+  struct Entry
+  {
+    std::string name;
+    Kind kind;
+    size_t calls = 0;
+    uint64_t nanoseconds = 0;
+  };
+
+  static void* resolveDriver(const char* name);
+
+  static inline Backend* s_backend = nullptr;
+  static inline ProcAddress s_procAddress = nullptr;
+  static inline CurrentContext s_currentContext = nullptr;
+  static inline uint32_t s_generation = 1;  // bumped whenever the entry points have to be resolved again
+  static inline bool s_counting = false;
+  static inline bool s_timing = false;
+  static inline bool s_logging = false;
+  static inline std::vector<Entry> s_entries;
+  static inline std::vector<const char*> s_log;
+};
+
+// One entry point: resolved on first use and again after the backend or the counting changed. Name provides
+// the entry point's name as name(); GET_FUNCTION_POINTER in opengl_ext.h declares one per function.
+template<typename Function, typename Name>
+class GLEntryPoint;
+
+template<typename Result, typename... Args, typename Name>
+class GLEntryPoint<Result (APIENTRY*)(Args...), Name>
+{
+public:
+  using Function = Result (APIENTRY*)(Args...);
+
+  static Function get()
+  {
+    if (s_generation != GLDispatch::generation())
+    {
+      resolve();
+    }
+    return s_current;
+  }
+
+protected:
+  static void resolve()
+  {
+    s_target = reinterpret_cast<Function>(GLDispatch::resolve(Name::name(), reinterpret_cast<void*>(&stub)));
+    s_index = GLDispatch::entryIndex(Name::name());
+    s_current = s_target && GLDispatch::counting() ? &counted : s_target;
+    s_generation = GLDispatch::generation();
+  }
+
+  static Result APIENTRY stub(Args...)
+  {
+    return Result();
+  }
+
+  static Result APIENTRY counted(Args... args)
+  {
+    GLDispatch::Call call(s_index);
+    return s_target(args...);
+  }
+
+  static inline Function s_target = nullptr;
+  static inline Function s_current = nullptr;
+  static inline size_t s_index = 0;
+  static inline uint32_t s_generation = 0;
+};
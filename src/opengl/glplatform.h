@@ -0,0 +1,15 @@
+#pragma once
+
+// The GL 1.1 header, from wherever the platform keeps it; glext.h and opengl_ext.h take it from there.
+#ifdef _WIN32
+#include <Windows.h>
+#include <gl/GL.h>
+#else
+// the tree's glext.h declares everything past 1.1, the system one stays out
+#define GL_GLEXT_LEGACY
+#include <GL/gl.h>
+// Mesa's gl.h declares 1.2 and 1.3 itself; glext.h declares their function pointer types again, which it only
+// does for versions not defined yet
+#undef GL_VERSION_1_2
+#undef GL_VERSION_1_3
+#endif
@@ -2,41 +2,54 @@
 #define __OPENGL_UTILS_H__
 
 #include <src/utils/debugout.h>
-#include <gl/GLU.h>
 #include <string.h>
 
+#include "gldispatch.h"
+
+#ifdef _WIN32
+#include <gl/GLU.h>
 #pragma comment (lib, "glu32.lib")
+#define OPENGL_ERROR_STRING(openglError) _strupr((char*)gluErrorString(openglError))
+#define OPENGL_DEBUGGER_PRESENT() IsDebuggerPresent()
+#define OPENGL_DEBUG_BREAK() __debugbreak()
+#else
+// no GLU on the headless machines, the error is logged as its number
+#define OPENGL_ERROR_STRING(openglError) (openglError)
+#define OPENGL_DEBUGGER_PRESENT() false
+#define OPENGL_DEBUG_BREAK()
+#define UNREFERENCED_PARAMETER(parameter) (void)(parameter)
+#endif
 
 #ifdef ENABLE_OPENGL_ERROR_CHECKING
 #define OPENGL_CHECK_ERROR()                                                                                                           \
     {                                                                                                                                  \
       if(const GLenum openglError = glGetError())                                                                                      \
       {                                                                                                                                \
-        if(!IsDebuggerPresent())                                                                                                       \
+        if(!OPENGL_DEBUGGER_PRESENT())                                                                                                 \
         {                                                                                                                              \
-          debugLog("OpenGL error % found on file '%', line %",    _strupr((char*)gluErrorString(openglError)), __FILE__, __LINE__);    \
+          debugLogAt(LogLevel::Error, "OpenGL error % found on file '%', line %",    OPENGL_ERROR_STRING(openglError), __FILE__, __LINE__); \
         }                                                                                                                              \
         else                                                                                                                           \
         {                                                                                                                              \
-          const GLubyte* openglErrorString = gluErrorString(openglError);                                                              \
+          auto openglErrorString = OPENGL_ERROR_STRING(openglError);                                                                   \
           UNREFERENCED_PARAMETER(openglErrorString);                                                                                   \
-          __debugbreak();                                                                                                              \
+          OPENGL_DEBUG_BREAK();                                                                                                        \
         }                                                                                                                              \
       }                                                                                                                                \
     }
-#define OPENGL_CHECK_CONTEXT()                                                            \
-{                                                                                         \
-    if(wglGetCurrentContext() == NULL)                                                    \
-    {                                                                                     \
-        if(!IsDebuggerPresent())                                                          \
-        {                                                                                 \
-          debugLog("No OpenGL context found on file '%', line %", __FILE__, __LINE__);    \
-        }                                                                                 \
-        else                                                                              \
-        {                                                                                 \
-            __debugbreak();                                                               \
-        }                                                                                 \
-    }                                                                                     \
+#define OPENGL_CHECK_CONTEXT()                                                                                                         \
+{                                                                                                                                      \
+    if(!GLDispatch::haveContext())                                                                                                     \
+    {                                                                                                                                  \
+        if(!OPENGL_DEBUGGER_PRESENT())                                                                                                 \
+        {                                                                                                                              \
+          debugLogAt(LogLevel::Error, "No OpenGL context found on file '%', line %", __FILE__, __LINE__);                              \
+        }                                                                                                                              \
+        else                                                                                                                           \
+        {                                                                                                                              \
+            OPENGL_DEBUG_BREAK();                                                                                                      \
+        }                                                                                                                              \
+    }                                                                                                                                  \
 }
 #else
 #define OPENGL_CHECK_ERROR()
@@ -44,9 +57,10 @@
 #endif
 
 
+// true with a GLDispatch backend in place of the driver
 inline bool haveOpenGLContext()
 {
-  return wglGetCurrentContext() != NULL;
+  return GLDispatch::haveContext();
 }
 
 #endif // !__OPENGL_UTILS_H__
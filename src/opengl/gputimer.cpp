@@ -0,0 +1,162 @@
+#include "gputimer.h"
+#include "glutils.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "../utils/profiler.h"
+
+std::unique_ptr<GpuTimer> GpuTimer::createUnique()
+{
+  if (!glQueryCounter || !glGetQueryObjectui64v || !glGetInteger64v)
+  {
+    return std::unique_ptr<GpuTimer>();
+  }
+
+  auto timer = std::make_unique<GpuTimer>();
+  for (auto& frame : timer->m_frames)
+  {
+    for (auto& query : frame.queries)
+    {
+      glGenQueries(1, &query.begin);
+      glGenQueries(1, &query.end);
+    }
+  }
+  if (Profiler::enabled())
+  {
+    timer->m_lane = Profiler::lane("GPU");
+  }
+  OPENGL_CHECK_ERROR();
+  return timer;
+}
+
+GpuTimer::~GpuTimer()
+{
+  if (haveOpenGLContext())
+  {
+    for (auto& frame : m_frames)
+    {
+      for (auto& query : frame.queries)
+      {
+        glDeleteQueries(1, &query.begin);
+        glDeleteQueries(1, &query.end);
+      }
+    }
+  }
+}
+
+void GpuTimer::beginFrame()
+{
+  // a pass left open in the frame before isn't timed
+  m_open.clear();
+  m_frame = (m_frame + 1) % QueryLatency;
+  auto& frame = m_frames[m_frame];
+  if (frame.pending)
+  {
+    collect(frame);
+  }
+  frame.count = 0;
+  frame.pending = true;
+
+  // the GPU's clock as the commands so far reach it, no wait for them to run; matched to the profiler's every
+  // frame so the two don't drift apart in the trace
+  if (Profiler::enabled())
+  {
+    GLint64 gpuNow = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+    m_clockOffset = static_cast<int64_t>(Profiler::now()) - static_cast<int64_t>(gpuNow);
+  }
+}
+
+void GpuTimer::begin(const char* name)
+{
+  auto& frame = m_frames[m_frame];
+  // past MaxPasses, an index that end() knows to skip
+  if (frame.count == MaxPasses)
+  {
+    m_open.push_back(frame.count);
+    return;
+  }
+  auto& query = frame.queries[frame.count];
+  query.name = name;
+  query.ended = false;
+  glQueryCounter(query.begin, GL_TIMESTAMP);
+  m_open.push_back(frame.count++);
+}
+
+void GpuTimer::end()
+{
+  if (m_open.empty())
+  {
+    return;
+  }
+  auto index = m_open.back();
+  m_open.pop_back();
+  if (index < MaxPasses)
+  {
+    auto& query = m_frames[m_frame].queries[index];
+    glQueryCounter(query.end, GL_TIMESTAMP);
+    query.ended = true;
+  }
+}
+
+std::vector<GpuTimer::Pass> GpuTimer::averages() const
+{
+  std::vector<Pass> averages;
+  for (const auto& total : m_totals)
+  {
+    averages.push_back({ total.name, total.milliseconds / static_cast<double>(total.count) });
+  }
+  return averages;
+}
+
+void GpuTimer::collect(Frame& frame)
+{
+  frame.pending = false;
+  m_passes.clear();
+  for (size_t i = 0; i < frame.count; ++i)
+  {
+    // QueryLatency frames on these are in; one that isn't, the driver more than that behind, is skipped rather
+    // than waited for, as is a pass never ended
+    const auto& query = frame.queries[i];
+    GLuint available = GL_FALSE;
+    if (query.ended)
+    {
+      glGetQueryObjectuiv(query.end, GL_QUERY_RESULT_AVAILABLE, &available);
+    }
+    if (!available)
+    {
+      continue;
+    }
+
+    GLuint64 begin = 0;
+    GLuint64 end = 0;
+    glGetQueryObjectui64v(query.begin, GL_QUERY_RESULT, &begin);
+    glGetQueryObjectui64v(query.end, GL_QUERY_RESULT, &end);
+    auto nanoseconds = end > begin ? end - begin : 0;
+    auto milliseconds = static_cast<double>(nanoseconds) / 1000000.0;
+    m_passes.push_back({ query.name, milliseconds });
+
+    auto total = std::find_if(m_totals.begin(), m_totals.end(), [&query](const Total& total)
+    {
+      return std::strcmp(total.name, query.name) == 0;
+    });
+    if (total == m_totals.end())
+    {
+      m_totals.push_back({ query.name, milliseconds, 1 });
+    }
+    else
+    {
+      total->milliseconds += milliseconds;
+      ++total->count;
+    }
+
+    if (Profiler::enabled())
+    {
+      auto shifted = static_cast<int64_t>(begin) + m_clockOffset;
+      auto start = shifted > 0 ? static_cast<uint64_t>(shifted) : 0;
+      Profiler::record(query.name, start, start + nanoseconds, m_lane);
+    }
+  }
+  OPENGL_CHECK_ERROR();
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "glplatform.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "opengl_ext.h"
+
+// How long passes take on the GPU, from a timestamp query at each end. A frame's queries are read QueryLatency
+// frames after they're issued, when the GPU is long done with them, so reading them never stalls; the times
+// are that much behind. With profiling compiled in the passes also go to the profiler, on a timeline of
+// their own next to the threads', for its histograms and trace.
+class GpuTimer
+{
+public:
+  static const size_t QueryLatency = 3;   // frames between issuing the queries and reading them back
+  static const size_t MaxPasses = 8;      // per frame, the rest aren't timed
+
+  struct Pass
+  {
+    const char* name;   // a string literal, as for the profiler
+    double milliseconds;
+  };
+
+  // times name from construction to destruction; does nothing without a timer
+  class Scope
+  {
+  public:
+    Scope(GpuTimer* timer, const char* name) :
+      m_timer(timer)
+    {
+      if (m_timer)
+      {
+        m_timer->begin(name);
+      }
+    }
+
+    ~Scope()
+    {
+      if (m_timer)
+      {
+        m_timer->end();
+      }
+    }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+  protected:
+    GpuTimer* m_timer;
+  };
+
+  // nullptr without timestamp queries (GL 3.3 or ARB_timer_query)
+  static std::unique_ptr<GpuTimer> createUnique();
+
+  GpuTimer()
+  {
+    m_frame = 0;
+    m_clockOffset = 0;
+  }
+
+  ~GpuTimer();
+
+  // starts timing a frame; the one issued QueryLatency frames before is read back first
+  void beginFrame();
+
+  // passes may nest, a pass's time includes the ones inside it
+  void begin(const char* name);
+  void end();
+
+  // the passes of the latest frame read back, in the order they began
+  const std::vector<Pass>& passes() const
+  {
+    return m_passes;
+  }
+
+  // per pass name, over the frames read back since resetAverages()
+  std::vector<Pass> averages() const;
+
+  void resetAverages()
+  {
+    m_totals.clear();
+  }
+
+protected:
+  struct Query
+  {
+    const char* name = nullptr;
+    GLuint begin = 0;
+    GLuint end = 0;
+    bool ended = false;
+  };
+
+  struct Frame
+  {
+    Query queries[MaxPasses];
+    size_t count = 0;
+    bool pending = false;
+  };
+
+  void collect(Frame& frame);
+
+  Frame m_frames[QueryLatency];
+  size_t m_frame;
+  std::vector<size_t> m_open;    // passes begun and not ended, innermost last
+  std::vector<Pass> m_passes;
+
+  struct Total
+  {
+    const char* name;
+    double milliseconds;
+    size_t count;
+  };
+  std::vector<Total> m_totals;
+
+  int64_t m_clockOffset;   // the profiler's clock minus the GPU's, in nanoseconds
+  uint32_t m_lane = 0;
+};
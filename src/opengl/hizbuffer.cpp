@@ -0,0 +1,236 @@
+#include "hizbuffer.h"
+#include "glutils.h"
+
+#include <algorithm>
+
+#include "../utils/debugout.h"
+
+namespace {
+  size_t levelSize(size_t size, size_t level)
+  {
+    return std::max<size_t>(size >> level, 1);
+  }
+
+  // the first power of two not below size
+  size_t roundUpToPowerOfTwo(size_t size)
+  {
+    size_t result = 1;
+    while (result < size)
+    {
+      result <<= 1;
+    }
+    return result;
+  }
+}
+
+std::unique_ptr<HiZBuffer> HiZBuffer::createUnique(size_t width, size_t height)
+{
+  auto hiZ = std::make_unique<HiZBuffer>();
+  hiZ->m_width = width;
+  hiZ->m_height = height;
+
+  // a copy of the depth to sample from; glBlitFramebuffer wants the formats to match
+  glGenTextures(1, &hiZ->m_depthTexture);
+  glBindTexture(GL_TEXTURE_2D, hiZ->m_depthTexture);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, static_cast<GLsizei>(width), static_cast<GLsizei>(height), 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, nullptr);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+
+  glGenFramebuffers(1, &hiZ->m_depthFramebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, hiZ->m_depthFramebuffer);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, hiZ->m_depthTexture, 0);
+  glDrawBuffer(GL_NONE);
+  glReadBuffer(GL_NONE);
+
+  // GL halves mip sizes rounding down, HiZPyramid rounds up. padding level 0 to powers of two makes both cover the
+  // same level 0 texels with every texel; the padding is cleared to the near plane and never looked at
+  auto paddedWidth = roundUpToPowerOfTwo(width);
+  auto paddedHeight = roundUpToPowerOfTwo(height);
+  hiZ->m_levels = 1;
+  for (auto size = std::max(paddedWidth, paddedHeight); size > 1; size >>= 1)
+  {
+    ++hiZ->m_levels;
+  }
+  hiZ->m_readbackLevel = 0;
+  while (levelSize(paddedWidth, hiZ->m_readbackLevel) > MaxReadbackWidth)
+  {
+    ++hiZ->m_readbackLevel;
+  }
+
+  glGenTextures(1, &hiZ->m_pyramid);
+  glBindTexture(GL_TEXTURE_2D, hiZ->m_pyramid);
+  for (size_t level = 0; level < hiZ->m_levels; ++level)
+  {
+    glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), GL_R32F, static_cast<GLsizei>(levelSize(paddedWidth, level)), static_cast<GLsizei>(levelSize(paddedHeight, level)), 0, GL_RED, GL_FLOAT, nullptr);
+  }
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(hiZ->m_levels - 1));
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  glGenFramebuffers(1, &hiZ->m_levelFramebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, hiZ->m_levelFramebuffer);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, hiZ->m_pyramid, 0);
+  GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  if (status != GL_FRAMEBUFFER_COMPLETE)
+  {
+    debugLog("Hi-Z buffer initialization failed.");
+    return std::unique_ptr<HiZBuffer>();
+  }
+
+  auto readbackSize = static_cast<GLsizeiptr>(levelSize(paddedWidth, hiZ->m_readbackLevel) * levelSize(paddedHeight, hiZ->m_readbackLevel) * sizeof(float));
+  for (auto& readback : hiZ->m_readbacks)
+  {
+    glGenBuffers(1, &readback.buffer);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+    glBufferData(GL_PIXEL_PACK_BUFFER, readbackSize, nullptr, GL_STREAM_READ);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  hiZ->m_reduce = Shader::fromFiles("res/shaders/hiz.vert", "res/shaders/hiz.frag");
+  OPENGL_CHECK_ERROR();
+
+  return hiZ;
+}
+
+HiZBuffer::~HiZBuffer()
+{
+  if (haveOpenGLContext())
+  {
+    for (auto& readback : m_readbacks)
+    {
+      if (readback.fence)
+      {
+        glDeleteSync(readback.fence);
+      }
+      glDeleteBuffers(1, &readback.buffer);
+    }
+    glDeleteFramebuffers(1, &m_levelFramebuffer);
+    glDeleteFramebuffers(1, &m_depthFramebuffer);
+    glDeleteTextures(1, &m_pyramid);
+    glDeleteTextures(1, &m_depthTexture);
+  }
+}
+
+void HiZBuffer::build(GLuint framebuffer, const matrix4<float>& viewProjection)
+{
+  GLint viewport[4] = {};
+  GLint program = 0;
+  glGetIntegerv(GL_VIEWPORT, viewport);
+  glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_depthFramebuffer);
+  glBlitFramebuffer(0, 0, static_cast<GLint>(m_width), static_cast<GLint>(m_height), 0, 0, static_cast<GLint>(m_width), static_cast<GLint>(m_height), GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+
+  glBindFramebuffer(GL_FRAMEBUFFER, m_levelFramebuffer);
+  glDisable(GL_DEPTH_TEST);
+  m_reduce->attach();
+  m_reduce->set("source", glUniform1i, 1);
+  glActiveTexture(GL_TEXTURE1);
+
+  // level 0: the depth as it is, the padding at the near plane so that it never raises a maximum
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_pyramid, 0);
+  const GLfloat nearPlane[4] = {};
+  glClearBufferfv(GL_COLOR, 0, nearPlane);
+  glViewport(0, 0, static_cast<GLsizei>(m_width), static_cast<GLsizei>(m_height));
+  glBindTexture(GL_TEXTURE_2D, m_depthTexture);
+  m_reduce->set("reduce", glUniform1i, 0);
+  glDrawArrays(GL_TRIANGLES, 0, 3);
+
+  // every other level reads the one below; limiting the levels that can be sampled to it keeps the level being
+  // written out of reach, so there is no feedback loop
+  glBindTexture(GL_TEXTURE_2D, m_pyramid);
+  m_reduce->set("reduce", glUniform1i, 1);
+  auto paddedWidth = roundUpToPowerOfTwo(m_width);
+  auto paddedHeight = roundUpToPowerOfTwo(m_height);
+  for (size_t level = 1; level < m_levels; ++level)
+  {
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, static_cast<GLint>(level - 1));
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(level - 1));
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_pyramid, static_cast<GLint>(level));
+    glViewport(0, 0, static_cast<GLsizei>(levelSize(paddedWidth, level)), static_cast<GLsizei>(levelSize(paddedHeight, level)));
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+  }
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(m_levels - 1));
+
+  // copied out behind the reduction; a readback nobody picked up in ReadbackFrames frames is dropped
+  auto& readback = m_readbacks[m_frame % ReadbackFrames];
+  if (readback.fence)
+  {
+    glDeleteSync(readback.fence);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+  glGetTexImage(GL_TEXTURE_2D, static_cast<GLint>(m_readbackLevel), GL_RED, GL_FLOAT, nullptr);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  readback.viewProjection = viewProjection;
+  ++m_frame;
+
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glActiveTexture(GL_TEXTURE0);
+  glEnable(GL_DEPTH_TEST);
+  glUseProgram(static_cast<GLuint>(program));
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+  glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+  OPENGL_CHECK_ERROR();
+}
+
+std::shared_ptr<HiZPyramid> HiZBuffer::read()
+{
+  // oldest to newest; the newest one done wins, the ones before it are stale whether done or not
+  size_t newest = ReadbackFrames;
+  for (size_t age = 0; age < ReadbackFrames; ++age)
+  {
+    auto slot = (m_frame + age) % ReadbackFrames;
+    auto fence = m_readbacks[slot].fence;
+    if (!fence)
+    {
+      continue;
+    }
+    auto result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED)
+    {
+      newest = age;
+    }
+  }
+  if (newest == ReadbackFrames)
+  {
+    return nullptr;
+  }
+  for (size_t age = 0; age <= newest; ++age)
+  {
+    auto& fence = m_readbacks[(m_frame + age) % ReadbackFrames].fence;
+    if (fence)
+    {
+      glDeleteSync(fence);
+      fence = nullptr;
+    }
+  }
+
+  // the level covers ceil(size / 2^level) texels of the depth, the rest is padding
+  auto scale = size_t(1) << m_readbackLevel;
+  auto paddedWidth = levelSize(roundUpToPowerOfTwo(m_width), m_readbackLevel);
+  auto paddedHeight = levelSize(roundUpToPowerOfTwo(m_height), m_readbackLevel);
+  auto width = (m_width + scale - 1) / scale;
+  auto height = (m_height + scale - 1) / scale;
+
+  const auto& readback = m_readbacks[(m_frame + newest) % ReadbackFrames];
+  auto pyramid = std::make_shared<HiZPyramid>();
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+  auto depth = static_cast<const float*>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, static_cast<GLsizeiptr>(paddedWidth * paddedHeight * sizeof(float)), GL_MAP_READ_BIT));
+  if (depth)
+  {
+    pyramid->build(depth, width, height, paddedWidth);
+    pyramid->viewProjection() = readback.viewProjection;
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  OPENGL_CHECK_ERROR();
+
+  return depth ? pyramid : nullptr;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "glplatform.h"
+
+#include <cstddef>
+#include <memory>
+
+#include "opengl_ext.h"
+#include "shaders.h"
+#include "hizpyramid.h"
+#include "../linearAlgebra/matrix4.h"
+
+// The Hi-Z pyramid on the GPU: the depth of a framebuffer copied into an R32F texture whose mip levels hold the
+// farthest depth of 2 x 2 texels of the level below (hiz.frag). hizTest.vert tests boxes against it in the frame it
+// was built; a coarse level is also copied out through a ring of pixel buffers, without waiting on the GPU, and
+// comes back a frame or two later as a HiZPyramid to cull the next frames on the CPU.
+class HiZBuffer
+{
+public:
+  static const size_t ReadbackFrames = 3;
+  static const size_t MaxReadbackWidth = 256;   // the level read back is the first no wider than this
+
+  static std::unique_ptr<HiZBuffer> createUnique(size_t width, size_t height);
+
+  HiZBuffer()
+  {
+    m_depthTexture = 0;
+    m_depthFramebuffer = 0;
+    m_pyramid = 0;
+    m_levelFramebuffer = 0;
+    m_width = 0;
+    m_height = 0;
+    m_levels = 0;
+    m_readbackLevel = 0;
+    for (auto& readback : m_readbacks)
+    {
+      readback.buffer = 0;
+      readback.fence = nullptr;
+    }
+    m_frame = 0;
+  }
+
+  ~HiZBuffer();
+
+  // from the depth attachment of framebuffer, which has to be width x height and single sampled, seen through
+  // viewProjection; starts copying the readback level out. the bound framebuffer, the viewport and the program
+  // are left as they were
+  void build(GLuint framebuffer, const matrix4<float>& viewProjection);
+
+  // the newest readback the GPU is done with, nullptr when none came back since the last call
+  std::shared_ptr<HiZPyramid> read();
+
+  // the pyramid, every level available to texelFetch
+  GLuint texture() const
+  {
+    return m_pyramid;
+  }
+
+  size_t levels() const
+  {
+    return m_levels;
+  }
+
+protected:
+  struct Readback
+  {
+    GLuint buffer;
+    GLsync fence;   // null when there is nothing to read
+    matrix4<float> viewProjection;
+  };
+
+  GLuint m_depthTexture;
+  GLuint m_depthFramebuffer;
+  GLuint m_pyramid;
+  GLuint m_levelFramebuffer;
+  std::unique_ptr<Shader> m_reduce;
+
+  size_t m_width;
+  size_t m_height;
+  size_t m_levels;
+  size_t m_readbackLevel;
+
+  Readback m_readbacks[ReadbackFrames];
+  size_t m_frame;
+};
@@ -0,0 +1,119 @@
+#include "hizpyramid.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+  // clip space w below which a corner counts as behind the eye
+  const float NearW = 1e-5f;
+}
+
+void HiZPyramid::build(const float* depth, size_t width, size_t height, size_t stride)
+{
+  size_t numLevels = 1;
+  for (auto size = std::max(width, height); size > 1; size = (size + 1) / 2)
+  {
+    ++numLevels;
+  }
+  m_levels.resize(numLevels);
+
+  auto& base = m_levels[0];
+  base.width = width;
+  base.height = height;
+  base.depth.resize(width * height);
+  for (size_t y = 0; y < height; ++y)
+  {
+    std::copy(depth + y * stride, depth + y * stride + width, base.depth.begin() + y * width);
+  }
+
+  // odd sizes round up, the last texel of a row or column then covers one texel of the level below
+  for (size_t level = 1; level < numLevels; ++level)
+  {
+    const auto& source = m_levels[level - 1];
+    auto& target = m_levels[level];
+    target.width = (source.width + 1) / 2;
+    target.height = (source.height + 1) / 2;
+    target.depth.resize(target.width * target.height);
+    for (size_t y = 0; y < target.height; ++y)
+    {
+      auto y0 = 2 * y;
+      auto y1 = std::min(y0 + 1, source.height - 1);
+      for (size_t x = 0; x < target.width; ++x)
+      {
+        auto x0 = 2 * x;
+        auto x1 = std::min(x0 + 1, source.width - 1);
+        auto row0 = &source.depth[y0 * source.width];
+        auto row1 = &source.depth[y1 * source.width];
+        target.depth[y * target.width + x] = std::max(std::max(row0[x0], row0[x1]), std::max(row1[x0], row1[x1]));
+      }
+    }
+  }
+}
+
+bool HiZPyramid::visible(const vector3<float>& minimum, const vector3<float>& maximum, const matrix4<float>& modelMatrix) const
+{
+  if (m_levels.empty())
+  {
+    return true;
+  }
+
+  auto modelViewProjection = modelMatrix * m_viewProjection;
+  const float* m = modelViewProjection.get_openglmatrix();
+  auto width = static_cast<float>(m_levels[0].width);
+  auto height = static_cast<float>(m_levels[0].height);
+
+  // screen rectangle in level 0 texels and nearest depth of the box's corners
+  float minX = 1e30f, minY = 1e30f, maxX = -1e30f, maxY = -1e30f, minDepth = 1.0f;
+  for (int corner = 0; corner < 8; ++corner)
+  {
+    auto x = (corner & 1) ? maximum.x : minimum.x;
+    auto y = (corner & 2) ? maximum.y : minimum.y;
+    auto z = (corner & 4) ? maximum.z : minimum.z;
+    float clip[4];
+    for (int j = 0; j < 4; ++j)
+    {
+      clip[j] = x * m[j] + y * m[4 + j] + z * m[8 + j] + m[12 + j];
+    }
+    // reaching behind the eye, nothing can be said
+    if (clip[3] < NearW || clip[2] < -clip[3])
+    {
+      return true;
+    }
+    auto inverseW = 1.0f / clip[3];
+    auto windowX = (clip[0] * inverseW * 0.5f + 0.5f) * width;
+    auto windowY = (clip[1] * inverseW * 0.5f + 0.5f) * height;
+    minX = std::min(minX, windowX);
+    maxX = std::max(maxX, windowX);
+    minY = std::min(minY, windowY);
+    maxY = std::max(maxY, windowY);
+    minDepth = std::min(minDepth, clip[2] * inverseW * 0.5f + 0.5f);
+  }
+
+  // off screen is the frustum's business
+  auto x0 = std::max(0, static_cast<int>(std::floor(minX)));
+  auto x1 = std::min(static_cast<int>(m_levels[0].width) - 1, static_cast<int>(std::floor(maxX)));
+  auto y0 = std::max(0, static_cast<int>(std::floor(minY)));
+  auto y1 = std::min(static_cast<int>(m_levels[0].height) - 1, static_cast<int>(std::floor(maxY)));
+  if (x0 > x1 || y0 > y1)
+  {
+    return true;
+  }
+
+  // the finest level where the rectangle touches at most 2 x 2 texels
+  size_t level = 0;
+  while ((x1 >> level) - (x0 >> level) > 1 || (y1 >> level) - (y0 >> level) > 1)
+  {
+    ++level;
+  }
+
+  const auto& texels = m_levels[level];
+  auto farthest = 0.0f;
+  for (auto y = y0 >> level; y <= y1 >> level; ++y)
+  {
+    for (auto x = x0 >> level; x <= x1 >> level; ++x)
+    {
+      farthest = std::max(farthest, texels.depth[static_cast<size_t>(y) * texels.width + static_cast<size_t>(x)]);
+    }
+  }
+  return minDepth <= farthest;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "../linearAlgebra/vector3.h"
+#include "../linearAlgebra/matrix4.h"
+#include "../utils/defines.h"
+
+// Hierarchical Z: a depth image and a chain of levels each holding the farthest depth of 2 x 2 texels of the one
+// below, down to a single texel. A bounding box is hidden when its nearest depth lies behind the farthest depth
+// over its screen rectangle, read from the level where the rectangle spans at most 2 x 2 texels. This is the
+// CPU side of the test hizTest.vert runs on the GL pyramid; the software renderer and the culling of the next
+// frame use it. Depth is window depth in [0, 1], rows go bottom up.
+class HiZPyramid
+{
+public:
+  // level 0 is a copy of depth; stride in floats
+  void build(const float* depth, size_t width, size_t height, size_t stride);
+
+  // seen through viewProjection(); false when it is certainly hidden. thread safe
+  bool visible(const vector3<float>& minimum, const vector3<float>& maximum, const matrix4<float>& modelMatrix) const;
+
+  size_t levels() const
+  {
+    return m_levels.size();
+  }
+
+  size_t width(size_t level) const
+  {
+    return m_levels[level].width;
+  }
+
+  size_t height(size_t level) const
+  {
+    return m_levels[level].height;
+  }
+
+  const float* depth(size_t level) const
+  {
+    return m_levels[level].depth.data();
+  }
+
+  // the camera the depth was rendered with; boxes are projected through it, whatever the current camera
+  DECLARE_PROTECTED_TRIVIAL_ATTRIBUTE(matrix4<float>, viewProjection);
+
+protected:
+  struct Level
+  {
+    size_t width = 0;
+    size_t height = 0;
+    std::vector<float> depth;
+  };
+
+  std::vector<Level> m_levels;
+};
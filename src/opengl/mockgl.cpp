@@ -0,0 +1,266 @@
+#include "mockgl.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "../utils/debugout.h"
+
+namespace {
+  struct Implementation
+  {
+    const char* name;
+    void* function;
+  };
+
+  template<typename Function>
+  Implementation implement(const char* name, Function function)
+  {
+    return { name, reinterpret_cast<void*>(function) };
+  }
+}
+
+std::unique_ptr<MockGL> MockGL::createUnique(bool logCalls)
+{
+  auto mock = std::make_unique<MockGL>();
+  GLDispatch::setBackend(mock.get());
+  GLDispatch::setCounting(true, false, logCalls);
+  GLDispatch::resetCalls();
+  return mock;
+}
+
+MockGL::MockGL()
+{
+  memset(m_viewport, 0, sizeof(m_viewport));
+  m_currentProgram = 0;
+  m_nextName = 1;
+  m_nextSync = 1;
+
+  // what a GL 4.5 class board would answer to the queries the renderer makes
+  m_integers[GL_MAX_SAMPLES] = 8;
+  m_integers[GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT] = 256;
+  m_integers[GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT] = 16;
+  m_integers[GL_MAX_TEXTURE_SIZE] = 16384;
+
+  if (s_instance)
+  {
+    debugLog(">>> MockGL: another instance is installed, replacing it");
+  }
+  s_instance = this;
+}
+
+MockGL::~MockGL()
+{
+  if (s_instance == this)
+  {
+    s_instance = nullptr;
+    if (GLDispatch::backend() == this)
+    {
+      GLDispatch::setBackend(nullptr);
+      GLDispatch::setCounting(false);
+    }
+  }
+}
+
+void* MockGL::resolve(const char* name, void* stub)
+{
+  if (m_unsupported.count(name))
+  {
+    return nullptr;
+  }
+
+  // the EXT and core names of an entry point share one implementation
+  static const Implementation implementations[] = {
+    implement("glGenBuffers", &generate),
+    implement("glGenTextures", &generate),
+    implement("glGenFramebuffers", &generate),
+    implement("glGenFramebuffersEXT", &generate),
+    implement("glGenRenderbuffers", &generate),
+    implement("glGenRenderbuffersEXT", &generate),
+    implement("glGenQueries", &generate),
+    implement("glGenVertexArrays", &generate),
+    implement("glCreateShader", &createShader),
+    implement("glCreateProgram", &createProgram),
+    implement("glGetShaderiv", &getShaderiv),
+    implement("glGetProgramiv", &getProgramiv),
+    implement("glGetUniformLocation", &getUniformLocation),
+    implement("glGetUniformBlockIndex", &getUniformBlockIndex),
+    implement("glGetProgramResourceIndex", &getProgramResourceIndex),
+    implement("glUseProgram", &useProgram),
+    implement("glGetIntegerv", &getIntegerv),
+    implement("glGetFloatv", &getFloatv),
+    implement("glViewport", &viewport),
+    implement("glCheckFramebufferStatus", &checkFramebufferStatus),
+    implement("glCheckFramebufferStatusEXT", &checkFramebufferStatus),
+    implement("glBindBuffer", &bindBuffer),
+    implement("glBufferData", &bufferData),
+    implement("glBufferStorage", &bufferStorage),
+    implement("glBufferSubData", &bufferSubData),
+    implement("glMapBufferRange", &mapBufferRange),
+    implement("glUnmapBuffer", &unmapBuffer),
+    implement("glFenceSync", &fenceSync),
+    implement("glClientWaitSync", &clientWaitSync),
+    implement("glGetQueryObjectuiv", &getQueryObjectuiv),
+  };
+  for (const auto& implementation : implementations)
+  {
+    if (strcmp(implementation.name, name) == 0)
+    {
+      return implementation.function;
+    }
+  }
+  return stub;
+}
+
+void APIENTRY MockGL::generate(GLsizei n, GLuint* names)
+{
+  for (GLsizei i = 0; i < n; ++i)
+  {
+    names[i] = s_instance->m_nextName++;
+  }
+}
+
+GLuint APIENTRY MockGL::createShader(GLenum)
+{
+  return s_instance->m_nextName++;
+}
+
+GLuint APIENTRY MockGL::createProgram()
+{
+  return s_instance->m_nextName++;
+}
+
+void APIENTRY MockGL::getShaderiv(GLuint, GLenum pname, GLint* params)
+{
+  *params = pname == GL_COMPILE_STATUS ? GL_TRUE : 0;
+}
+
+void APIENTRY MockGL::getProgramiv(GLuint, GLenum pname, GLint* params)
+{
+  *params = pname == GL_LINK_STATUS ? GL_TRUE : 0;
+}
+
+GLint APIENTRY MockGL::getUniformLocation(GLuint program, const GLchar* name)
+{
+  // a location per program and name, stable across calls
+  auto& locations = s_instance->m_uniformLocations;
+  auto key = std::to_string(program) + "/" + name;
+  auto found = locations.find(key);
+  if (found != locations.end())
+  {
+    return found->second;
+  }
+  auto location = static_cast<GLint>(locations.size());
+  locations[key] = location;
+  return location;
+}
+
+GLuint APIENTRY MockGL::getUniformBlockIndex(GLuint, const GLchar*)
+{
+  return 0;
+}
+
+GLuint APIENTRY MockGL::getProgramResourceIndex(GLuint, GLenum, const GLchar*)
+{
+  return 0;
+}
+
+void APIENTRY MockGL::useProgram(GLuint program)
+{
+  s_instance->m_currentProgram = program;
+}
+
+void APIENTRY MockGL::getIntegerv(GLenum pname, GLint* params)
+{
+  if (pname == GL_VIEWPORT)
+  {
+    std::copy(s_instance->m_viewport, s_instance->m_viewport + 4, params);
+    return;
+  }
+  if (pname == GL_CURRENT_PROGRAM)
+  {
+    *params = static_cast<GLint>(s_instance->m_currentProgram);
+    return;
+  }
+  auto found = s_instance->m_integers.find(pname);
+  *params = found != s_instance->m_integers.end() ? found->second : 0;
+}
+
+void APIENTRY MockGL::getFloatv(GLenum pname, GLfloat* params)
+{
+  // the matrices come back as identities, the rest as zero
+  auto matrix = pname == GL_MODELVIEW_MATRIX || pname == GL_PROJECTION_MATRIX || pname == GL_TEXTURE_MATRIX;
+  auto count = matrix ? 16 : 4;
+  for (int i = 0; i < count; ++i)
+  {
+    params[i] = matrix && i % 5 == 0 ? 1.0f : 0.0f;
+  }
+}
+
+void APIENTRY MockGL::viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+  s_instance->m_viewport[0] = x;
+  s_instance->m_viewport[1] = y;
+  s_instance->m_viewport[2] = width;
+  s_instance->m_viewport[3] = height;
+}
+
+GLenum APIENTRY MockGL::checkFramebufferStatus(GLenum)
+{
+  return GL_FRAMEBUFFER_COMPLETE;
+}
+
+void APIENTRY MockGL::bindBuffer(GLenum target, GLuint buffer)
+{
+  s_instance->m_boundBuffers[target] = buffer;
+}
+
+void APIENTRY MockGL::bufferData(GLenum target, GLsizeiptr size, const void* data, GLenum)
+{
+  auto& storage = s_instance->m_buffers[s_instance->m_boundBuffers[target]];
+  storage.assign(static_cast<size_t>(size), 0);
+  if (data)
+  {
+    memcpy(storage.data(), data, static_cast<size_t>(size));
+  }
+}
+
+void APIENTRY MockGL::bufferStorage(GLenum target, GLsizeiptr size, const void* data, GLbitfield)
+{
+  bufferData(target, size, data, 0);
+}
+
+void APIENTRY MockGL::bufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data)
+{
+  auto& storage = s_instance->m_buffers[s_instance->m_boundBuffers[target]];
+  if (static_cast<size_t>(offset + size) <= storage.size())
+  {
+    memcpy(storage.data() + offset, data, static_cast<size_t>(size));
+  }
+}
+
+void* APIENTRY MockGL::mapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield)
+{
+  auto& storage = s_instance->m_buffers[s_instance->m_boundBuffers[target]];
+  return static_cast<size_t>(offset + length) <= storage.size() ? storage.data() + offset : nullptr;
+}
+
+GLboolean APIENTRY MockGL::unmapBuffer(GLenum)
+{
+  return GL_TRUE;
+}
+
+GLsync APIENTRY MockGL::fenceSync(GLenum, GLbitfield)
+{
+  // never dereferenced, only handed back
+  return reinterpret_cast<GLsync>(s_instance->m_nextSync++);
+}
+
+GLenum APIENTRY MockGL::clientWaitSync(GLsync, GLbitfield, GLuint64)
+{
+  return GL_ALREADY_SIGNALED;
+}
+
+void APIENTRY MockGL::getQueryObjectuiv(GLuint, GLenum pname, GLuint* params)
+{
+  *params = pname == GL_QUERY_RESULT_AVAILABLE ? GL_TRUE : 0;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "opengl_ext.h"
+
+// A GL without a driver or a context, for running the renderer's logic in tests and benchmarks anywhere.
+// Implements what the renderer reads back: object names, buffer storage to write and map, complete framebuffers,
+// compiled and linked programs, uniform locations, signaled fences and query results; every other entry point
+// does nothing. Installs itself as the GLDispatch backend for its lifetime, one at a time; calls are counted
+// and, if asked for, logged through GLDispatch.
+class MockGL : public GLDispatch::Backend
+{
+public:
+  static std::unique_ptr<MockGL> createUnique(bool logCalls = false);
+
+  MockGL();
+
+  ~MockGL() override;
+
+  void* resolve(const char* name, void* stub) override;
+
+  // entry points reported missing, as by a driver without the version or the extension; takes effect from the
+  // next GLDispatch::setBackend()
+  std::unordered_set<std::string>& unsupported()
+  {
+    return m_unsupported;
+  }
+
+  // what glGetIntegerv answers; anything not in here comes back 0
+  std::unordered_map<GLenum, GLint>& integers()
+  {
+    return m_integers;
+  }
+
+  // the storage of a buffer object, as glBufferData, glBufferSubData and writes through a mapping left it
+  const std::vector<uint8_t>& storage(GLuint buffer)
+  {
+    return m_buffers[buffer];
+  }
+
+  // the current state the mock keeps track of
+  GLuint boundBuffer(GLenum target)
+  {
+    return m_boundBuffers[target];
+  }
+  GLuint currentProgram() const
+  {
+    return m_currentProgram;
+  }
+
+protected:
+  // the GL side, static because GL entry points are plain functions; they go to s_instance
+  static void APIENTRY generate(GLsizei n, GLuint* names);
+  static GLuint APIENTRY createShader(GLenum type);
+  static GLuint APIENTRY createProgram();
+  static void APIENTRY getShaderiv(GLuint shader, GLenum pname, GLint* params);
+  static void APIENTRY getProgramiv(GLuint program, GLenum pname, GLint* params);
+  static GLint APIENTRY getUniformLocation(GLuint program, const GLchar* name);
+  static GLuint APIENTRY getUniformBlockIndex(GLuint program, const GLchar* name);
+  static GLuint APIENTRY getProgramResourceIndex(GLuint program, GLenum programInterface, const GLchar* name);
+  static void APIENTRY useProgram(GLuint program);
+  static void APIENTRY getIntegerv(GLenum pname, GLint* params);
+  static void APIENTRY getFloatv(GLenum pname, GLfloat* params);
+  static void APIENTRY viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+  static GLenum APIENTRY checkFramebufferStatus(GLenum target);
+  static void APIENTRY bindBuffer(GLenum target, GLuint buffer);
+  static void APIENTRY bufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage);
+  static void APIENTRY bufferStorage(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+  static void APIENTRY bufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data);
+  static void* APIENTRY mapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access);
+  static GLboolean APIENTRY unmapBuffer(GLenum target);
+  static GLsync APIENTRY fenceSync(GLenum condition, GLbitfield flags);
+  static GLenum APIENTRY clientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout);
+  static void APIENTRY getQueryObjectuiv(GLuint id, GLenum pname, GLuint* params);
+
+  static inline MockGL* s_instance = nullptr;
+
+  std::unordered_set<std::string> m_unsupported;
+  std::unordered_map<GLenum, GLint> m_integers;
+  std::unordered_map<GLuint, std::vector<uint8_t>> m_buffers;
+  std::unordered_map<GLenum, GLuint> m_boundBuffers;
+  std::unordered_map<std::string, GLint> m_uniformLocations;
+  GLint m_viewport[4];
+  GLuint m_currentProgram;
+  GLuint m_nextName;
+  uintptr_t m_nextSync;
+};
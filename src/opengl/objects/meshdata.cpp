@@ -0,0 +1,88 @@
+#include "meshdata.h"
+
+#include <algorithm>
+
+void MeshData::bounds(vector3<float>& minimum, vector3<float>& maximum) const
+{
+  minimum = maximum = vertices.empty() ? vector3<float>(0, 0, 0) : vertices.front();
+  for (const auto& vertex : vertices)
+  {
+    minimum = { std::min(minimum.x, vertex.x), std::min(minimum.y, vertex.y), std::min(minimum.z, vertex.z) };
+    maximum = { std::max(maximum.x, vertex.x), std::max(maximum.y, vertex.y), std::max(maximum.z, vertex.z) };
+  }
+}
+
+const MeshData& MeshData::cube()
+{
+  static const MeshData cube = {
+    Topology::Triangles,
+    {
+      // front
+      vector3<float>(-1.0f, -1.0f,  1.0f),
+      vector3<float>(1.0f, -1.0f,  1.0f),
+      vector3<float>(1.0f,  1.0f,  1.0f),
+      vector3<float>(-1.0f,  1.0f,  1.0f),
+      // back
+      vector3<float>(-1.0f, -1.0f, -1.0f),
+      vector3<float>(1.0f, -1.0f, -1.0f),
+      vector3<float>(1.0f,  1.0f, -1.0f),
+      vector3<float>(-1.0f,  1.0f, -1.0f)
+    },
+    // !!! these normals are rubbish they should be averaged per vertex
+    {
+      // front
+      vector3<float>(0.0f, 0.0f,  1.0f),
+      vector3<float>(0.0f, 0.0f,  1.0f),
+      vector3<float>(0.0f, 0.0f,  1.0f),
+      vector3<float>(0.0f, 0.0f,  1.0f),
+
+      // back
+      vector3<float>(0.0f, 0.0f, -1.0f),
+      vector3<float>(0.0f, 0.0f, -1.0f),
+      vector3<float>(0.0f,  0.0f, -1.0f),
+      vector3<float>(0.0f,  0.0f, -1.0f)
+    },
+    {
+      // front
+      0, 1, 2,
+      2, 3, 0,
+      // right
+      1, 5, 6,
+      6, 2, 1,
+      // back
+      7, 6, 5,
+      5, 4, 7,
+      // left
+      4, 0, 3,
+      3, 7, 4,
+      // bottom
+      4, 5, 1,
+      1, 0, 4,
+      // top
+      3, 2, 6,
+      6, 7, 3
+    },
+  };
+  return cube;
+}
+
+const MeshData& MeshData::plane()
+{
+  static const MeshData plane = {
+    Topology::Quads,
+    {
+      vector3<float>( 100.0f, 0.0f,  100.0f),
+      vector3<float>( 100.0f, 0.0f, -100.0f),
+      vector3<float>(-100.0f, 0.0f, -100.0f),
+      vector3<float>(-100.0f, 0.0f,  100.0f),
+    },
+    {
+      vector3<float>(0.0, 1.0f, 0.0f),
+      vector3<float>(0.0, 1.0f, 0.0f),
+      vector3<float>(0.0, 1.0f, 0.0f),
+      vector3<float>(0.0, 1.0f, 0.0f),
+    },
+    { 0, 1, 2, 3 },
+  };
+  return plane;
+}
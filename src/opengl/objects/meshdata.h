@@ -0,0 +1,30 @@
+#pragma once
+
+#include <vector>
+
+#include "../../linearAlgebra/vector3.h"
+
+// The geometry of the built-in meshes as plain CPU data, without GL: the VBOs upload it, the software renderer
+// draws it straight from here.
+struct MeshData
+{
+  enum class Topology
+  {
+    Triangles = 0,
+    Quads,      // four indices a face, split along the 0 - 2 diagonal when drawn as triangles
+  };
+
+  Topology topology = Topology::Triangles;
+  std::vector<vector3<float>> vertices;
+  std::vector<vector3<float>> normals;
+  std::vector<unsigned int> indices;
+
+  // axis aligned box around the vertices
+  void bounds(vector3<float>& minimum, vector3<float>& maximum) const;
+
+  // 2 x 2 x 2, centered on the origin
+  static const MeshData& cube();
+
+  // 200 x 200 in the y = 0 plane, facing up
+  static const MeshData& plane();
+};
@@ -0,0 +1,14 @@
+#include "meshobject.h"
+
+#include <algorithm>
+#include <cmath>
+
+MeshObject::MeshObject(const MeshData& mesh) :
+  m_mesh(&mesh),
+  m_boundingRadius(0.0f)
+{
+  for (const auto& vertex : mesh.vertices)
+  {
+    m_boundingRadius = std::max(m_boundingRadius, std::sqrt(vertex.x * vertex.x + vertex.y * vertex.y + vertex.z * vertex.z));
+  }
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <memory>
+
+#include "../sceneobject.h"
+#include "meshdata.h"
+
+// A scene object that only knows its CPU-side mesh: nothing to draw with GL, no context needed to make one.
+// What the headless renderer is given in place of the VBO backed objects.
+class MeshObject : public SceneObject
+{
+public:
+  explicit MeshObject(const MeshData& mesh);
+
+  static std::unique_ptr<MeshObject> createUnique(const MeshData& mesh)
+  {
+    return std::make_unique<MeshObject>(mesh);
+  }
+
+  const MeshData* meshData() const override
+  {
+    return m_mesh;
+  }
+
+  float boundingRadius() const override
+  {
+    return m_boundingRadius;
+  }
+
+protected:
+  const MeshData* m_mesh;
+  float m_boundingRadius;
+};
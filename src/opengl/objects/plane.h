@@ -1,8 +1,9 @@
 #pragma once
 
-#include <Windows.h>
+#include "../glplatform.h"
 #include "../VertexBufferObject.h"
 #include "../sceneobject.h"
+#include "meshdata.h"
 
 class PlaneVBO : public VertexBufferObject, public SceneObject
 {
@@ -11,5 +12,30 @@ public:
 
   static std::unique_ptr<PlaneVBO> createUnique(Shader* shader);
 
-  void draw(const matrix4<float>& projectionMatrix, const matrix4<float>& viewMatrix) override;
+  void drawMesh() override;
+
+  void recordMesh(CommandBuffer& commands) const override
+  {
+    record(commands);
+  }
+
+  const VertexBufferObject* mesh() const override
+  {
+    return this;
+  }
+
+  float boundingRadius() const override
+  {
+    return 141.42136f;// half diagonal of the 200 x 200 quad
+  }
+
+  uint32_t meshID() const override
+  {
+    return geometry();
+  }
+
+  const MeshData* meshData() const override
+  {
+    return &MeshData::plane();
+  }
 };
\ No newline at end of file
@@ -0,0 +1,256 @@
+#include "occlusionbuffer.h"
+
+#include <emmintrin.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+  // clip space w below which a vertex counts as behind the eye
+  const float NearW = 1e-5f;
+
+  // clip = v * m
+  void transform(const vector3<float>& v, const float* m, float clip[4])
+  {
+    for (int j = 0; j < 4; ++j)
+    {
+      clip[j] = v.x * m[j] + v.y * m[4 + j] + v.z * m[8 + j] + m[12 + j];
+    }
+  }
+}
+
+void OcclusionBuffer::resize(size_t width, size_t height)
+{
+  m_width = width;
+  m_height = height;
+  m_stride = (width + 3) / 4 * 4;
+  m_depth.assign(m_stride * m_height, 1.0f);
+}
+
+void OcclusionBuffer::clear(const matrix4<float>& viewProjection)
+{
+  std::fill(m_depth.begin(), m_depth.end(), 1.0f);
+  m_viewProjection = viewProjection;
+}
+
+void OcclusionBuffer::rasterize(const MeshData& mesh, const matrix4<float>& modelMatrix)
+{
+  auto modelViewProjection = modelMatrix * m_viewProjection;
+  const float* m = modelViewProjection.get_openglmatrix();
+
+  // window coordinates of every vertex; those behind the eye are flagged with a negative depth
+  auto& windows = m_windows;
+  windows.resize(mesh.vertices.size() * 3);
+  for (size_t v = 0; v < mesh.vertices.size(); ++v)
+  {
+    float clip[4];
+    transform(mesh.vertices[v], m, clip);
+    auto window = &windows[v * 3];
+    if (clip[3] < NearW || clip[2] < -clip[3])
+    {
+      window[2] = -1.0f;
+      continue;
+    }
+    auto inverseW = 1.0f / clip[3];
+    window[0] = (clip[0] * inverseW * 0.5f + 0.5f) * m_width;
+    window[1] = (clip[1] * inverseW * 0.5f + 0.5f) * m_height;
+    window[2] = clip[2] * inverseW * 0.5f + 0.5f;
+  }
+
+  // a texel two triangles of a face share is covered entirely by neither, so quads are rasterized whole
+  auto polygon = [this, &windows](const unsigned int* indices, int count)
+  {
+    float window[4][3];
+    for (int k = 0; k < count; ++k)
+    {
+      auto source = &windows[indices[k] * 3];
+      if (source[2] < 0.0f)
+      {
+        return;
+      }
+      window[k][0] = source[0];
+      window[k][1] = source[1];
+      window[k][2] = source[2];
+    }
+    rasterizePolygon(window, count);
+  };
+
+  const auto& indices = mesh.indices;
+  if (mesh.topology == MeshData::Topology::Quads)
+  {
+    for (size_t i = 0; i + 3 < indices.size(); i += 4)
+    {
+      polygon(&indices[i], 4);
+    }
+  }
+  else
+  {
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+      polygon(&indices[i], 3);
+    }
+  }
+}
+
+void OcclusionBuffer::rasterizePolygon(const float (&window)[4][3], int count)
+{
+  // twice the signed area; both windings: occluders are closed boxes, drawing their back faces too only costs time
+  auto area = 0.0f;
+  for (int k = 0; k < count; ++k)
+  {
+    const auto& from = window[k];
+    const auto& to = window[(k + 1) % count];
+    area += from[0] * to[1] - from[1] * to[0];
+  }
+  if (area == 0.0f)
+  {
+    return;
+  }
+  auto sign = area > 0.0f ? 1.0f : -1.0f;
+
+  // depth is a plane in window space, through the corner of the polygon's largest triangle there
+  auto corner = 0;
+  auto cornerArea = 0.0f;
+  for (int k = 0; k < count; ++k)
+  {
+    const auto& previous = window[(k + count - 1) % count];
+    const auto& current = window[k];
+    const auto& next = window[(k + 1) % count];
+    auto twice = (current[0] - previous[0]) * (next[1] - previous[1]) - (current[1] - previous[1]) * (next[0] - previous[0]);
+    if (std::abs(twice) > std::abs(cornerArea))
+    {
+      corner = k;
+      cornerArea = twice;
+    }
+  }
+  const auto& p0 = window[(corner + count - 1) % count];
+  const auto& p1 = window[corner];
+  const auto& p2 = window[(corner + 1) % count];
+  auto depthA = ((p1[2] - p0[2]) * (p2[1] - p0[1]) - (p2[2] - p0[2]) * (p1[1] - p0[1])) / cornerArea;
+  auto depthB = ((p2[2] - p0[2]) * (p1[0] - p0[0]) - (p1[2] - p0[2]) * (p2[0] - p0[0])) / cornerArea;
+  auto depthC = p0[2] - depthA * p0[0] - depthB * p0[1];
+  // evaluated at texel centers, the depth at the texel's farthest corner, so that the texel hides no more than
+  // the polygon does
+  depthC += 0.5f * (std::abs(depthA) + std::abs(depthB));
+
+  // texels whose centers are inside the bounds, a superset of the ones the polygon covers
+  auto minX = 1e30f, maxX = -1e30f, minY = 1e30f, maxY = -1e30f;
+  for (int k = 0; k < count; ++k)
+  {
+    minX = std::min(minX, window[k][0]);
+    maxX = std::max(maxX, window[k][0]);
+    minY = std::min(minY, window[k][1]);
+    maxY = std::max(maxY, window[k][1]);
+  }
+  auto x0 = std::max(0, static_cast<int>(std::floor(minX - 0.5f)));
+  auto x1 = std::min(static_cast<int>(m_width) - 1, static_cast<int>(std::ceil(maxX - 0.5f)));
+  auto y0 = std::max(0, static_cast<int>(std::floor(minY - 0.5f)));
+  auto y1 = std::min(static_cast<int>(m_height) - 1, static_cast<int>(std::ceil(maxY - 0.5f)));
+  if (x0 > x1 || y0 > y1)
+  {
+    return;
+  }
+
+  // edge k runs from vertex k to the next: a * x + b * y + c, made non-negative inside whatever the winding.
+  // evaluated at texel centers, c is that of the texel's worst corner: >= 0 when the whole texel is inside
+  __m128 edgeA[4], edgeB[4], edgeC[4];
+  for (int k = 0; k < count; ++k)
+  {
+    const auto& from = window[k];
+    const auto& to = window[(k + 1) % count];
+    auto a = -(to[1] - from[1]) * sign;
+    auto b = (to[0] - from[0]) * sign;
+    auto c = -(a * from[0] + b * from[1]) - 0.5f * (std::abs(a) + std::abs(b));
+    edgeA[k] = _mm_set1_ps(a);
+    edgeB[k] = _mm_set1_ps(b);
+    edgeC[k] = _mm_set1_ps(c);
+  }
+
+  auto zero = _mm_setzero_ps();
+  auto laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+  auto startX = x0 / 4 * 4;
+  for (auto y = y0; y <= y1; ++y)
+  {
+    auto py = _mm_set1_ps(y + 0.5f);
+    auto row = &m_depth[static_cast<size_t>(y) * m_stride];
+    for (auto x = startX; x <= x1; x += 4)
+    {
+      auto px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), laneOffsets);
+      auto inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+      for (int k = 0; k < count; ++k)
+      {
+        inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(edgeA[k], px), _mm_mul_ps(edgeB[k], py)), edgeC[k]), zero));
+      }
+      if (!_mm_movemask_ps(inside))
+      {
+        continue;
+      }
+
+      auto z = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(depthA), px), _mm_mul_ps(_mm_set1_ps(depthB), py)), _mm_set1_ps(depthC));
+      auto stored = _mm_load_ps(row + x);
+      auto nearer = _mm_min_ps(stored, z);
+      _mm_store_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, stored)));
+    }
+  }
+}
+
+bool OcclusionBuffer::visible(const MeshData& mesh, const matrix4<float>& modelMatrix) const
+{
+  vector3<float> minimum, maximum;
+  mesh.bounds(minimum, maximum);
+
+  auto modelViewProjection = modelMatrix * m_viewProjection;
+  const float* m = modelViewProjection.get_openglmatrix();
+
+  // screen rectangle and nearest depth of the box's corners
+  float minX = 1e30f, minY = 1e30f, maxX = -1e30f, maxY = -1e30f, minDepth = 1.0f;
+  for (int corner = 0; corner < 8; ++corner)
+  {
+    vector3<float> position((corner & 1) ? maximum.x : minimum.x, (corner & 2) ? maximum.y : minimum.y, (corner & 4) ? maximum.z : minimum.z);
+    float clip[4];
+    transform(position, m, clip);
+    // reaching behind the eye, nothing can be said
+    if (clip[3] < NearW || clip[2] < -clip[3])
+    {
+      return true;
+    }
+    auto inverseW = 1.0f / clip[3];
+    auto x = (clip[0] * inverseW * 0.5f + 0.5f) * m_width;
+    auto y = (clip[1] * inverseW * 0.5f + 0.5f) * m_height;
+    minX = std::min(minX, x);
+    maxX = std::max(maxX, x);
+    minY = std::min(minY, y);
+    maxY = std::max(maxY, y);
+    minDepth = std::min(minDepth, clip[2] * inverseW * 0.5f + 0.5f);
+  }
+
+  // every texel the rectangle touches, rounded outwards; off screen is the frustum's business
+  auto x0 = std::max(0, static_cast<int>(std::floor(minX)));
+  auto x1 = std::min(static_cast<int>(m_width) - 1, static_cast<int>(std::floor(maxX)));
+  auto y0 = std::max(0, static_cast<int>(std::floor(minY)));
+  auto y1 = std::min(static_cast<int>(m_height) - 1, static_cast<int>(std::floor(maxY)));
+  if (x0 > x1 || y0 > y1)
+  {
+    return true;
+  }
+
+  auto depth = _mm_set1_ps(minDepth);
+  auto laneIndices = _mm_setr_epi32(0, 1, 2, 3);
+  auto startX = x0 / 4 * 4;
+  for (auto y = y0; y <= y1; ++y)
+  {
+    auto row = &m_depth[static_cast<size_t>(y) * m_stride];
+    for (auto x = startX; x <= x1; x += 4)
+    {
+      // lanes in [x0, x1] only
+      auto lanes = _mm_add_epi32(laneIndices, _mm_set1_epi32(x));
+      auto inRange = _mm_andnot_si128(_mm_cmplt_epi32(lanes, _mm_set1_epi32(x0)), _mm_cmplt_epi32(lanes, _mm_set1_epi32(x1 + 1)));
+      auto nearer = _mm_cmplt_ps(depth, _mm_load_ps(row + x));
+      if (_mm_movemask_ps(_mm_and_ps(nearer, _mm_castsi128_ps(inRange))))
+      {
+        return true;
+      }
+    }
+  }
+  return false;
+}
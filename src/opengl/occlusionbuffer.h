@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "../linearAlgebra/matrix4.h"
+#include "objects/meshdata.h"
+
+// Low resolution depth buffer for culling on the CPU: a few occluders are rasterized into it, then the bounding
+// boxes of the other objects are tested against it. Depth is window depth in [0, 1], nearest wins. A texel spans
+// 4x4 pixels of the frame at the default resolution, so occluders are rasterized conservatively: a face only
+// writes the texels it covers entirely, with its farthest depth over the texel, and an object is culled only where
+// its occluders really are in front of it. Both loops run on four texels at a time (SSE2).
+class OcclusionBuffer
+{
+public:
+  static const size_t DefaultWidth = 256;
+  static const size_t DefaultHeight = 192;
+
+  void resize(size_t width, size_t height);
+
+  // back to the far plane; the tests and occluders that follow are seen through viewProjection
+  void clear(const matrix4<float>& viewProjection);
+
+  // the mesh's faces, placed by modelMatrix; faces crossing the near plane are left out
+  void rasterize(const MeshData& mesh, const matrix4<float>& modelMatrix);
+
+  // false when the occluders cover the mesh's bounding box everywhere on screen and are nearer than all of it.
+  // thread safe, as long as nothing is rasterized meanwhile
+  bool visible(const MeshData& mesh, const matrix4<float>& modelMatrix) const;
+
+  size_t width() const
+  {
+    return m_width;
+  }
+
+  size_t height() const
+  {
+    return m_height;
+  }
+
+  // rows of stride() floats, bottom up
+  const float* depth() const
+  {
+    return m_depth.data();
+  }
+
+  size_t stride() const
+  {
+    return m_stride;
+  }
+
+protected:
+  // a convex triangle or quad, window x, y in texels and depth per vertex; a quad's corners lie in one plane
+  void rasterizePolygon(const float (&window)[4][3], int count);
+
+  size_t m_width = 0;
+  size_t m_height = 0;
+  size_t m_stride = 0;    // width rounded up to a whole number of SSE vectors
+  std::vector<float> m_depth;
+  matrix4<float> m_viewProjection;
+  std::vector<float> m_windows;   // of the occluder being rasterized
+};
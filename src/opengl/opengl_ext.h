@@ -13,17 +13,14 @@
 #ifndef __OPENGL_EXT_H__
 #define __OPENGL_EXT_H__
 
-#ifdef _WIN32
-#include <Windows.h>
-#endif
-
-#include <gl/GL.h>
+#include "glplatform.h"
 
 #ifdef GL_GLEXT_VERSION
 #undef GL_GLEXT_VERSION
 #endif // GL_GLEXT_VERSION
 
 #include "glext.h"
+#include "gldispatch.h"
 
 #pragma pack (push, 1)
 
@@ -34,14 +31,143 @@
     \param func_type - the function type
     \param funct_name - the function name
 
+    resolved through GLDispatch, from the driver or from the backend in its place
 */
 #define GET_FUNCTION_POINTER(func_type, func_name)\
+    struct func_name##_name{\
+        static const char* name(){ return #func_name; }\
+    };\
     inline func_type API func_name##_(){\
-        static func_type funny = (func_type)wglGetProcAddress(#func_name);\
-        return funny;\
+        return GLEntryPoint<func_type, func_name##_name>::get();\
     }
 
 
+#pragma region GL_VERSION_1_1
+// opengl32.dll exports these directly; going through GLDispatch like the rest lets a backend replace them too
+typedef void (APIENTRY* PFNGLBEGINPROC)(GLenum mode);
+typedef void (APIENTRY* PFNGLBINDTEXTUREPROC)(GLenum target, GLuint texture);
+typedef void (APIENTRY* PFNGLCLEARPROC)(GLbitfield mask);
+typedef void (APIENTRY* PFNGLCLEARCOLORPROC)(GLclampf red, GLclampf green, GLclampf blue, GLclampf alpha);
+typedef void (APIENTRY* PFNGLCOLOR3UBPROC)(GLubyte red, GLubyte green, GLubyte blue);
+typedef void (APIENTRY* PFNGLCOLORMASKPROC)(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha);
+typedef void (APIENTRY* PFNGLDELETETEXTURESPROC)(GLsizei n, const GLuint* textures);
+typedef void (APIENTRY* PFNGLDEPTHFUNCPROC)(GLenum func);
+typedef void (APIENTRY* PFNGLDEPTHMASKPROC)(GLboolean flag);
+typedef void (APIENTRY* PFNGLDISABLEPROC)(GLenum cap);
+typedef void (APIENTRY* PFNGLDISABLECLIENTSTATEPROC)(GLenum array);
+typedef void (APIENTRY* PFNGLDRAWARRAYSPROC)(GLenum mode, GLint first, GLsizei count);
+typedef void (APIENTRY* PFNGLDRAWBUFFERPROC)(GLenum mode);
+typedef void (APIENTRY* PFNGLDRAWELEMENTSPROC)(GLenum mode, GLsizei count, GLenum type, const GLvoid* indices);
+typedef void (APIENTRY* PFNGLENABLEPROC)(GLenum cap);
+typedef void (APIENTRY* PFNGLENABLECLIENTSTATEPROC)(GLenum array);
+typedef void (APIENTRY* PFNGLENDPROC)(void);
+typedef void (APIENTRY* PFNGLFINISHPROC)(void);
+typedef void (APIENTRY* PFNGLGENTEXTURESPROC)(GLsizei n, GLuint* textures);
+typedef GLenum (APIENTRY* PFNGLGETERRORPROC)(void);
+typedef void (APIENTRY* PFNGLGETFLOATVPROC)(GLenum pname, GLfloat* params);
+typedef void (APIENTRY* PFNGLGETINTEGERVPROC)(GLenum pname, GLint* params);
+typedef const GLubyte* (APIENTRY* PFNGLGETSTRINGPROC)(GLenum name);
+typedef void (APIENTRY* PFNGLGETTEXIMAGEPROC)(GLenum target, GLint level, GLenum format, GLenum type, GLvoid* pixels);
+typedef void (APIENTRY* PFNGLLOADIDENTITYPROC)(void);
+typedef void (APIENTRY* PFNGLMATRIXMODEPROC)(GLenum mode);
+typedef void (APIENTRY* PFNGLORTHOPROC)(GLdouble left, GLdouble right, GLdouble bottom, GLdouble top, GLdouble zNear, GLdouble zFar);
+typedef void (APIENTRY* PFNGLPIXELSTOREIPROC)(GLenum pname, GLint param);
+typedef void (APIENTRY* PFNGLPOLYGONMODEPROC)(GLenum face, GLenum mode);
+typedef void (APIENTRY* PFNGLPOPATTRIBPROC)(void);
+typedef void (APIENTRY* PFNGLPUSHATTRIBPROC)(GLbitfield mask);
+typedef void (APIENTRY* PFNGLREADBUFFERPROC)(GLenum mode);
+typedef void (APIENTRY* PFNGLREADPIXELSPROC)(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, GLvoid* pixels);
+typedef void (APIENTRY* PFNGLTEXCOORD2FPROC)(GLfloat s, GLfloat t);
+typedef void (APIENTRY* PFNGLTEXIMAGE2DPROC)(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const GLvoid* pixels);
+typedef void (APIENTRY* PFNGLTEXPARAMETERIPROC)(GLenum target, GLenum pname, GLint param);
+typedef void (APIENTRY* PFNGLTRANSLATEFPROC)(GLfloat x, GLfloat y, GLfloat z);
+typedef void (APIENTRY* PFNGLVERTEX2FPROC)(GLfloat x, GLfloat y);
+typedef void (APIENTRY* PFNGLVERTEXPOINTERPROC)(GLint size, GLenum type, GLsizei stride, const GLvoid* pointer);
+typedef void (APIENTRY* PFNGLVIEWPORTPROC)(GLint x, GLint y, GLsizei width, GLsizei height);
+
+GET_FUNCTION_POINTER(PFNGLBEGINPROC             , glBegin             )
+GET_FUNCTION_POINTER(PFNGLBINDTEXTUREPROC       , glBindTexture       )
+GET_FUNCTION_POINTER(PFNGLCLEARPROC             , glClear             )
+GET_FUNCTION_POINTER(PFNGLCLEARCOLORPROC        , glClearColor        )
+GET_FUNCTION_POINTER(PFNGLCOLOR3UBPROC          , glColor3ub          )
+GET_FUNCTION_POINTER(PFNGLCOLORMASKPROC         , glColorMask         )
+GET_FUNCTION_POINTER(PFNGLDELETETEXTURESPROC    , glDeleteTextures    )
+GET_FUNCTION_POINTER(PFNGLDEPTHFUNCPROC         , glDepthFunc         )
+GET_FUNCTION_POINTER(PFNGLDEPTHMASKPROC         , glDepthMask         )
+GET_FUNCTION_POINTER(PFNGLDISABLEPROC           , glDisable           )
+GET_FUNCTION_POINTER(PFNGLDISABLECLIENTSTATEPROC, glDisableClientState)
+GET_FUNCTION_POINTER(PFNGLDRAWARRAYSPROC        , glDrawArrays        )
+GET_FUNCTION_POINTER(PFNGLDRAWBUFFERPROC        , glDrawBuffer        )
+GET_FUNCTION_POINTER(PFNGLDRAWELEMENTSPROC      , glDrawElements      )
+GET_FUNCTION_POINTER(PFNGLENABLEPROC            , glEnable            )
+GET_FUNCTION_POINTER(PFNGLENABLECLIENTSTATEPROC , glEnableClientState )
+GET_FUNCTION_POINTER(PFNGLENDPROC               , glEnd               )
+GET_FUNCTION_POINTER(PFNGLFINISHPROC            , glFinish            )
+GET_FUNCTION_POINTER(PFNGLGENTEXTURESPROC       , glGenTextures       )
+GET_FUNCTION_POINTER(PFNGLGETERRORPROC          , glGetError          )
+GET_FUNCTION_POINTER(PFNGLGETFLOATVPROC         , glGetFloatv         )
+GET_FUNCTION_POINTER(PFNGLGETINTEGERVPROC       , glGetIntegerv       )
+GET_FUNCTION_POINTER(PFNGLGETSTRINGPROC         , glGetString         )
+GET_FUNCTION_POINTER(PFNGLGETTEXIMAGEPROC       , glGetTexImage       )
+GET_FUNCTION_POINTER(PFNGLLOADIDENTITYPROC      , glLoadIdentity      )
+GET_FUNCTION_POINTER(PFNGLMATRIXMODEPROC        , glMatrixMode        )
+GET_FUNCTION_POINTER(PFNGLORTHOPROC             , glOrtho             )
+GET_FUNCTION_POINTER(PFNGLPIXELSTOREIPROC       , glPixelStorei       )
+GET_FUNCTION_POINTER(PFNGLPOLYGONMODEPROC       , glPolygonMode       )
+GET_FUNCTION_POINTER(PFNGLPOPATTRIBPROC         , glPopAttrib         )
+GET_FUNCTION_POINTER(PFNGLPUSHATTRIBPROC        , glPushAttrib        )
+GET_FUNCTION_POINTER(PFNGLREADBUFFERPROC        , glReadBuffer        )
+GET_FUNCTION_POINTER(PFNGLREADPIXELSPROC        , glReadPixels        )
+GET_FUNCTION_POINTER(PFNGLTEXCOORD2FPROC        , glTexCoord2f        )
+GET_FUNCTION_POINTER(PFNGLTEXIMAGE2DPROC        , glTexImage2D        )
+GET_FUNCTION_POINTER(PFNGLTEXPARAMETERIPROC     , glTexParameteri     )
+GET_FUNCTION_POINTER(PFNGLTRANSLATEFPROC        , glTranslatef        )
+GET_FUNCTION_POINTER(PFNGLVERTEX2FPROC          , glVertex2f          )
+GET_FUNCTION_POINTER(PFNGLVERTEXPOINTERPROC     , glVertexPointer     )
+GET_FUNCTION_POINTER(PFNGLVIEWPORTPROC          , glViewport          )
+
+#define glBegin              glBegin_()
+#define glBindTexture        glBindTexture_()
+#define glClear              glClear_()
+#define glClearColor         glClearColor_()
+#define glColor3ub           glColor3ub_()
+#define glColorMask          glColorMask_()
+#define glDeleteTextures     glDeleteTextures_()
+#define glDepthFunc          glDepthFunc_()
+#define glDepthMask          glDepthMask_()
+#define glDisable            glDisable_()
+#define glDisableClientState glDisableClientState_()
+#define glDrawArrays         glDrawArrays_()
+#define glDrawBuffer         glDrawBuffer_()
+#define glDrawElements       glDrawElements_()
+#define glEnable             glEnable_()
+#define glEnableClientState  glEnableClientState_()
+#define glEnd                glEnd_()
+#define glFinish             glFinish_()
+#define glGenTextures        glGenTextures_()
+#define glGetError           glGetError_()
+#define glGetFloatv          glGetFloatv_()
+#define glGetIntegerv        glGetIntegerv_()
+#define glGetString          glGetString_()
+#define glGetTexImage        glGetTexImage_()
+#define glLoadIdentity       glLoadIdentity_()
+#define glMatrixMode         glMatrixMode_()
+#define glOrtho              glOrtho_()
+#define glPixelStorei        glPixelStorei_()
+#define glPolygonMode        glPolygonMode_()
+#define glPopAttrib          glPopAttrib_()
+#define glPushAttrib         glPushAttrib_()
+#define glReadBuffer         glReadBuffer_()
+#define glReadPixels         glReadPixels_()
+#define glTexCoord2f         glTexCoord2f_()
+#define glTexImage2D         glTexImage2D_()
+#define glTexParameteri      glTexParameteri_()
+#define glTranslatef         glTranslatef_()
+#define glVertex2f           glVertex2f_()
+#define glVertexPointer      glVertexPointer_()
+#define glViewport           glViewport_()
+#pragma endregion
+
 #pragma region GL_VERSION_1_3
 GET_FUNCTION_POINTER(PFNGLACTIVETEXTUREPROC             , glActiveTexture           )
 GET_FUNCTION_POINTER(PFNGLSAMPLECOVERAGEPROC            , glSampleCoverage          )
@@ -753,6 +879,46 @@ GET_FUNCTION_POINTER(PFNGLISVERTEXARRAYPROC                       , glIsVertexAr
 #define glIsVertexArray                         glIsVertexArray_()
 #pragma endregion
 
+#pragma region GL_VERSION_3_1
+GET_FUNCTION_POINTER(PFNGLDRAWELEMENTSINSTANCEDPROC     , glDrawElementsInstanced     )
+GET_FUNCTION_POINTER(PFNGLCOPYBUFFERSUBDATAPROC         , glCopyBufferSubData         )
+GET_FUNCTION_POINTER(PFNGLGETUNIFORMBLOCKINDEXPROC      , glGetUniformBlockIndex      )
+GET_FUNCTION_POINTER(PFNGLGETACTIVEUNIFORMBLOCKIVPROC   , glGetActiveUniformBlockiv   )
+GET_FUNCTION_POINTER(PFNGLUNIFORMBLOCKBINDINGPROC       , glUniformBlockBinding       )
+
+#define glDrawElementsInstanced       glDrawElementsInstanced_()
+#define glCopyBufferSubData           glCopyBufferSubData_()
+#define glGetUniformBlockIndex        glGetUniformBlockIndex_()
+#define glGetActiveUniformBlockiv     glGetActiveUniformBlockiv_()
+#define glUniformBlockBinding         glUniformBlockBinding_()
+#pragma endregion
+
+#pragma region GL_VERSION_3_2
+GET_FUNCTION_POINTER(PFNGLDRAWELEMENTSBASEVERTEXPROC    , glDrawElementsBaseVertex    )
+GET_FUNCTION_POINTER(PFNGLFENCESYNCPROC                 , glFenceSync                 )
+GET_FUNCTION_POINTER(PFNGLISSYNCPROC                    , glIsSync                    )
+GET_FUNCTION_POINTER(PFNGLDELETESYNCPROC                , glDeleteSync                )
+GET_FUNCTION_POINTER(PFNGLCLIENTWAITSYNCPROC            , glClientWaitSync            )
+GET_FUNCTION_POINTER(PFNGLWAITSYNCPROC                  , glWaitSync                  )
+GET_FUNCTION_POINTER(PFNGLGETINTEGER64VPROC             , glGetInteger64v             )
+
+#define glDrawElementsBaseVertex      glDrawElementsBaseVertex_()
+#define glFenceSync                   glFenceSync_()
+#define glIsSync                      glIsSync_()
+#define glDeleteSync                  glDeleteSync_()
+#define glClientWaitSync              glClientWaitSync_()
+#define glWaitSync                    glWaitSync_()
+#define glGetInteger64v               glGetInteger64v_()
+#pragma endregion
+
+#pragma region GL_VERSION_3_3
+GET_FUNCTION_POINTER(PFNGLQUERYCOUNTERPROC              , glQueryCounter              )
+GET_FUNCTION_POINTER(PFNGLGETQUERYOBJECTUI64VPROC       , glGetQueryObjectui64v       )
+
+#define glQueryCounter                glQueryCounter_()
+#define glGetQueryObjectui64v         glGetQueryObjectui64v_()
+#pragma endregion
+
 #pragma region GL_VERSION_4_0
 GET_FUNCTION_POINTER(PFNGLMINSAMPLESHADINGPROC,                glMinSampleShading                )
 GET_FUNCTION_POINTER(PFNGLBLENDEQUATIONIPROC,                  glBlendEquationi                  )
@@ -848,5 +1014,23 @@ GET_FUNCTION_POINTER(PFNGLGETQUERYINDEXEDIVPROC,               glGetQueryIndexed
 #define glEndQueryIndexed                 glEndQueryIndexed_()
 #define glGetQueryIndexediv               glGetQueryIndexediv_()
 
+#pragma endregion
+
+#pragma region GL_VERSION_4_3
+GET_FUNCTION_POINTER(PFNGLMULTIDRAWELEMENTSINDIRECTPROC , glMultiDrawElementsIndirect )
+GET_FUNCTION_POINTER(PFNGLGETPROGRAMRESOURCEINDEXPROC   , glGetProgramResourceIndex   )
+GET_FUNCTION_POINTER(PFNGLSHADERSTORAGEBLOCKBINDINGPROC , glShaderStorageBlockBinding )
+
+#define glMultiDrawElementsIndirect   glMultiDrawElementsIndirect_()
+#define glGetProgramResourceIndex     glGetProgramResourceIndex_()
+#define glShaderStorageBlockBinding   glShaderStorageBlockBinding_()
+#pragma endregion
+
+#pragma region GL_VERSION_4_4
+GET_FUNCTION_POINTER(PFNGLBUFFERSTORAGEPROC             , glBufferStorage             )
+
+#define glBufferStorage               glBufferStorage_()
+#pragma endregion
+
 #pragma pack (pop)
 #endif// __OPENGL_EXT_H__
\ No newline at end of file
@@ -1,8 +1,7 @@
 #pragma once
 
 #include "sceneobject.h"
-#include <Windows.h>
-#include <gl/GL.h>
+#include "glplatform.h"
 
 class Projector : public SceneObject
 {
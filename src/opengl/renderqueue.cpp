@@ -0,0 +1,103 @@
+#include "renderqueue.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+  const int RadixBits = 8;
+  const int RadixSize = 1 << RadixBits;
+  const int RadixPasses = 64 / RadixBits;
+
+  uint64_t mask(int bits)
+  {
+    return (uint64_t(1) << bits) - 1;
+  }
+}
+
+uint64_t RenderQueue::makeKey(Pass pass, uint32_t shader, uint32_t mesh, float depth, float farPlane)
+{
+  uint64_t quantizedDepth = 0;
+  if (depth > 0 && farPlane > 0)
+  {
+    auto normalized = std::min(depth / farPlane, 1.0f);
+    quantizedDepth = static_cast<uint64_t>(normalized * static_cast<float>(mask(DepthBits)));
+  }
+
+  return (static_cast<uint64_t>(pass) & mask(PassBits)) << (64 - PassBits)
+       | (static_cast<uint64_t>(shader) & mask(ShaderBits)) << (MeshBits + DepthBits)
+       | (static_cast<uint64_t>(mesh) & mask(MeshBits)) << DepthBits
+       | (quantizedDepth & mask(DepthBits));
+}
+
+void RenderQueue::sort()
+{
+  auto count = m_items.size();
+  if (count < 2)
+  {
+    return;
+  }
+
+  // one sweep builds the histograms of all the digits
+  size_t histograms[RadixPasses][RadixSize];
+  memset(histograms, 0, sizeof(histograms));
+  for (const auto& item : m_items)
+  {
+    for (int digit = 0; digit < RadixPasses; ++digit)
+    {
+      ++histograms[digit][(item.key >> (digit * RadixBits)) & (RadixSize - 1)];
+    }
+  }
+
+  m_scratch.resize(count);
+  auto* source = m_items.data();
+  auto* destination = m_scratch.data();
+
+  for (int digit = 0; digit < RadixPasses; ++digit)
+  {
+    auto& histogram = histograms[digit];
+    auto shift = digit * RadixBits;
+
+    // all keys agree on this digit, the pass would be a plain copy
+    if (histogram[(source[0].key >> shift) & (RadixSize - 1)] == count)
+    {
+      continue;
+    }
+
+    size_t offsets[RadixSize];
+    size_t offset = 0;
+    for (int bucket = 0; bucket < RadixSize; ++bucket)
+    {
+      offsets[bucket] = offset;
+      offset += histogram[bucket];
+    }
+
+    for (size_t i = 0; i < count; ++i)
+    {
+      destination[offsets[(source[i].key >> shift) & (RadixSize - 1)]++] = source[i];
+    }
+
+    std::swap(source, destination);
+  }
+
+  if (source != m_items.data())
+  {
+    memcpy(m_items.data(), source, count * sizeof(Item));
+  }
+}
+
+std::pair<const RenderQueue::Item*, const RenderQueue::Item*> RenderQueue::range(Pass pass) const
+{
+  auto begin = m_items.data();
+  auto end = begin + m_items.size();
+
+  auto passBegin = std::lower_bound(begin, end, pass, [](const Item& item, Pass value)
+  {
+    return RenderQueue::pass(item.key) < value;
+  });
+  auto passEnd = std::upper_bound(passBegin, end, pass, [](Pass value, const Item& item)
+  {
+    return value < RenderQueue::pass(item.key);
+  });
+
+  return { passBegin, passEnd };
+}
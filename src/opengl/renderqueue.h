@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <cstddef>
+#include <utility>
+
+class SceneObject;
+
+// Collects the draws of a frame under 64-bit sort keys and radix sorts them, so that the
+// passes are submitted in order, grouped by program and mesh and front to back within a group.
+class RenderQueue
+{
+public:
+  enum class Pass : uint8_t
+  {
+    DepthPrePass = 0,
+    GBuffer,
+    Shadow,
+    Num,
+  };
+
+  struct Item
+  {
+    uint64_t key;
+    SceneObject* object;
+    uint32_t index;   // the object's slot in the frame's per-object data
+  };
+
+  // key layout, most significant first: | pass : 4 | shader : 12 | mesh : 24 | depth : 24 |
+  static const int DepthBits = 24;
+  static const int MeshBits = 24;
+  static const int ShaderBits = 12;
+  static const int PassBits = 4;
+
+  // depth is the view depth, quantized over [0, farPlane]; anything behind the camera maps to 0
+  static uint64_t makeKey(Pass pass, uint32_t shader, uint32_t mesh, float depth, float farPlane);
+
+  static Pass pass(uint64_t key)
+  {
+    return static_cast<Pass>(key >> (64 - PassBits));
+  }
+
+  void clear()
+  {
+    m_items.clear();
+  }
+
+  void push(uint64_t key, SceneObject* object, uint32_t index)
+  {
+    m_items.push_back({ key, object, index });
+  }
+
+  // stable LSD radix sort on the keys, 8 bits per pass; digits shared by every key are skipped
+  void sort();
+
+  // the sorted items of one pass; valid after sort()
+  std::pair<const Item*, const Item*> range(Pass pass) const;
+
+  template<typename Function>
+  void submit(Pass pass, Function function) const
+  {
+    auto items = range(pass);
+    for (auto item = items.first; item != items.second; ++item)
+    {
+      function(*item);
+    }
+  }
+
+  size_t size() const
+  {
+    return m_items.size();
+  }
+
+  const std::vector<Item>& items() const
+  {
+    return m_items;
+  }
+
+protected:
+  std::vector<Item> m_items;
+  std::vector<Item> m_scratch;
+};
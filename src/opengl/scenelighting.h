@@ -0,0 +1,44 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+#include "../linearAlgebra/vector3.h"
+
+// The lights and projectors the scene is lit with. DeferredRenderer and its CPU reference, SoftwareRenderer, both
+// start from standard(), so the reference can't drift from what GL renders.
+struct SceneLighting
+{
+  static const size_t NumLights = 3;    // has to match numLights in deferredPass1.frag
+
+  struct Light
+  {
+    vector3<float> position;
+    vector3<float> color;
+  };
+  using Lights = std::array<Light, NumLights>;
+
+  // a 10 degree cone from position along direction
+  struct Projector
+  {
+    vector3<float> position;
+    vector3<float> direction;
+  };
+
+  Lights lights;
+  Projector surfaceProjector;   // painted into the G-buffer
+  Projector lightProjector;     // highlights the lit image
+
+  static SceneLighting standard()
+  {
+    SceneLighting lighting;
+    lighting.lights = { {
+      { { 10, 30, 0 },    { 1, 1, 0 } },
+      { { -40, 30, 45 },  { 1, 0, 1 } },
+      { { 60, 25, -40 },  { 0, 1, 1 } },
+    } };
+    lighting.surfaceProjector = { { 0, 30, 0 }, { -1, -1, 0 } };
+    lighting.lightProjector = { { 0, 30, 0 }, { -2, -1, 0 } };
+    return lighting;
+  }
+};
@@ -1,5 +1,7 @@
 #include "sceneobject.h"
 
+#include <cstring>
+
 matrix4<float> SceneObject::transformMatrix()
 {
   matrix4<float> transform;
@@ -10,4 +12,16 @@ matrix4<float> SceneObject::transformMatrix()
   transform.translate(m_position);
 
   return transform;
+}
+
+void SceneObject::constants(const matrix4<float>& viewMatrix, Constants& out)
+{
+  auto modelMatrix = transformMatrix();
+  auto modelViewMatrix = modelMatrix * viewMatrix;
+  memcpy(out.modelViewMatrix, modelViewMatrix.get_openglmatrix(), sizeof(out.modelViewMatrix));
+  memcpy(out.modelMatrix, modelMatrix.get_openglmatrix(), sizeof(out.modelMatrix));
+  out.color[0] = m_color.x;
+  out.color[1] = m_color.y;
+  out.color[2] = m_color.z;
+  out.color[3] = 0.0f;
 }
\ No newline at end of file
@@ -4,6 +4,12 @@
 #include "../linearAlgebra/vector3.h"
 #include "../linearAlgebra/matrix4.h"
 #include "shaders.h"
+#include "VertexBufferObject.h"
+
+#include <cstdint>
+
+class CommandBuffer;
+struct MeshData;
 
 
 class SceneObject
@@ -21,9 +27,60 @@ class SceneObject
   }
 
 public:
+  // per-object constants, laid out as the std140 ObjectData block of the G-buffer programs
+  struct Constants
+  {
+    float modelViewMatrix[16];
+    float modelMatrix[16];
+    float color[4];
+  };
+
   matrix4<float> transformMatrix();
 
-  virtual void draw(const matrix4<float>& projectionMatrix, const matrix4<float>& viewMatrix) = 0;
+  void constants(const matrix4<float>& viewMatrix, Constants& out);
+
+  // binds what a pass takes from the object, Projector its texture; meshes are drawn through drawMesh()
+  virtual void draw(const matrix4<float>& projectionMatrix, const matrix4<float>& viewMatrix)
+  {
+    UNREFERENCED_PARAMETER(projectionMatrix);
+    UNREFERENCED_PARAMETER(viewMatrix);
+  }
+
+  // issues the draw call only; the program and the ObjectData block have to be bound already
+  virtual void drawMesh()
+  {
+    ;
+  }
+
+  // drawMesh() into a command buffer, for replay with the geometry arena bound
+  virtual void recordMesh(CommandBuffer& commands) const
+  {
+    UNREFERENCED_PARAMETER(commands);
+  }
+
+  // the geometry drawMesh() draws, if it lives in a VertexBufferObject; lets the renderer draw it indirectly
+  virtual const VertexBufferObject* mesh() const
+  {
+    return nullptr;
+  }
+
+  // the same geometry as plain CPU data, for the software renderer
+  virtual const MeshData* meshData() const
+  {
+    return nullptr;
+  }
+
+  // radius of a sphere around position() holding the whole object, for culling
+  virtual float boundingRadius() const
+  {
+    return 0.0f;
+  }
+
+  // identifies the geometry for draw sorting; objects sharing it are submitted back to back
+  virtual uint32_t meshID() const
+  {
+    return 0;
+  }
 
 protected:
   Shader* m_shader = nullptr;
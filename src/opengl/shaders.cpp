@@ -1,7 +1,8 @@
 ﻿#include "shaders.h"
 
+#include <algorithm>
 #include <fstream>
-#include <gl/GL.h>
+#include "glplatform.h"
 #include <unordered_map>
 
 #include "opengl_ext.h"
@@ -23,9 +24,30 @@ namespace {
 
       out.resize(fileSize);
       file.read(const_cast<char*>(out.c_str()), fileSize);
+
+      // fewer characters than bytes where the line ends are translated, as on Windows; reading them all only
+      // hits the end of the file there, so eof() alone tells nothing elsewhere
+      out.resize(static_cast<size_t>(file.gcount()));
+      return file.gcount() > 0 || fileSize == 0;
     }
 
-    return file.eof();
+    return false;
+  }
+
+  // shared by every shader, put in after their #version line
+  const char* FrameDataFile = "res/shaders/frameData.glsl";
+
+  void insertAfterVersion(std::string& shaderCode, const std::string& prelude)
+  {
+    auto lineEnd = shaderCode.find('\n', shaderCode.find("#version"));
+    if (lineEnd == std::string::npos)
+    {
+      shaderCode.insert(0, prelude + "\n#line 1\n");
+      return;
+    }
+    // the compiler's line numbers still point into the file
+    auto nextLine = 2 + std::count(shaderCode.begin(), shaderCode.begin() + lineEnd, '\n');
+    shaderCode.insert(lineEnd + 1, prelude + "\n#line " + std::to_string(nextLine) + "\n");
   }
 
   bool compile(GLenum shaderType​, const std::string& shaderCode, GLuint& shader)
@@ -47,7 +69,7 @@ namespace {
       glGetShaderInfoLog(shader, logSize, &written, shaderLogString);
 
       debugLog(">>> Shader failed to compile. Error log is:\n%", shaderLogString);
-      debugLog(shaderCode.c_str());
+      debugLog("%", shaderCode);
       glDeleteShader(shader);
       shader = 0;
     }
@@ -131,12 +153,19 @@ std::unique_ptr<Shader> Shader::fromFiles(const char* vertexShader, const char*
 
   GLuint glVertexShader = 0, glFragmentShader = 0, glProgram = 0;
 
+  std::string frameData;
+  if (!readFile(FrameDataFile, frameData))
+  {
+    debugLog(">>> Failed to read %", FrameDataFile);
+  }
+
   if (!readFile(vertexShader, vertexShaderCode))
   {
     debugLog(">>> Failed to read vertex shader %", vertexShader);
   }
   else
   {
+    insertAfterVersion(vertexShaderCode, frameData);
     compile(GL_VERTEX_SHADER, vertexShaderCode, glVertexShader);
   }
 
@@ -146,6 +175,7 @@ std::unique_ptr<Shader> Shader::fromFiles(const char* vertexShader, const char*
   }
   else
   {
+    insertAfterVersion(fragmentShaderCode, frameData);
     compile(GL_FRAGMENT_SHADER, fragmentShaderCode, glFragmentShader);
   }
 
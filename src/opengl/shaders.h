@@ -1,12 +1,26 @@
 #ifndef __SHADERS_H__
 #define __SHADERS_H__
 
-#include <Windows.h>
-#include <gl/GL.h>
+#include "glplatform.h"
 #include "opengl_ext.h"
 #include "glutils.h"
+#include <memory>
 #include <unordered_map>
 
+// binding points of the uniform blocks shared between programs
+enum class UniformBlock : GLuint
+{
+  Object = 0,
+  Frame = 1,
+  Lights = 2,
+};
+
+// binding points of the shader storage blocks
+enum class StorageBlock : GLuint
+{
+  Objects = 0,
+};
+
 class Shader
 {
 public:
@@ -24,6 +38,11 @@ public:
     }    
   }
 
+  GLuint program() const
+  {
+    return programID;
+  }
+
   static void detach()
   {    
     glUseProgram(0);
@@ -63,6 +82,27 @@ public:
     OPENGL_CHECK_ERROR();
   }
 
+  // routes the named uniform block to a binding point; programs without the block are left alone
+  void bindUniformBlock(const char* name, UniformBlock binding)
+  {
+    auto index = glGetUniformBlockIndex(programID, name);
+    if (index != GL_INVALID_INDEX)
+    {
+      glUniformBlockBinding(programID, index, static_cast<GLuint>(binding));
+    }
+    OPENGL_CHECK_ERROR();
+  }
+
+  void bindStorageBlock(const char* name, StorageBlock binding)
+  {
+    auto index = glGetProgramResourceIndex(programID, GL_SHADER_STORAGE_BLOCK, name);
+    if (index != GL_INVALID_INDEX)
+    {
+      glShaderStorageBlockBinding(programID, index, static_cast<GLuint>(binding));
+    }
+    OPENGL_CHECK_ERROR();
+  }
+
   Shader(GLuint _programID, std::unordered_map<std::string, int>& _uniforms) :
     programID(_programID)  
   {
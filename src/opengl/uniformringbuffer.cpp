@@ -0,0 +1,152 @@
+#include "uniformringbuffer.h"
+#include "glutils.h"
+
+#include <algorithm>
+
+#include "../utils/debugout.h"
+
+std::unique_ptr<UniformRingBuffer> UniformRingBuffer::createUnique(size_t bytesPerFrame)
+{
+  auto ring = std::make_unique<UniformRingBuffer>();
+
+  GLint alignment = 0;
+  glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+  ring->m_alignment = alignment > 0 ? static_cast<size_t>(alignment) : 256;
+  if (glMultiDrawElementsIndirect)
+  {
+    // GL 4.3: allocations may also be bound as storage blocks
+    GLint storageAlignment = 0;
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storageAlignment);
+    ring->m_alignment = std::max(ring->m_alignment, static_cast<size_t>(storageAlignment));
+  }
+
+  // every region has to start on a bindable offset
+  ring->m_bytesPerFrame = ring->alignUp(bytesPerFrame);
+  auto totalSize = static_cast<GLsizeiptr>(ring->m_bytesPerFrame * Frames);
+
+  glGenBuffers(1, &ring->m_buffer);
+  glBindBuffer(GL_UNIFORM_BUFFER, ring->m_buffer);
+
+  if (glBufferStorage)
+  {
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glBufferStorage(GL_UNIFORM_BUFFER, totalSize, nullptr, flags);
+    ring->m_mapped = static_cast<uint8_t*>(glMapBufferRange(GL_UNIFORM_BUFFER, 0, totalSize, flags));
+  }
+
+  if (!ring->m_mapped)
+  {
+    if (glBufferStorage)
+    {
+      // immutable storage can't be respecified, start over with a mutable buffer
+      glBindBuffer(GL_UNIFORM_BUFFER, 0);
+      glDeleteBuffers(1, &ring->m_buffer);
+      glGenBuffers(1, &ring->m_buffer);
+      glBindBuffer(GL_UNIFORM_BUFFER, ring->m_buffer);
+    }
+    debugLog("Uniform ring buffer: no persistent mapping, falling back to glBufferSubData");
+    glBufferData(GL_UNIFORM_BUFFER, totalSize, nullptr, GL_STREAM_DRAW);
+    ring->m_staging.resize(ring->m_bytesPerFrame);
+  }
+
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+  OPENGL_CHECK_ERROR();
+
+  return ring;
+}
+
+UniformRingBuffer::~UniformRingBuffer()
+{
+  if (haveOpenGLContext())
+  {
+    for (auto& fence : m_fences)
+    {
+      if (fence)
+      {
+        glDeleteSync(fence);
+      }
+    }
+
+    if (m_mapped)
+    {
+      glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+      glUnmapBuffer(GL_UNIFORM_BUFFER);
+      glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+    // the driver keeps the storage alive until the draws still reading it are done
+    glDeleteBuffers(1, &m_buffer);
+  }
+}
+
+void UniformRingBuffer::beginFrame()
+{
+  if (m_open)
+  {
+    endFrame();
+  }
+
+  auto& fence = m_fences[m_frame];
+  if (fence)
+  {
+    // with three regions this only blocks when the CPU runs more than two frames ahead
+    GLenum result = GL_TIMEOUT_EXPIRED;
+    GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+    while (result == GL_TIMEOUT_EXPIRED)
+    {
+      result = glClientWaitSync(fence, flags, 1000000);// 1 ms
+      flags = 0;
+    }
+    if (result == GL_WAIT_FAILED)
+    {
+      debugLog(">>> Uniform ring buffer: waiting on frame % failed", m_frame);
+    }
+    glDeleteSync(fence);
+    fence = nullptr;
+  }
+
+  m_head = 0;
+  m_flushed = 0;
+  m_open = true;
+}
+
+void* UniformRingBuffer::allocate(size_t size, GLintptr& offset)
+{
+  auto start = alignUp(m_head);
+  if (start + size > m_bytesPerFrame)
+  {
+    return nullptr;
+  }
+  m_head = start + size;
+  offset = static_cast<GLintptr>(regionOffset() + start);
+
+  return m_mapped ? m_mapped + regionOffset() + start : m_staging.data() + start;
+}
+
+void UniformRingBuffer::flush()
+{
+  if (m_mapped || m_head == m_flushed)
+  {
+    return;
+  }
+
+  glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+  glBufferSubData(GL_UNIFORM_BUFFER, static_cast<GLintptr>(regionOffset() + m_flushed), static_cast<GLsizeiptr>(m_head - m_flushed), m_staging.data() + m_flushed);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+  m_flushed = m_head;
+}
+
+void UniformRingBuffer::endFrame()
+{
+  if (!m_open)
+  {
+    return;
+  }
+
+  flush();
+  if (glFenceSync)
+  {
+    m_fences[m_frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  }
+  m_frame = (m_frame + 1) % Frames;
+  m_open = false;
+}
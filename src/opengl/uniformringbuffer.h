@@ -0,0 +1,118 @@
+#pragma once
+
+#include "glplatform.h"
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "opengl_ext.h"
+
+// Per-frame storage for uniform block data. The buffer is split in Frames regions: the CPU fills one while
+// the GPU may still be reading the other ones, and a fence per region says when it can be written again.
+// With glBufferStorage (GL 4.4) the buffer is persistently mapped and written in place; otherwise the
+// writes land in a staging copy which flush() uploads with glBufferSubData.
+class UniformRingBuffer
+{
+public:
+  static const size_t Frames = 3;
+
+  static std::unique_ptr<UniformRingBuffer> createUnique(size_t bytesPerFrame);
+
+  UniformRingBuffer()
+  {
+    m_buffer = 0;
+    m_mapped = nullptr;
+    memset(m_fences, 0, sizeof(m_fences));
+    m_bytesPerFrame = 0;
+    m_alignment = 1;
+    m_frame = 0;
+    m_head = 0;
+    m_flushed = 0;
+    m_open = false;
+  }
+
+  ~UniformRingBuffer();
+
+  // waits until the GPU is done with the current region and rewinds it; a frame still open is ended first,
+  // so its region gets fenced even when the caller never got to endFrame()
+  void beginFrame();
+
+  // reserves size bytes in the current region, aligned for glBindBufferRange; offset is relative to the buffer.
+  // returns nullptr when the region is full
+  void* allocate(size_t size, GLintptr& offset);
+
+  // makes this frame's writes visible to the GPU; nothing to do when persistently mapped
+  void flush();
+
+  // fences the current region and moves on to the next one; nothing to do without an open frame
+  void endFrame();
+
+  void bind(GLuint binding, GLintptr offset, GLsizeiptr size) const
+  {
+    glBindBufferRange(GL_UNIFORM_BUFFER, binding, m_buffer, offset, size);
+  }
+
+  // the same memory seen as a shader storage block (GL 4.3)
+  void bindStorage(GLuint binding, GLintptr offset, GLsizeiptr size) const
+  {
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, binding, m_buffer, offset, size);
+  }
+
+  size_t alignUp(size_t size) const
+  {
+    return (size + m_alignment - 1) / m_alignment * m_alignment;
+  }
+
+  size_t alignment() const
+  {
+    return m_alignment;
+  }
+
+  size_t bytesPerFrame() const
+  {
+    return m_bytesPerFrame;
+  }
+
+  // between beginFrame() and endFrame()
+  bool open() const
+  {
+    return m_open;
+  }
+
+  bool persistentlyMapped() const
+  {
+    return m_mapped != nullptr;
+  }
+
+  GLuint buffer() const
+  {
+    return m_buffer;
+  }
+
+  // start of the current frame's region
+  GLintptr frameOffset() const
+  {
+    return static_cast<GLintptr>(regionOffset());
+  }
+
+protected:
+  size_t regionOffset() const
+  {
+    return m_frame * m_bytesPerFrame;
+  }
+
+  GLuint m_buffer;
+  uint8_t* m_mapped;
+  std::vector<uint8_t> m_staging;
+  GLsync m_fences[Frames];
+
+  size_t m_bytesPerFrame;
+  size_t m_alignment;
+  size_t m_frame;
+  size_t m_head;      // bytes allocated in the current region
+  size_t m_flushed;   // bytes of the current region already uploaded (staging path)
+  bool m_open;
+};
@@ -0,0 +1,187 @@
+#ifndef _WIN32
+
+#include "eglplatform.h"
+
+#include <EGL/eglext.h>
+#include <dlfcn.h>
+
+#include <cstring>
+#include <vector>
+
+#include "../opengl/gldispatch.h"
+#include "../utils/debugout.h"
+
+namespace {
+  const EGLint MaxDevices = 8;
+
+  struct Candidate
+  {
+    const char* kind;
+    EGLDisplay display;
+  };
+
+  bool hasExtension(const char* extensions, const char* name)
+  {
+    return extensions && strstr(extensions, name) != nullptr;
+  }
+
+  // devices first, they are the GPUs; then Mesa's software path; then whatever the default display is
+  std::vector<Candidate> candidateDisplays()
+  {
+    std::vector<Candidate> candidates;
+
+    auto clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+    if (getPlatformDisplay && hasExtension(clientExtensions, "EGL_EXT_platform_device"))
+    {
+      auto queryDevices = reinterpret_cast<PFNEGLQUERYDEVICESEXTPROC>(eglGetProcAddress("eglQueryDevicesEXT"));
+      EGLDeviceEXT devices[MaxDevices];
+      EGLint numDevices = 0;
+      if (queryDevices && queryDevices(MaxDevices, devices, &numDevices))
+      {
+        for (EGLint i = 0; i < numDevices; ++i)
+        {
+          candidates.push_back({ "device", getPlatformDisplay(EGL_PLATFORM_DEVICE_EXT, devices[i], nullptr) });
+        }
+      }
+    }
+    if (getPlatformDisplay && hasExtension(clientExtensions, "EGL_MESA_platform_surfaceless"))
+    {
+      candidates.push_back({ "surfaceless", getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr) });
+    }
+    candidates.push_back({ "default", eglGetDisplay(EGL_DEFAULT_DISPLAY) });
+    return candidates;
+  }
+
+  void* procAddress(const char* name)
+  {
+    // EGL_KHR_get_all_proc_addresses covers GL 1.1 too, older EGLs only know extensions
+    if (auto function = reinterpret_cast<void*>(eglGetProcAddress(name)))
+    {
+      return function;
+    }
+    static void* openGL = dlopen("libOpenGL.so.0", RTLD_LAZY | RTLD_LOCAL);
+    static void* libGL = dlopen("libGL.so.1", RTLD_LAZY | RTLD_LOCAL);
+    auto library = openGL ? openGL : libGL;
+    return library ? dlsym(library, name) : nullptr;
+  }
+
+  bool currentContext()
+  {
+    return eglGetCurrentContext() != EGL_NO_CONTEXT;
+  }
+}
+
+std::unique_ptr<EglPlatform> EglPlatform::createUnique(int width, int height)
+{
+  auto platform = std::make_unique<EglPlatform>();
+  for (const auto& candidate : candidateDisplays())
+  {
+    if (candidate.display != EGL_NO_DISPLAY && platform->createContext(candidate.display, width, height))
+    {
+      debugLog("EGL: % display, % x % pbuffer, % %", candidate.kind, width, height, eglQueryString(candidate.display, EGL_VENDOR), eglQueryString(candidate.display, EGL_VERSION));
+      GLDispatch::setDriver(&procAddress, &currentContext);
+      return platform;
+    }
+  }
+  debugLog(">>> EGL: no display could make a GL context, error %", eglGetError());
+  return nullptr;
+}
+
+EglPlatform::EglPlatform()
+{
+  m_display = EGL_NO_DISPLAY;
+  m_surface = EGL_NO_SURFACE;
+  m_context = EGL_NO_CONTEXT;
+}
+
+EglPlatform::~EglPlatform()
+{
+  if (m_display == EGL_NO_DISPLAY)
+  {
+    return;
+  }
+  GLDispatch::setDriver(nullptr, nullptr);
+  eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+  eglDestroyContext(m_display, m_context);
+  eglDestroySurface(m_display, m_surface);
+  eglTerminate(m_display);
+}
+
+void EglPlatform::swapBuffers()
+{
+  // no effect on a pbuffer, kept for the frame to end the same way as with a window
+  eglSwapBuffers(m_display, m_surface);
+}
+
+void EglPlatform::setSwapInterval(int interval)
+{
+  eglSwapInterval(m_display, interval);
+}
+
+bool EglPlatform::createContext(EGLDisplay display, int width, int height)
+{
+  EGLint major = 0;
+  EGLint minor = 0;
+  if (!eglInitialize(display, &major, &minor))
+  {
+    return false;
+  }
+
+  const EGLint configAttributes[] = {
+    EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+    EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+    EGL_RED_SIZE, 8,
+    EGL_GREEN_SIZE, 8,
+    EGL_BLUE_SIZE, 8,
+    EGL_ALPHA_SIZE, 8,
+    EGL_DEPTH_SIZE, 24,
+    EGL_STENCIL_SIZE, 8,
+    EGL_NONE,
+  };
+  EGLConfig config = nullptr;
+  EGLint numConfigs = 0;
+  if (!eglBindAPI(EGL_OPENGL_API) || !eglChooseConfig(display, configAttributes, &config, 1, &numConfigs) || numConfigs == 0)
+  {
+    eglTerminate(display);
+    return false;
+  }
+
+  const EGLint surfaceAttributes[] = {
+    EGL_WIDTH, width,
+    EGL_HEIGHT, height,
+    EGL_NONE,
+  };
+  auto surface = eglCreatePbufferSurface(display, config, surfaceAttributes);
+
+  // the renderer still draws a few things the GL 1.x way, which a core profile doesn't have
+  const EGLint contextAttributes[] = {
+    EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT,
+    EGL_NONE,
+  };
+  auto context = EGL_NO_CONTEXT;
+  if (surface != EGL_NO_SURFACE)
+  {
+    context = eglCreateContext(display, config, EGL_NO_CONTEXT, major > 1 || minor >= 5 ? contextAttributes : nullptr);
+  }
+  if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, surface, surface, context))
+  {
+    if (context != EGL_NO_CONTEXT)
+    {
+      eglDestroyContext(display, context);
+    }
+    if (surface != EGL_NO_SURFACE)
+    {
+      eglDestroySurface(display, surface);
+    }
+    eglTerminate(display);
+    return false;
+  }
+
+  m_display = display;
+  m_surface = surface;
+  m_context = context;
+  return true;
+}
+
+#endif // !_WIN32
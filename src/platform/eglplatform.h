@@ -0,0 +1,47 @@
+#pragma once
+
+#include <EGL/egl.h>
+
+#include <memory>
+
+#include "platform.h"
+
+// A GL context on EGL without a window system, Linux only: a device (a GPU, no X or Wayland needed), Mesa's
+// surfaceless platform (llvmpipe when there's no GPU) or whatever the default display is, tried in that order.
+// The default framebuffer is a pbuffer; there are no events and no keys.
+class EglPlatform : public Platform
+{
+public:
+  // nullptr if no display could make a GL context with a width x height pbuffer
+  static std::unique_ptr<EglPlatform> createUnique(int width, int height);
+
+  EglPlatform();
+
+  ~EglPlatform() override;
+
+  const char* name() const override
+  {
+    return "EGL";
+  }
+
+  bool shouldClose() const override
+  {
+    return false;
+  }
+
+  void swapBuffers() override;
+
+  void pollEvents() override
+  {
+  }
+
+  void setSwapInterval(int interval) override;
+
+protected:
+  // the context on an initialized display, false to try the next one
+  bool createContext(EGLDisplay display, int width, int height);
+
+  EGLDisplay m_display;
+  EGLSurface m_surface;
+  EGLContext m_context;
+};
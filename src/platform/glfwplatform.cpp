@@ -0,0 +1,119 @@
+#include "glfwplatform.h"
+
+// the tree's GL headers come with opengl_ext.h, GLFW's own would clash with them
+#define GLFW_INCLUDE_NONE
+#include <glfw3.h>
+
+#include "../opengl/gldispatch.h"
+#include "../utils/debugout.h"
+
+#pragma comment (lib, "glfw3.lib")
+
+namespace {
+  struct KeyBinding
+  {
+    Platform::Key key;
+    int glfwKey;
+  };
+
+  const KeyBinding KeyBindings[] = {
+    { Platform::Key::Up, GLFW_KEY_UP },
+    { Platform::Key::Down, GLFW_KEY_DOWN },
+    { Platform::Key::Left, GLFW_KEY_LEFT },
+    { Platform::Key::Right, GLFW_KEY_RIGHT },
+    { Platform::Key::Numpad2, GLFW_KEY_KP_2 },
+    { Platform::Key::Numpad3, GLFW_KEY_KP_3 },
+    { Platform::Key::Numpad4, GLFW_KEY_KP_4 },
+    { Platform::Key::Numpad6, GLFW_KEY_KP_6 },
+    { Platform::Key::Numpad8, GLFW_KEY_KP_8 },
+    { Platform::Key::Numpad9, GLFW_KEY_KP_9 },
+  };
+
+#ifndef _WIN32
+  void* procAddress(const char* name)
+  {
+    return reinterpret_cast<void*>(glfwGetProcAddress(name));
+  }
+
+  bool currentContext()
+  {
+    return glfwGetCurrentContext() != nullptr;
+  }
+#endif
+}
+
+std::unique_ptr<GlfwPlatform> GlfwPlatform::createUnique(int width, int height, const char* title, int refreshRate, bool visible)
+{
+  if (!glfwInit())
+  {
+    debugLog(">>> Failed to initialize GLFW!");
+    return nullptr;
+  }
+
+  glfwWindowHint(GLFW_REFRESH_RATE, refreshRate ? refreshRate : GLFW_DONT_CARE);
+  glfwWindowHint(GLFW_DOUBLEBUFFER, GLFW_TRUE);
+  glfwWindowHint(GLFW_VISIBLE, visible ? GLFW_TRUE : GLFW_FALSE);
+
+  auto platform = std::make_unique<GlfwPlatform>();
+  platform->m_window = glfwCreateWindow(width, height, title, NULL, NULL);
+  if (!platform->m_window)
+  {
+    debugLog(">>> Failed to create a % x % GLFW window", width, height);
+    return nullptr;
+  }
+
+  if (visible)
+  {
+    glfwShowWindow(platform->m_window);
+  }
+  glfwMakeContextCurrent(platform->m_window);
+
+#ifndef _WIN32
+  // on Windows the default wgl lookup is what GLFW does too
+  GLDispatch::setDriver(&procAddress, &currentContext);
+#endif
+  return platform;
+}
+
+GlfwPlatform::GlfwPlatform()
+{
+  m_window = nullptr;
+}
+
+GlfwPlatform::~GlfwPlatform()
+{
+#ifndef _WIN32
+  GLDispatch::setDriver(nullptr, nullptr);
+#endif
+  if (m_window)
+  {
+    glfwDestroyWindow(m_window);
+  }
+  glfwTerminate();
+}
+
+bool GlfwPlatform::shouldClose() const
+{
+  return glfwWindowShouldClose(m_window) != 0;
+}
+
+void GlfwPlatform::swapBuffers()
+{
+  glfwSwapBuffers(m_window);
+}
+
+void GlfwPlatform::pollEvents()
+{
+  glfwPollEvents();
+
+  // glfwGetKey is for the main thread only, the simulation reads the snapshot
+  for (const auto& binding : KeyBindings)
+  {
+    setKey(binding.key, glfwGetKey(m_window, binding.glfwKey) == GLFW_PRESS);
+  }
+}
+
+void GlfwPlatform::setSwapInterval(int interval)
+{
+  glfwSwapInterval(interval);
+}
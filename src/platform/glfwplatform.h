@@ -0,0 +1,35 @@
+#pragma once
+
+#include <memory>
+
+#include "platform.h"
+
+struct GLFWwindow;
+
+// A GLFW window and its context. Hidden, it is the headless platform where a context needs a window anyway.
+class GlfwPlatform : public Platform
+{
+public:
+  // nullptr if GLFW or the window couldn't be made
+  static std::unique_ptr<GlfwPlatform> createUnique(int width, int height, const char* title, int refreshRate, bool visible);
+
+  GlfwPlatform();
+
+  ~GlfwPlatform() override;
+
+  const char* name() const override
+  {
+    return "GLFW";
+  }
+
+  bool shouldClose() const override;
+
+  void swapBuffers() override;
+
+  void pollEvents() override;
+
+  void setSwapInterval(int interval) override;
+
+protected:
+  GLFWwindow* m_window;
+};
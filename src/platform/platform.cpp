@@ -0,0 +1,41 @@
+#include "platform.h"
+
+#include <chrono>
+
+#include "glfwplatform.h"
+#ifndef _WIN32
+#include "eglplatform.h"
+#endif
+
+std::unique_ptr<Platform> Platform::createWindowed(int width, int height, const char* title, int refreshRate)
+{
+  return GlfwPlatform::createUnique(width, height, title, refreshRate, true);
+}
+
+std::unique_ptr<Platform> Platform::createHeadless(int width, int height)
+{
+#ifdef _WIN32
+  // wgl needs a window for a context, it just isn't shown
+  return GlfwPlatform::createUnique(width, height, "Deferred Rendering", 0, false);
+#else
+  return EglPlatform::createUnique(width, height);
+#endif
+}
+
+double Platform::seconds()
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint64_t Platform::wallClockMilliseconds()
+{
+  return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+Platform::Platform()
+{
+  for (auto& key : m_keys)
+  {
+    key.store(false, std::memory_order_relaxed);
+  }
+}
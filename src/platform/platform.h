@@ -0,0 +1,75 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// What the app needs from the OS: a GL context, current on the calling thread from creation on, the keys that
+// move the eye and the time. One implementation per way of getting a context: a GLFW window, or EGL without any
+// window system on Linux, for rendering and benchmarking on machines without a display (Mesa's llvmpipe does
+// when there's no GPU either). The entry points of the context are found through GLDispatch.
+class Platform
+{
+public:
+  enum class Key
+  {
+    Up = 0,
+    Down,
+    Left,
+    Right,
+    Numpad2,
+    Numpad3,
+    Numpad4,
+    Numpad6,
+    Numpad8,
+    Numpad9,
+    Num,
+  };
+
+  // a window of width x height, refreshRate as a hint for full screen
+  static std::unique_ptr<Platform> createWindowed(int width, int height, const char* title, int refreshRate);
+
+  // a default framebuffer of width x height that is never shown: an EGL pbuffer on Linux, a hidden window
+  // elsewhere; nullptr when no context could be made
+  static std::unique_ptr<Platform> createHeadless(int width, int height);
+
+  virtual ~Platform() = default;
+
+  // which implementation, for the logs
+  virtual const char* name() const = 0;
+
+  // the user asked to quit; never for a headless one
+  virtual bool shouldClose() const = 0;
+
+  virtual void swapBuffers() = 0;
+
+  // handles the window system's events and takes a snapshot of the keys
+  virtual void pollEvents() = 0;
+
+  // 0 doesn't wait for vsync
+  virtual void setSwapInterval(int interval) = 0;
+
+  // as of the last pollEvents(); safe from any thread, the simulation reads them
+  bool keyDown(Key key) const
+  {
+    return m_keys[static_cast<size_t>(key)].load(std::memory_order_relaxed);
+  }
+
+  // on a monotonic clock, from an arbitrary start
+  static double seconds();
+
+  // of the wall clock, different every run; for seeding
+  static uint64_t wallClockMilliseconds();
+
+protected:
+  Platform();
+
+  void setKey(Key key, bool down)
+  {
+    m_keys[static_cast<size_t>(key)].store(down, std::memory_order_relaxed);
+  }
+
+  std::array<std::atomic<bool>, static_cast<size_t>(Key::Num)> m_keys;
+};
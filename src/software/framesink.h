@@ -0,0 +1,83 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// A frame read back from the GPU, RGBA with the rows top down
+struct CapturedFrame
+{
+  size_t width = 0;
+  size_t height = 0;
+  std::vector<uint8_t> rgba;
+  std::string path;                 // for sinks saving frames one by one
+  std::vector<uint8_t> converted;   // the sink's, the frame in whatever it needs
+};
+
+// Where FrameCapture hands the frames it reads back. Frames come from the sink and go back to it, so a sink
+// that can't keep up makes acquire() wait instead of frames piling up in memory.
+class FrameSink
+{
+public:
+  virtual ~FrameSink() = default;
+
+  // a frame to fill and submit(), waiting for one when all are in use
+  virtual std::unique_ptr<CapturedFrame> acquire() = 0;
+
+  // a frame left empty, width 0, was lost on the way and only comes back
+  virtual void submit(std::unique_ptr<CapturedFrame> frame) = 0;
+
+  // waits until everything submitted is done with
+  virtual void flush() = 0;
+};
+
+// A fixed number of frames handed out and given back, recycled with their buffers
+class CapturedFramePool
+{
+public:
+  explicit CapturedFramePool(size_t count)
+  {
+    m_outstanding = 0;
+    m_count = count ? count : 1;
+  }
+
+  // stalled is set when every frame was out and it had to wait
+  std::unique_ptr<CapturedFrame> acquire(bool& stalled)
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    stalled = m_outstanding == m_count;
+    m_returned.wait(lock, [this]()
+    {
+      return m_outstanding < m_count;
+    });
+    ++m_outstanding;
+    if (m_free.empty())
+    {
+      return std::make_unique<CapturedFrame>();
+    }
+    auto frame = std::move(m_free.back());
+    m_free.pop_back();
+    return frame;
+  }
+
+  void release(std::unique_ptr<CapturedFrame> frame)
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_free.push_back(std::move(frame));
+      --m_outstanding;
+    }
+    m_returned.notify_one();
+  }
+
+protected:
+  size_t m_count;
+  size_t m_outstanding;
+  std::vector<std::unique_ptr<CapturedFrame>> m_free;
+  std::mutex m_mutex;
+  std::condition_variable m_returned;
+};
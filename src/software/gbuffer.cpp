@@ -0,0 +1,29 @@
+#include "gbuffer.h"
+
+#include <algorithm>
+
+void SoftwareGBuffer::resize(size_t width, size_t height)
+{
+  m_width = width;
+  m_height = height;
+  for (auto& attachment : m_channels)
+  {
+    for (auto& channel : attachment)
+    {
+      channel.resize(pixels());
+    }
+  }
+  m_depth.resize(pixels());
+}
+
+void SoftwareGBuffer::clear(const float color[Channels], float depth)
+{
+  for (auto& attachment : m_channels)
+  {
+    for (size_t c = 0; c < Channels; ++c)
+    {
+      std::fill(attachment[c].begin(), attachment[c].end(), color[c]);
+    }
+  }
+  std::fill(m_depth.begin(), m_depth.end(), depth);
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// The G-buffer of the software renderer, as structure of arrays: every channel of every attachment is a
+// float plane of its own, so that the lighting pass reads runs of the same channel. The attachments are
+// those of DeferredRenderer::Names; rows go bottom up, as in GL.
+class SoftwareGBuffer
+{
+public:
+  enum class Names
+  {
+    Diffuse = 0,
+    Position = 1,
+    Normals = 2,
+    Num,
+  };
+
+  static const size_t Channels = 3;   // rgb / xyz; the diffuse alpha is always 1
+
+  void resize(size_t width, size_t height);
+
+  // every channel of every attachment to the same color, as glClear does with several draw buffers
+  void clear(const float color[Channels], float depth);
+
+  float* channel(Names name, size_t channel)
+  {
+    return m_channels[static_cast<size_t>(name)][channel].data();
+  }
+  const float* channel(Names name, size_t channel) const
+  {
+    return m_channels[static_cast<size_t>(name)][channel].data();
+  }
+
+  // window space depth in [0, 1]
+  float* depth()
+  {
+    return m_depth.data();
+  }
+  const float* depth() const
+  {
+    return m_depth.data();
+  }
+
+  size_t width() const
+  {
+    return m_width;
+  }
+
+  size_t height() const
+  {
+    return m_height;
+  }
+
+  size_t pixels() const
+  {
+    return m_width * m_height;
+  }
+
+protected:
+  size_t m_width = 0;
+  size_t m_height = 0;
+
+  std::vector<float> m_channels[static_cast<size_t>(Names::Num)][Channels];
+  std::vector<float> m_depth;
+};
@@ -0,0 +1,181 @@
+#include "image.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace {
+  // PNG's chunk checksum, the one zlib has
+  uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0)
+  {
+    static const auto table = []()
+    {
+      std::vector<uint32_t> result(256);
+      for (uint32_t n = 0; n < 256; ++n)
+      {
+        auto c = n;
+        for (int k = 0; k < 8; ++k)
+        {
+          c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+        }
+        result[n] = c;
+      }
+      return result;
+    }();
+
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i)
+    {
+      crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+  }
+
+  void appendBigEndian(std::vector<uint8_t>& out, uint32_t value)
+  {
+    out.push_back(static_cast<uint8_t>(value >> 24));
+    out.push_back(static_cast<uint8_t>(value >> 16));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+    out.push_back(static_cast<uint8_t>(value));
+  }
+
+  void writeChunk(FILE* file, const char* type, const std::vector<uint8_t>& data, bool& ok)
+  {
+    std::vector<uint8_t> chunk;
+    chunk.reserve(data.size() + 12);
+    appendBigEndian(chunk, static_cast<uint32_t>(data.size()));
+    chunk.insert(chunk.end(), type, type + 4);
+    chunk.insert(chunk.end(), data.begin(), data.end());
+    appendBigEndian(chunk, crc32(chunk.data() + 4, chunk.size() - 4));
+    ok = ok && fwrite(chunk.data(), 1, chunk.size(), file) == chunk.size();
+  }
+
+  bool endsWith(const std::string& text, const char* suffix)
+  {
+    std::string end(suffix);
+    return text.size() >= end.size() && text.compare(text.size() - end.size(), end.size(), end) == 0;
+  }
+}
+
+bool Image::writePPM(const std::string& path) const
+{
+  auto file = fopen(path.c_str(), "wb");
+  if (!file)
+  {
+    return false;
+  }
+
+  fprintf(file, "P6\n%zu %zu\n255\n", width, height);
+  auto written = fwrite(pixels.data(), 1, pixels.size(), file);
+  fclose(file);
+  return written == pixels.size();
+}
+
+bool Image::writePNG(const std::string& path) const
+{
+  auto file = fopen(path.c_str(), "wb");
+  if (!file)
+  {
+    return false;
+  }
+
+  static const uint8_t Signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+  auto ok = fwrite(Signature, 1, sizeof(Signature), file) == sizeof(Signature);
+
+  std::vector<uint8_t> header;
+  appendBigEndian(header, static_cast<uint32_t>(width));
+  appendBigEndian(header, static_cast<uint32_t>(height));
+  header.insert(header.end(), { 8, 2, 0, 0, 0 });   // 8 bits, RGB, deflate, adaptive filters, not interlaced
+  writeChunk(file, "IHDR", header, ok);
+
+  // the rows, each behind a 0 for no filter, in a zlib stream of stored deflate blocks of at most 64 KB
+  auto rowBytes = width * 3;
+  std::vector<uint8_t> rows;
+  rows.reserve(height * (rowBytes + 1));
+  for (size_t y = 0; y < height; ++y)
+  {
+    rows.push_back(0);
+    rows.insert(rows.end(), pixels.begin() + y * rowBytes, pixels.begin() + (y + 1) * rowBytes);
+  }
+
+  const size_t MaxBlock = 65535;
+  std::vector<uint8_t> data = { 0x78, 0x01 };
+  data.reserve(rows.size() + rows.size() / MaxBlock * 5 + 16);
+  uint32_t a = 1, b = 0;
+  size_t offset = 0;
+  do
+  {
+    auto size = std::min(MaxBlock, rows.size() - offset);
+    auto last = offset + size == rows.size();
+    data.push_back(last ? 1 : 0);
+    data.push_back(static_cast<uint8_t>(size));
+    data.push_back(static_cast<uint8_t>(size >> 8));
+    data.push_back(static_cast<uint8_t>(~size));
+    data.push_back(static_cast<uint8_t>(~size >> 8));
+    data.insert(data.end(), rows.begin() + offset, rows.begin() + offset + size);
+    for (size_t i = offset; i < offset + size; ++i)
+    {
+      a = (a + rows[i]) % 65521;
+      b = (b + a) % 65521;
+    }
+    offset += size;
+  } while (offset < rows.size());
+  appendBigEndian(data, (b << 16) | a);
+  writeChunk(file, "IDAT", data, ok);
+  writeChunk(file, "IEND", {}, ok);
+
+  fclose(file);
+  return ok;
+}
+
+bool Image::write(const std::string& path) const
+{
+  return endsWith(path, ".png") || endsWith(path, ".PNG") ? writePNG(path) : writePPM(path);
+}
+
+bool Image::readPPM(const std::string& path)
+{
+  auto file = fopen(path.c_str(), "rb");
+  if (!file)
+  {
+    return false;
+  }
+
+  size_t w = 0, h = 0;
+  int maxValue = 0;
+  auto valid = fscanf(file, "P6 %zu %zu %d", &w, &h, &maxValue) == 3 && maxValue == 255 && fgetc(file) != EOF;
+  if (valid)
+  {
+    resize(w, h);
+    valid = fread(pixels.data(), 1, pixels.size(), file) == pixels.size();
+  }
+  fclose(file);
+  return valid;
+}
+
+bool Image::compare(const Image& a, const Image& b, int tolerance, int& maxDifference, size_t& differentPixels)
+{
+  maxDifference = 0;
+  differentPixels = 0;
+  if (a.width != b.width || a.height != b.height)
+  {
+    return false;
+  }
+
+  for (size_t i = 0; i < a.pixels.size(); i += 3)
+  {
+    int difference = 0;
+    for (size_t c = 0; c < 3; ++c)
+    {
+      difference = std::max(difference, std::abs(static_cast<int>(a.pixels[i + c]) - static_cast<int>(b.pixels[i + c])));
+    }
+    maxDifference = std::max(maxDifference, difference);
+    if (difference > tolerance)
+    {
+      ++differentPixels;
+    }
+  }
+  return true;
+}
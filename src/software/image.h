@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 8-bit RGB pixels, rows top down
+struct Image
+{
+  size_t width = 0;
+  size_t height = 0;
+  std::vector<uint8_t> pixels;
+
+  void resize(size_t w, size_t h)
+  {
+    width = w;
+    height = h;
+    pixels.resize(w * h * 3);
+  }
+
+  uint8_t* row(size_t y)
+  {
+    return pixels.data() + y * width * 3;
+  }
+
+  // binary PPM (P6); false if the file couldn't be written
+  bool writePPM(const std::string& path) const;
+
+  // 8-bit RGB PNG, stored without compression (there is no zlib in the tree): as big as a PPM, but any viewer
+  // opens it
+  bool writePNG(const std::string& path) const;
+
+  // PNG for a .png path, PPM otherwise
+  bool write(const std::string& path) const;
+
+  // a binary PPM with 8-bit channels, as writePPM() makes them
+  bool readPPM(const std::string& path);
+
+  // largest difference of any channel, and the number of pixels differing by more than tolerance;
+  // for comparing a render against a reference image
+  static bool compare(const Image& a, const Image& b, int tolerance, int& maxDifference, size_t& differentPixels);
+};
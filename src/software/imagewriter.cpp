@@ -0,0 +1,132 @@
+#include "imagewriter.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "../utils/debugout.h"
+#include "../utils/profiler.h"
+
+std::unique_ptr<ImageWriter> ImageWriter::createUnique(size_t maxQueued)
+{
+  auto writer = std::make_unique<ImageWriter>();
+  // the queued ones, the one being written and the one being filled
+  writer->m_pool = std::make_unique<CapturedFramePool>(std::max<size_t>(maxQueued, 1) + 2);
+  writer->m_thread = std::thread(&ImageWriter::writeLoop, writer.get());
+  return writer;
+}
+
+ImageWriter::ImageWriter()
+{
+  m_writing = false;
+  m_quit = false;
+}
+
+ImageWriter::~ImageWriter()
+{
+  if (m_thread.joinable())
+  {
+    flush();
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_quit = true;
+    }
+    m_changed.notify_all();
+    m_thread.join();
+  }
+}
+
+std::unique_ptr<CapturedFrame> ImageWriter::acquire()
+{
+  bool stalled;
+  auto frame = m_pool->acquire(stalled);
+  if (stalled)
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_statistics.stalls;
+  }
+  return frame;
+}
+
+void ImageWriter::submit(std::unique_ptr<CapturedFrame> frame)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_queue.push_back(std::move(frame));
+  }
+  m_changed.notify_all();
+}
+
+void ImageWriter::flush()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_changed.wait(lock, [this]()
+  {
+    return m_queue.empty() && !m_writing;
+  });
+}
+
+ImageWriter::Statistics ImageWriter::statistics()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_statistics;
+}
+
+void ImageWriter::writeLoop()
+{
+  using Clock = std::chrono::high_resolution_clock;
+  PROFILE_THREAD("Image writer");
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  for (;;)
+  {
+    m_changed.wait(lock, [this]()
+    {
+      return m_quit || !m_queue.empty();
+    });
+    if (m_queue.empty())
+    {
+      return;
+    }
+
+    auto frame = std::move(m_queue.front());
+    m_queue.pop_front();
+    m_writing = true;
+    m_changed.notify_all();
+    lock.unlock();
+
+    if (!frame->width)
+    {
+      m_pool->release(std::move(frame));
+      lock.lock();
+      ++m_statistics.failed;
+      m_writing = false;
+      m_changed.notify_all();
+      continue;
+    }
+
+    PROFILE_SCOPE("Write image");
+    auto start = Clock::now();
+    m_image.resize(frame->width, frame->height);
+    auto source = frame->rgba.data();
+    auto target = m_image.pixels.data();
+    for (size_t i = 0, count = frame->width * frame->height; i < count; ++i, source += 4, target += 3)
+    {
+      target[0] = source[0];
+      target[1] = source[1];
+      target[2] = source[2];
+    }
+    auto ok = m_image.write(frame->path);
+    auto milliseconds = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    if (!ok)
+    {
+      debugLog(">>> Failed to write %", frame->path);
+    }
+    m_pool->release(std::move(frame));
+
+    lock.lock();
+    ++(ok ? m_statistics.written : m_statistics.failed);
+    m_statistics.writeMilliseconds += milliseconds;
+    m_writing = false;
+    m_changed.notify_all();
+  }
+}
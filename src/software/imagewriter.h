@@ -0,0 +1,61 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "framesink.h"
+#include "image.h"
+
+// Writes frames to disk as images on a thread of its own, so that whoever makes them, the GL thread reading
+// frames back, doesn't wait on the disk. Frames are handed over and recycled rather than copied; at most
+// maxQueued wait to be written, past that acquire() waits for one to be done, which only happens when the disk
+// can't keep up.
+class ImageWriter : public FrameSink
+{
+public:
+  struct Statistics
+  {
+    size_t written = 0;
+    size_t failed = 0;
+    size_t stalls = 0;            // acquire() calls that had to wait for a frame
+    double writeMilliseconds = 0.0;
+  };
+
+  static std::unique_ptr<ImageWriter> createUnique(size_t maxQueued);
+
+  ImageWriter();
+
+  // writes everything still queued first
+  ~ImageWriter();
+
+  // one written before, when there is one, so its size likely fits
+  std::unique_ptr<CapturedFrame> acquire() override;
+
+  // queues frame to be written to its path, PNG or PPM by the extension (Image::write)
+  void submit(std::unique_ptr<CapturedFrame> frame) override;
+
+  // waits until everything queued is written
+  void flush() override;
+
+  Statistics statistics();
+
+protected:
+  void writeLoop();
+
+  std::unique_ptr<CapturedFramePool> m_pool;
+  std::deque<std::unique_ptr<CapturedFrame>> m_queue;
+  Image m_image;   // the frame being written, without its alpha
+  bool m_writing;
+  bool m_quit;
+  Statistics m_statistics;
+
+  std::thread m_thread;
+  std::mutex m_mutex;
+  std::condition_variable m_changed;
+};
@@ -0,0 +1,178 @@
+#include "lightingkernel_simd.h"
+
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+  struct Sse2
+  {
+    using V = __m128;
+    static const size_t Width = 4;
+
+    static V set1(float value) { return _mm_set1_ps(value); }
+    static V load(const float* p) { return _mm_loadu_ps(p); }
+    static V add(V a, V b) { return _mm_add_ps(a, b); }
+    static V sub(V a, V b) { return _mm_sub_ps(a, b); }
+    static V mul(V a, V b) { return _mm_mul_ps(a, b); }
+    static V div(V a, V b) { return _mm_div_ps(a, b); }
+    static V sqrt(V a) { return _mm_sqrt_ps(a); }
+    static V min(V a, V b) { return _mm_min_ps(a, b); }
+    static V max(V a, V b) { return _mm_max_ps(a, b); }
+    static V greater(V a, V b) { return _mm_cmpgt_ps(a, b); }
+    static V select(V mask, V a, V b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+    // round half up, as std::round does for the non-negative values it gets
+    static void storeRounded(int32_t* p, V a)
+    {
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm_cvttps_epi32(_mm_add_ps(a, _mm_set1_ps(0.5f))));
+    }
+  };
+
+  float dot(const float a[3], const float b[3])
+  {
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+  }
+
+  void normalize(float v[3])
+  {
+    auto length = std::sqrt(dot(v, v));
+    if (length > 0.0f)
+    {
+      v[0] /= length;
+      v[1] /= length;
+      v[2] /= length;
+    }
+  }
+
+  // AVX2 needs the instructions and the OS saving the ymm registers
+  bool cpuHasAvx2()
+  {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+    {
+      return false;
+    }
+    __cpuid(info, 1);
+    const int OsXSave = 1 << 27;
+    const int Avx = 1 << 28;
+    if ((info[2] & (OsXSave | Avx)) != (OsXSave | Avx) || (_xgetbv(0) & 0x6) != 0x6)
+    {
+      return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+  }
+}
+
+LightingKernel::Isa LightingKernel::best()
+{
+  static const Isa isa = cpuHasAvx2() ? Isa::Avx2 : Isa::Sse2;
+  return isa;
+}
+
+const char* LightingKernel::name(Isa isa)
+{
+  switch (isa)
+  {
+  case Isa::Avx2:
+    return "AVX2";
+  case Isa::Sse2:
+    return "SSE2";
+  default:
+    return "scalar";
+  }
+}
+
+void LightingKernel::shade(Isa isa, const Inputs& inputs, size_t index, size_t count, uint8_t* rgb)
+{
+  switch (isa)
+  {
+  case Isa::Avx2:
+    shadeAvx2(inputs, index, count, rgb);
+    break;
+  case Isa::Sse2:
+    shadeSse2(inputs, index, count, rgb);
+    break;
+  default:
+    shadeScalar(inputs, index, count, rgb);
+    break;
+  }
+}
+
+void LightingKernel::shadeScalar(const Inputs& inputs, size_t index, size_t count, uint8_t* rgb)
+{
+  for (size_t x = 0; x < count; ++x)
+  {
+    auto pixel = index + x;
+    float albedo[3] = { inputs.diffuse[0][pixel], inputs.diffuse[1][pixel], inputs.diffuse[2][pixel] };
+    float position[3] = { inputs.position[0][pixel], inputs.position[1][pixel], inputs.position[2][pixel] };
+    float n[3] = { inputs.normal[0][pixel], inputs.normal[1][pixel], inputs.normal[2][pixel] };
+    // where nothing was drawn: GLSL's normalize() of the cleared normal is NaN, which lands as black
+    if (dot(n, n) == 0.0f)
+    {
+      rgb[x * 3 + 0] = rgb[x * 3 + 1] = rgb[x * 3 + 2] = 0;
+      continue;
+    }
+    normalize(n);
+
+    // computeLightColor() for every light
+    float color[3] = { 0.0f, 0.0f, 0.0f };
+    for (size_t i = 0; i < NumLights; ++i)
+    {
+      const auto& light = inputs.lightPositions[i];
+      float v[3] = { light[0] - position[0], light[1] - position[1], light[2] - position[2] };
+      normalize(v);
+
+      // reflect(i, n) = i - 2 * dot(n, i) * n
+      const auto& reflected = inputs.reflected[i];
+      auto incidence = dot(n, reflected);
+      float r[3];
+      for (int j = 0; j < 3; ++j)
+      {
+        r[j] = reflected[j] - 2.0f * incidence * n[j];
+      }
+
+      auto diffuseFactor = std::max(dot(n, inputs.lightDirections[i]), 0.0f);
+      // pow(s, 10) as ((s^2)^2 * s)^2, like the SIMD kernels
+      auto s = std::max(dot(r, v), 0.0f);
+      auto s2 = s * s;
+      auto s5 = s2 * s2 * s;
+      auto specular = s5 * s5;
+      for (int j = 0; j < 3; ++j)
+      {
+        auto ambient = inputs.lightColors[i][j] * 0.1f;
+        color[j] += ambient * albedo[j] * diffuseFactor + specular * inputs.lightColors[i][j];
+      }
+    }
+
+    // the light projector's cone is washed towards white
+    float pv[3] = { position[0] - inputs.projectorPosition[0], position[1] - inputs.projectorPosition[1], position[2] - inputs.projectorPosition[2] };
+    normalize(pv);
+    if (dot(pv, inputs.projectorDirection) > inputs.projectorCosine)
+    {
+      for (auto& c : color)
+      {
+        c = c * 0.7f + 0.3f;
+      }
+    }
+
+    for (int j = 0; j < 3; ++j)
+    {
+      rgb[x * 3 + j] = static_cast<uint8_t>(std::round(std::min(std::max(color[j], 0.0f), 1.0f) * 255.0f));
+    }
+  }
+}
+
+void LightingKernel::shadeSse2(const Inputs& inputs, size_t index, size_t count, uint8_t* rgb)
+{
+  shadeLighting<Sse2>(inputs, index, count, rgb);
+}
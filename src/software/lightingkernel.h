@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// The lighting pass of the software renderer: computeLightColor() of deferredPass1.frag for every light, and
+// the light projector's wash, over runs of pixels of the SoA G-buffer. The scalar version is the reference;
+// the SIMD ones do the same arithmetic on 4 (SSE2) or 8 (AVX2) pixels at a time. best() picks the widest one
+// the CPU runs.
+class LightingKernel
+{
+public:
+  static const size_t NumLights = 3;    // has to match numLights in deferredPass1.frag
+
+  enum class Isa
+  {
+    Scalar,
+    Sse2,
+    Avx2,
+  };
+
+  // everything per frame, light directions already normalized
+  struct Inputs
+  {
+    const float* diffuse[3];    // G-buffer planes
+    const float* position[3];
+    const float* normal[3];
+
+    float lightPositions[NumLights][3];
+    float lightColors[NumLights][3];
+    float lightDirections[NumLights][3];  // l: the light's position taken as a direction
+    float reflected[NumLights][3];        // normalize(light - camera), reflected per pixel
+
+    float projectorPosition[3];
+    float projectorDirection[3];
+    float projectorCosine;
+  };
+
+  static Isa best();
+
+  static const char* name(Isa isa);
+
+  // pixels [index, index + count) of the G-buffer into count 8-bit rgb triplets
+  static void shade(Isa isa, const Inputs& inputs, size_t index, size_t count, uint8_t* rgb);
+
+  static void shadeScalar(const Inputs& inputs, size_t index, size_t count, uint8_t* rgb);
+  static void shadeSse2(const Inputs& inputs, size_t index, size_t count, uint8_t* rgb);
+  // lightingkernel_avx2.cpp, the only file built with AVX2 code generation
+  static void shadeAvx2(const Inputs& inputs, size_t index, size_t count, uint8_t* rgb);
+};
@@ -0,0 +1,33 @@
+#include "lightingkernel_simd.h"
+
+#include <immintrin.h>
+
+namespace {
+  struct Avx2
+  {
+    using V = __m256;
+    static const size_t Width = 8;
+
+    static V set1(float value) { return _mm256_set1_ps(value); }
+    static V load(const float* p) { return _mm256_loadu_ps(p); }
+    static V add(V a, V b) { return _mm256_add_ps(a, b); }
+    static V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+    static V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+    static V div(V a, V b) { return _mm256_div_ps(a, b); }
+    static V sqrt(V a) { return _mm256_sqrt_ps(a); }
+    static V min(V a, V b) { return _mm256_min_ps(a, b); }
+    static V max(V a, V b) { return _mm256_max_ps(a, b); }
+    static V greater(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+    static V select(V mask, V a, V b) { return _mm256_blendv_ps(b, a, mask); }
+    // round half up, as std::round does for the non-negative values it gets
+    static void storeRounded(int32_t* p, V a)
+    {
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), _mm256_cvttps_epi32(_mm256_add_ps(a, _mm256_set1_ps(0.5f))));
+    }
+  };
+}
+
+void LightingKernel::shadeAvx2(const Inputs& inputs, size_t index, size_t count, uint8_t* rgb)
+{
+  shadeLighting<Avx2>(inputs, index, count, rgb);
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "lightingkernel.h"
+
+// LightingKernel's arithmetic written once over a vector type. Simd provides Width, a vector type V and
+// the operations below; it is instantiated with SSE2 in lightingkernel.cpp and with AVX2 in
+// lightingkernel_avx2.cpp. Pixels past the last full vector go through the scalar kernel.
+template<typename Simd>
+void shadeLighting(const LightingKernel::Inputs& inputs, size_t index, size_t count, uint8_t* rgb)
+{
+  using V = typename Simd::V;
+  const size_t NumLights = LightingKernel::NumLights;
+
+  auto zero = Simd::set1(0.0f);
+  auto one = Simd::set1(1.0f);
+  auto two = Simd::set1(2.0f);
+  auto ambientFactor = Simd::set1(0.1f);
+  auto washFactor = Simd::set1(0.7f);
+  auto washOffset = Simd::set1(0.3f);
+  auto projectorCosine = Simd::set1(inputs.projectorCosine);
+
+  // v / |v|, left as it is when the length is 0
+  auto normalize = [zero, one](V& x, V& y, V& z)
+  {
+    auto length = Simd::sqrt(Simd::add(Simd::add(Simd::mul(x, x), Simd::mul(y, y)), Simd::mul(z, z)));
+    auto scale = Simd::div(one, Simd::select(Simd::greater(length, zero), length, one));
+    x = Simd::mul(x, scale);
+    y = Simd::mul(y, scale);
+    z = Simd::mul(z, scale);
+  };
+  auto dot = [](V ax, V ay, V az, V bx, V by, V bz)
+  {
+    return Simd::add(Simd::add(Simd::mul(ax, bx), Simd::mul(ay, by)), Simd::mul(az, bz));
+  };
+
+  size_t done = 0;
+  for (; done + Simd::Width <= count; done += Simd::Width)
+  {
+    auto pixel = index + done;
+    V albedo[3], position[3], n[3];
+    for (int j = 0; j < 3; ++j)
+    {
+      albedo[j] = Simd::load(inputs.diffuse[j] + pixel);
+      position[j] = Simd::load(inputs.position[j] + pixel);
+      n[j] = Simd::load(inputs.normal[j] + pixel);
+    }
+    // black where nothing was drawn, as in shadeScalar()
+    auto drawn = Simd::greater(dot(n[0], n[1], n[2], n[0], n[1], n[2]), zero);
+    normalize(n[0], n[1], n[2]);
+
+    V color[3] = { zero, zero, zero };
+    for (size_t i = 0; i < NumLights; ++i)
+    {
+      const auto& light = inputs.lightPositions[i];
+      auto vx = Simd::sub(Simd::set1(light[0]), position[0]);
+      auto vy = Simd::sub(Simd::set1(light[1]), position[1]);
+      auto vz = Simd::sub(Simd::set1(light[2]), position[2]);
+      normalize(vx, vy, vz);
+
+      // reflect(i, n) = i - 2 * dot(n, i) * n
+      const auto& reflected = inputs.reflected[i];
+      V incident[3] = { Simd::set1(reflected[0]), Simd::set1(reflected[1]), Simd::set1(reflected[2]) };
+      auto twiceIncidence = Simd::mul(two, dot(n[0], n[1], n[2], incident[0], incident[1], incident[2]));
+      auto rx = Simd::sub(incident[0], Simd::mul(twiceIncidence, n[0]));
+      auto ry = Simd::sub(incident[1], Simd::mul(twiceIncidence, n[1]));
+      auto rz = Simd::sub(incident[2], Simd::mul(twiceIncidence, n[2]));
+
+      const auto& direction = inputs.lightDirections[i];
+      auto diffuseFactor = Simd::max(dot(n[0], n[1], n[2], Simd::set1(direction[0]), Simd::set1(direction[1]), Simd::set1(direction[2])), zero);
+
+      // pow(s, 10) as ((s^2)^2 * s)^2
+      auto s = Simd::max(dot(rx, ry, rz, vx, vy, vz), zero);
+      auto s2 = Simd::mul(s, s);
+      auto s5 = Simd::mul(Simd::mul(s2, s2), s);
+      auto specular = Simd::mul(s5, s5);
+
+      for (int j = 0; j < 3; ++j)
+      {
+        auto lightColor = Simd::set1(inputs.lightColors[i][j]);
+        auto ambient = Simd::mul(lightColor, ambientFactor);
+        color[j] = Simd::add(color[j], Simd::add(Simd::mul(Simd::mul(ambient, albedo[j]), diffuseFactor), Simd::mul(specular, lightColor)));
+      }
+    }
+
+    // the light projector's cone is washed towards white
+    auto px = Simd::sub(position[0], Simd::set1(inputs.projectorPosition[0]));
+    auto py = Simd::sub(position[1], Simd::set1(inputs.projectorPosition[1]));
+    auto pz = Simd::sub(position[2], Simd::set1(inputs.projectorPosition[2]));
+    normalize(px, py, pz);
+    const auto& projector = inputs.projectorDirection;
+    auto inCone = Simd::greater(dot(px, py, pz, Simd::set1(projector[0]), Simd::set1(projector[1]), Simd::set1(projector[2])), projectorCosine);
+
+    int32_t channels[3][Simd::Width];
+    for (int j = 0; j < 3; ++j)
+    {
+      auto washed = Simd::add(Simd::mul(color[j], washFactor), washOffset);
+      auto clamped = Simd::select(drawn, Simd::min(Simd::max(Simd::select(inCone, washed, color[j]), zero), one), zero);
+      Simd::storeRounded(channels[j], Simd::mul(clamped, Simd::set1(255.0f)));
+    }
+    auto out = rgb + done * 3;
+    for (size_t lane = 0; lane < Simd::Width; ++lane)
+    {
+      out[lane * 3 + 0] = static_cast<uint8_t>(channels[0][lane]);
+      out[lane * 3 + 1] = static_cast<uint8_t>(channels[1][lane]);
+      out[lane * 3 + 2] = static_cast<uint8_t>(channels[2][lane]);
+    }
+  }
+
+  if (done < count)
+  {
+    LightingKernel::shadeScalar(inputs, index + done, count - done, rgb + done * 3);
+  }
+}
@@ -0,0 +1,350 @@
+#include "softwarerenderer.h"
+#include "../utils/jobsystem.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace {
+  // the cone of both projectors: cos(10 degrees), as the shaders compute it
+  const float ProjectorCosine = std::abs(std::cos(10.0f * 0.0174533f));
+
+  // rows of the lighting pass per job
+  const size_t RowsPerJob = 16;
+
+  // what lands in the 8-bit diffuse attachment
+  float quantize(float value)
+  {
+    return std::round(std::min(std::max(value, 0.0f), 1.0f) * 255.0f) / 255.0f;
+  }
+
+  float dot(const float a[3], const float b[3])
+  {
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+  }
+
+  void normalize(float v[3])
+  {
+    auto length = std::sqrt(dot(v, v));
+    if (length > 0.0f)
+    {
+      v[0] /= length;
+      v[1] /= length;
+      v[2] /= length;
+    }
+  }
+
+  void toArray(const vector3<float>& v, float out[3])
+  {
+    out[0] = v.x;
+    out[1] = v.y;
+    out[2] = v.z;
+  }
+}
+
+std::unique_ptr<SoftwareRenderer> SoftwareRenderer::createUnique(size_t width, size_t height)
+{
+  auto renderer = std::make_unique<SoftwareRenderer>();
+  renderer->m_gBuffer.resize(width, height);
+  renderer->m_image.resize(width, height);
+
+  auto lighting = SceneLighting::standard();
+  renderer->m_lightProjector = lighting.lightProjector;
+  renderer->m_surfaceProjector = lighting.surfaceProjector;
+  renderer->m_lights = lighting.lights;
+  renderer->m_clearColor = { 0, 0, 0 };
+  renderer->m_lightingIsa = LightingKernel::best();
+
+  return renderer;
+}
+
+void SoftwareRenderer::drawObjects(const std::vector<SceneObject*>& objects, const Camera& camera)
+{
+  using Clock = std::chrono::high_resolution_clock;
+  auto start = Clock::now();
+
+  float clearColor[SoftwareGBuffer::Channels];
+  toArray(m_clearColor, clearColor);
+  m_gBuffer.clear(clearColor, 1.0f);
+  m_rasterizer.begin(m_gBuffer);
+
+  auto viewProjection = camera.viewMatrix() * camera.projectionMatrix();
+
+  // deferredPass0's projector
+  TileRasterizer::Uniforms uniforms;
+  toArray(m_surfaceProjector.position, uniforms.surfacePosition);
+  toArray(m_surfaceProjector.direction, uniforms.surfaceDirection);
+  normalize(uniforms.surfaceDirection);
+  uniforms.projectorCosine = ProjectorCosine;
+
+  m_statistics.hiZDeferred = 0;
+  m_statistics.hiZRecovered = 0;
+  m_statistics.hiZMilliseconds = 0.0;
+  auto hiZTime = [this](Clock::time_point since)
+  {
+    m_statistics.hiZMilliseconds += std::chrono::duration<double, std::milli>(Clock::now() - since).count();
+  };
+
+  std::vector<Vertex> vertices;
+  if (!m_occlusionCulling || !m_hiZ.levels())
+  {
+    for (auto object : objects)
+    {
+      drawObject(*object, viewProjection, vertices);
+    }
+    m_rasterizer.flush(uniforms, m_jobSystem);
+  }
+  else
+  {
+    // first phase: whatever last frame's depth, seen from last frame's camera, doesn't hide
+    auto phaseStart = Clock::now();
+    m_deferred.clear();
+    std::vector<SceneObject*> phase1;
+    phase1.reserve(objects.size());
+    for (auto object : objects)
+    {
+      auto mesh = object->meshData();
+      vector3<float> minimum, maximum;
+      if (mesh)
+      {
+        mesh->bounds(minimum, maximum);
+      }
+      if (mesh && !m_hiZ.visible(minimum, maximum, object->transformMatrix()))
+      {
+        m_deferred.push_back(object);
+        continue;
+      }
+      phase1.push_back(object);
+    }
+    hiZTime(phaseStart);
+
+    for (auto object : phase1)
+    {
+      drawObject(*object, viewProjection, vertices);
+    }
+    m_rasterizer.flush(uniforms, m_jobSystem);
+
+    // second phase: the rest against this frame's depth so far, which catches what came into view
+    phaseStart = Clock::now();
+    m_hiZ.build(m_gBuffer.depth(), m_gBuffer.width(), m_gBuffer.height(), m_gBuffer.width());
+    m_hiZ.viewProjection() = viewProjection;
+    std::vector<SceneObject*> phase2;
+    for (auto object : m_deferred)
+    {
+      vector3<float> minimum, maximum;
+      object->meshData()->bounds(minimum, maximum);
+      if (m_hiZ.visible(minimum, maximum, object->transformMatrix()))
+      {
+        phase2.push_back(object);
+      }
+    }
+    m_statistics.hiZDeferred = m_deferred.size();
+    m_statistics.hiZRecovered = phase2.size();
+    hiZTime(phaseStart);
+
+    for (auto object : phase2)
+    {
+      drawObject(*object, viewProjection, vertices);
+    }
+    m_rasterizer.flush(uniforms, m_jobSystem);
+  }
+
+  // for the first phase of the next frame
+  if (m_occlusionCulling)
+  {
+    auto buildStart = Clock::now();
+    m_hiZ.build(m_gBuffer.depth(), m_gBuffer.width(), m_gBuffer.height(), m_gBuffer.width());
+    m_hiZ.viewProjection() = viewProjection;
+    hiZTime(buildStart);
+  }
+
+  const auto& rasterized = m_rasterizer.statistics();
+  m_statistics.triangles = rasterized.triangles;
+  m_statistics.fragments = rasterized.fragments;
+  m_statistics.blocksSkipped = rasterized.blocksSkipped;
+  m_statistics.rasterMilliseconds = rasterized.milliseconds;
+  m_statistics.gBufferMilliseconds = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+void SoftwareRenderer::drawObject(SceneObject& object, const matrix4<float>& viewProjection, std::vector<Vertex>& vertices)
+{
+  auto mesh = object.meshData();
+  if (!mesh)
+  {
+    return;
+  }
+
+  // the vertex shader: clip = v * (model * view) * projection, world position = v * model
+  auto modelMatrix = object.transformMatrix();
+  auto modelViewProjection = modelMatrix * viewProjection;
+  const float* model = modelMatrix.get_openglmatrix();
+  const float* mvp = modelViewProjection.get_openglmatrix();
+
+  vertices.resize(mesh->vertices.size());
+  for (size_t v = 0; v < vertices.size(); ++v)
+  {
+    const auto& p = mesh->vertices[v];
+    auto& vertex = vertices[v];
+    for (int j = 0; j < 4; ++j)
+    {
+      vertex.clip[j] = p.x * mvp[j] + p.y * mvp[4 + j] + p.z * mvp[8 + j] + mvp[12 + j];
+    }
+    for (int j = 0; j < 3; ++j)
+    {
+      vertex.position[j] = p.x * model[j] + p.y * model[4 + j] + p.z * model[8 + j] + model[12 + j];
+    }
+    toArray(v < mesh->normals.size() ? mesh->normals[v] : vector3<float>(0, 0, 0), vertex.normal);
+  }
+
+  float color[3];
+  toArray(object.color(), color);
+  for (auto& c : color)
+  {
+    c = quantize(c / 255.0f);
+  }
+
+  const auto& indices = mesh->indices;
+  if (mesh->topology == MeshData::Topology::Quads)
+  {
+    for (size_t i = 0; i + 3 < indices.size(); i += 4)
+    {
+      drawTriangle(vertices[indices[i]], vertices[indices[i + 1]], vertices[indices[i + 2]], color);
+      drawTriangle(vertices[indices[i]], vertices[indices[i + 2]], vertices[indices[i + 3]], color);
+    }
+  }
+  else
+  {
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+      drawTriangle(vertices[indices[i]], vertices[indices[i + 1]], vertices[indices[i + 2]], color);
+    }
+  }
+}
+
+void SoftwareRenderer::drawTriangle(const Vertex& a, const Vertex& b, const Vertex& c, const float color[3])
+{
+  // at most one more vertex per plane
+  Vertex polygon[2][5] = { { a, b, c } };
+  size_t count = 3;
+  auto input = polygon[0];
+  auto output = polygon[1];
+
+  // near: z >= -w, far: z <= w
+  for (float side : { 1.0f, -1.0f })
+  {
+    size_t kept = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+      const auto& from = input[i];
+      const auto& to = input[(i + 1) % count];
+      auto fromDistance = from.clip[3] + side * from.clip[2];
+      auto toDistance = to.clip[3] + side * to.clip[2];
+
+      if (fromDistance >= 0.0f)
+      {
+        output[kept++] = from;
+      }
+      if ((fromDistance >= 0.0f) != (toDistance >= 0.0f))
+      {
+        auto t = fromDistance / (fromDistance - toDistance);
+        auto& vertex = output[kept++];
+        for (int j = 0; j < 4; ++j)
+        {
+          vertex.clip[j] = from.clip[j] + (to.clip[j] - from.clip[j]) * t;
+        }
+        for (int j = 0; j < 3; ++j)
+        {
+          vertex.position[j] = from.position[j] + (to.position[j] - from.position[j]) * t;
+          vertex.normal[j] = from.normal[j] + (to.normal[j] - from.normal[j]) * t;
+        }
+      }
+    }
+    count = kept;
+    if (count < 3)
+    {
+      return;
+    }
+    std::swap(input, output);
+  }
+
+  // window coordinates, depth in [0, 1] and 1 / w for perspective correction
+  auto width = static_cast<float>(m_gBuffer.width());
+  auto height = static_cast<float>(m_gBuffer.height());
+  TileRasterizer::Vertex window[5];
+  for (size_t i = 0; i < count; ++i)
+  {
+    const auto& clip = input[i].clip;
+    auto& vertex = window[i];
+    vertex.inverseW = 1.0f / clip[3];
+    vertex.window[0] = (clip[0] * vertex.inverseW * 0.5f + 0.5f) * width;
+    vertex.window[1] = (clip[1] * vertex.inverseW * 0.5f + 0.5f) * height;
+    vertex.window[2] = clip[2] * vertex.inverseW * 0.5f + 0.5f;
+    for (int j = 0; j < 3; ++j)
+    {
+      vertex.position[j] = input[i].position[j];
+      vertex.normal[j] = input[i].normal[j];
+    }
+  }
+
+  for (size_t i = 1; i + 1 < count; ++i)
+  {
+    m_rasterizer.add(window[0], window[i], window[i + 1], color);
+  }
+}
+
+void SoftwareRenderer::render(const Camera& camera)
+{
+  using Clock = std::chrono::high_resolution_clock;
+  auto start = Clock::now();
+
+  float cameraPosition[3];
+  toArray(camera.position(), cameraPosition);
+
+  LightingKernel::Inputs inputs;
+  for (size_t i = 0; i < NumLights; ++i)
+  {
+    toArray(m_lights[i].position, inputs.lightPositions[i]);
+    toArray(m_lights[i].color, inputs.lightColors[i]);
+    toArray(m_lights[i].position, inputs.lightDirections[i]);
+    normalize(inputs.lightDirections[i]);
+    for (int j = 0; j < 3; ++j)
+    {
+      inputs.reflected[i][j] = inputs.lightPositions[i][j] - cameraPosition[j];
+    }
+    normalize(inputs.reflected[i]);
+  }
+
+  toArray(m_lightProjector.position, inputs.projectorPosition);
+  toArray(m_lightProjector.direction, inputs.projectorDirection);
+  normalize(inputs.projectorDirection);
+  inputs.projectorCosine = ProjectorCosine;
+
+  for (size_t channel = 0; channel < SoftwareGBuffer::Channels; ++channel)
+  {
+    inputs.diffuse[channel] = m_gBuffer.channel(Names::Diffuse, channel);
+    inputs.position[channel] = m_gBuffer.channel(Names::Position, channel);
+    inputs.normal[channel] = m_gBuffer.channel(Names::Normals, channel);
+  }
+
+  // bands of rows, one job each
+  auto width = m_gBuffer.width();
+  auto height = m_gBuffer.height();
+  auto shadeRows = [this, &inputs, width, height](size_t begin, size_t end)
+  {
+    for (auto y = begin; y < end; ++y)
+    {
+      // the G-buffer is bottom up, the image top down
+      LightingKernel::shade(m_lightingIsa, inputs, y * width, width, m_image.row(height - 1 - y));
+    }
+  };
+  if (m_jobSystem)
+  {
+    m_jobSystem->parallelFor(height, RowsPerJob, shadeRows);
+  }
+  else
+  {
+    shadeRows(0, height);
+  }
+
+  m_statistics.lightingMilliseconds = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
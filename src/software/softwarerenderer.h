@@ -0,0 +1,127 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <vector>
+
+#include "gbuffer.h"
+#include "image.h"
+#include "lightingkernel.h"
+#include "tilerasterizer.h"
+#include "../opengl/camera.h"
+#include "../opengl/sceneobject.h"
+#include "../opengl/objects/meshdata.h"
+#include "../opengl/hizpyramid.h"
+#include "../opengl/scenelighting.h"
+#include "../utils/defines.h"
+
+// CPU reference of DeferredRenderer: the same two passes, computed the way deferredPass0 and deferredPass1 do,
+// into an in-memory G-buffer and image. Needs no GL context, so scenes render headless for regression images
+// and CPU baselines. Objects are drawn from their meshData(); single-sampled, where the GL G-buffer is
+// multisampled, so edges differ.
+class JobSystem;
+
+class SoftwareRenderer
+{
+public:
+  using Names = SoftwareGBuffer::Names;
+
+  static const size_t NumLights = LightingKernel::NumLights;
+  static_assert(NumLights == SceneLighting::NumLights, "the kernel shades every light of the scene");
+
+  using Light = SceneLighting::Light;
+  using Lights = SceneLighting::Lights;
+  using Projector = SceneLighting::Projector;
+
+  struct Statistics
+  {
+    size_t triangles = 0;   // after clipping
+    size_t fragments = 0;   // passing the depth test
+    size_t blocksSkipped = 0;   // 8 x 8 blocks the hierarchical Z test threw away
+    double gBufferMilliseconds = 0.0;
+    double rasterMilliseconds = 0.0;    // of those, binning and rasterizing the tiles
+    double lightingMilliseconds = 0.0;
+
+    // two-phase occlusion culling
+    size_t hiZDeferred = 0;       // hidden by the last frame's pyramid, left out of the first phase
+    size_t hiZRecovered = 0;      // of those, visible after the first phase and drawn in the second
+    double hiZMilliseconds = 0.0; // pyramids and tests
+  };
+
+  // lights and projectors as DeferredRenderer::createUnique() sets them up, SceneLighting::standard()
+  static std::unique_ptr<SoftwareRenderer> createUnique(size_t width, size_t height);
+
+  SoftwareRenderer()
+  {
+    m_jobSystem = nullptr;
+    m_occlusionCulling = false;
+  }
+
+  // the G-buffer pass (deferredPass0): clears, then rasterizes every object with a mesh. with occlusionCulling()
+  // in two phases, the way DeferredRenderer culls with its Hi-Z pyramid: first what the previous frame's pyramid
+  // doesn't hide, then what this frame's depth so far doesn't hide
+  void drawObjects(const std::vector<SceneObject*>& objects, const Camera& camera);
+
+  // the lighting pass (deferredPass1) from the G-buffer into image()
+  void render(const Camera& camera);
+
+  const SoftwareGBuffer& gBuffer() const
+  {
+    return m_gBuffer;
+  }
+
+  const Image& image() const
+  {
+    return m_image;
+  }
+
+  const Statistics& statistics() const
+  {
+    return m_statistics;
+  }
+
+  DECLARE_PROTECTED_TRIVIAL_ATTRIBUTE(Lights, lights);
+  DECLARE_PROTECTED_TRIVIAL_ATTRIBUTE(Projector, surfaceProjector);  // painted into the G-buffer
+  DECLARE_PROTECTED_TRIVIAL_ATTRIBUTE(Projector, lightProjector);    // highlights the lit image
+  DECLARE_PROTECTED_TRIVIAL_ATTRIBUTE(vector3<float>, clearColor);   // of the G-buffer, 0 - 1; black, as GL's
+  DECLARE_PROTECTED_TRIVIAL_ATTRIBUTE(LightingKernel::Isa, lightingIsa);  // the widest the CPU has by default
+  DECLARE_PROTECTED_TRIVIAL_ATTRIBUTE(bool, occlusionCulling);
+
+public:
+  // depth of the last drawObjects() with occlusionCulling(), and the camera it was seen from
+  const HiZPyramid& hiZ() const
+  {
+    return m_hiZ;
+  }
+
+public:
+  // the G-buffer's tiles are rasterized and the lighting pass's rows shaded on it; not owned, may be null
+  JobSystem*& jobSystem()
+  {
+    return m_jobSystem;
+  }
+
+protected:
+  // what the vertex shader hands on
+  struct Vertex
+  {
+    float clip[4];
+    float position[3];  // world space
+    float normal[3];    // object space, as the shader passes it
+  };
+
+  // vertex processing, then the object's triangles to drawTriangle()
+  void drawObject(SceneObject& object, const matrix4<float>& viewProjection, std::vector<Vertex>& vertices);
+
+  // clips against the near and far planes and hands what is left to the rasterizer as a fan
+  void drawTriangle(const Vertex& a, const Vertex& b, const Vertex& c, const float color[3]);
+
+  SoftwareGBuffer m_gBuffer;
+  TileRasterizer m_rasterizer;
+  HiZPyramid m_hiZ;
+  std::vector<SceneObject*> m_deferred;   // by the first phase
+  Image m_image;
+  Statistics m_statistics;
+
+  JobSystem* m_jobSystem;
+};
@@ -0,0 +1,381 @@
+#include "tilerasterizer.h"
+#include "../utils/jobsystem.h"
+
+#include <emmintrin.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace {
+  // triangles binned by one job
+  const size_t TrianglesPerChunk = 1024;
+
+  // Projector::createTexture()'s 64 x 64 checker, sampled nearest with repeat at s = 0.5, where only the
+  // row decides; returns the texel's red / blue
+  float projectorTexel(float t)
+  {
+    const int size = 64;
+    auto row = static_cast<int>(std::floor(t * size)) % size;
+    row = row < 0 ? row + size : row;
+    // column 32 has bit 3 clear, which flips the row's bit
+    return (row & 0x8) ? 1.0f : 0.0f;
+  }
+
+  // top-left fill rule for a counter-clockwise triangle in a y up window
+  bool ownsEdge(const float a[3], const float b[3])
+  {
+    auto dx = b[0] - a[0];
+    auto dy = b[1] - a[1];
+    return dy < 0.0f || (dy == 0.0f && dx < 0.0f);
+  }
+}
+
+void TileRasterizer::begin(SoftwareGBuffer& gBuffer)
+{
+  m_gBuffer = &gBuffer;
+  m_tilesX = (gBuffer.width() + TileSize - 1) / TileSize;
+  m_tilesY = (gBuffer.height() + TileSize - 1) / TileSize;
+  m_blocksX = (gBuffer.width() + BlockSize - 1) / BlockSize;
+  auto blocksY = (gBuffer.height() + BlockSize - 1) / BlockSize;
+
+  // the G-buffer comes in cleared to the far plane
+  m_blockMaxDepth.assign(m_blocksX * blocksY, 1.0f);
+  m_tileStatistics.assign(m_tilesX * m_tilesY, TileStatistics());
+  m_triangles.clear();
+  m_statistics = Statistics();
+}
+
+void TileRasterizer::add(const Vertex& a, const Vertex& b, const Vertex& c, const float color[3])
+{
+  const Vertex* vertices[3] = { &a, &b, &c };
+  auto area = (b.window[0] - a.window[0]) * (c.window[1] - a.window[1]) - (b.window[1] - a.window[1]) * (c.window[0] - a.window[0]);
+  if (area == 0.0f)
+  {
+    return;
+  }
+  // nothing is culled; clockwise triangles are turned around
+  if (area < 0.0f)
+  {
+    std::swap(vertices[1], vertices[2]);
+    area = -area;
+  }
+
+  Triangle triangle;
+  float minX = vertices[0]->window[0], maxX = minX, minY = vertices[0]->window[1], maxY = minY;
+  for (int k = 0; k < 3; ++k)
+  {
+    // the edge facing vertex k, scaled so that it gives k's barycentric weight
+    const auto& from = vertices[(k + 1) % 3]->window;
+    const auto& to = vertices[(k + 2) % 3]->window;
+    auto edgeA = -(to[1] - from[1]) / area;
+    auto edgeB = (to[0] - from[0]) / area;
+    triangle.edges[k][0] = edgeA;
+    triangle.edges[k][1] = edgeB;
+    triangle.edges[k][2] = -(edgeA * from[0] + edgeB * from[1]);
+    triangle.owned[k] = ownsEdge(from, to);
+
+    const auto& vertex = *vertices[k];
+    triangle.depth[k] = vertex.window[2];
+    triangle.inverseW[k] = vertex.inverseW;
+    for (int j = 0; j < 3; ++j)
+    {
+      triangle.position[k][j] = vertex.position[j] * vertex.inverseW;
+      triangle.normal[k][j] = vertex.normal[j] * vertex.inverseW;
+    }
+
+    minX = std::min(minX, vertex.window[0]);
+    maxX = std::max(maxX, vertex.window[0]);
+    minY = std::min(minY, vertex.window[1]);
+    maxY = std::max(maxY, vertex.window[1]);
+  }
+  triangle.minDepth = std::min({ triangle.depth[0], triangle.depth[1], triangle.depth[2] });
+  for (int j = 0; j < 3; ++j)
+  {
+    triangle.color[j] = color[j];
+  }
+
+  // pixel centers inside the bounds
+  auto width = static_cast<int>(m_gBuffer->width());
+  auto height = static_cast<int>(m_gBuffer->height());
+  triangle.bounds[0] = std::max(0, static_cast<int>(std::floor(minX - 0.5f)));
+  triangle.bounds[1] = std::max(0, static_cast<int>(std::floor(minY - 0.5f)));
+  triangle.bounds[2] = std::min(width - 1, static_cast<int>(std::ceil(maxX - 0.5f)));
+  triangle.bounds[3] = std::min(height - 1, static_cast<int>(std::ceil(maxY - 0.5f)));
+  if (triangle.bounds[0] > triangle.bounds[2] || triangle.bounds[1] > triangle.bounds[3])
+  {
+    return;
+  }
+
+  m_triangles.push_back(triangle);
+}
+
+void TileRasterizer::flush(const Uniforms& uniforms, JobSystem* jobSystem)
+{
+  using Clock = std::chrono::high_resolution_clock;
+  auto start = Clock::now();
+
+  auto numChunks = (m_triangles.size() + TrianglesPerChunk - 1) / TrianglesPerChunk;
+  if (m_bins.size() < numChunks)
+  {
+    m_bins.resize(numChunks);
+  }
+
+  auto parallelFor = [jobSystem](size_t count, const auto& function)
+  {
+    if (jobSystem)
+    {
+      jobSystem->parallelFor(count, 1, [&function](size_t begin, size_t end)
+      {
+        for (auto i = begin; i < end; ++i)
+        {
+          function(i);
+        }
+      });
+      return;
+    }
+    for (size_t i = 0; i < count; ++i)
+    {
+      function(i);
+    }
+  };
+
+  parallelFor(numChunks, [this](size_t chunk)
+  {
+    bin(chunk);
+  });
+  parallelFor(m_tilesX * m_tilesY, [this, &uniforms](size_t tile)
+  {
+    rasterizeTile(tile, uniforms);
+  });
+
+  m_statistics.triangles += m_triangles.size();
+  for (auto& tile : m_tileStatistics)
+  {
+    m_statistics.fragments += tile.fragments;
+    m_statistics.blocksSkipped += tile.blocksSkipped;
+    tile = TileStatistics();
+  }
+  m_triangles.clear();
+
+  m_statistics.milliseconds += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+void TileRasterizer::bin(size_t chunk)
+{
+  auto& bins = m_bins[chunk];
+  bins.resize(m_tilesX * m_tilesY);
+  for (auto& tile : bins)
+  {
+    tile.clear();
+  }
+
+  auto begin = chunk * TrianglesPerChunk;
+  auto end = std::min(m_triangles.size(), begin + TrianglesPerChunk);
+  for (auto t = begin; t < end; ++t)
+  {
+    const auto& bounds = m_triangles[t].bounds;
+    for (auto ty = bounds[1] / TileSize; ty <= bounds[3] / TileSize; ++ty)
+    {
+      for (auto tx = bounds[0] / TileSize; tx <= bounds[2] / TileSize; ++tx)
+      {
+        bins[ty * m_tilesX + tx].push_back(static_cast<uint32_t>(t));
+      }
+    }
+  }
+}
+
+void TileRasterizer::rasterizeTile(size_t tile, const Uniforms& uniforms)
+{
+  auto tileX0 = static_cast<int>((tile % m_tilesX) * TileSize);
+  auto tileY0 = static_cast<int>((tile / m_tilesX) * TileSize);
+  auto tileX1 = std::min(tileX0 + static_cast<int>(TileSize), static_cast<int>(m_gBuffer->width())) - 1;
+  auto tileY1 = std::min(tileY0 + static_cast<int>(TileSize), static_cast<int>(m_gBuffer->height())) - 1;
+  auto blockSize = static_cast<int>(BlockSize);
+  auto& statistics = m_tileStatistics[tile];
+
+  auto numChunks = (m_triangles.size() + TrianglesPerChunk - 1) / TrianglesPerChunk;
+  for (size_t chunk = 0; chunk < numChunks; ++chunk)
+  {
+    for (auto t : m_bins[chunk][tile])
+    {
+      const auto& triangle = m_triangles[t];
+      auto x0 = std::max(tileX0, triangle.bounds[0]);
+      auto y0 = std::max(tileY0, triangle.bounds[1]);
+      auto x1 = std::min(tileX1, triangle.bounds[2]);
+      auto y1 = std::min(tileY1, triangle.bounds[3]);
+
+      for (auto blockY = y0 / blockSize * blockSize; blockY <= y1; blockY += blockSize)
+      {
+        for (auto blockX = x0 / blockSize * blockSize; blockX <= x1; blockX += blockSize)
+        {
+          auto block = static_cast<size_t>(blockY / blockSize) * m_blocksX + static_cast<size_t>(blockX / blockSize);
+          // hierarchical Z: the triangle's nearest point is behind everything in the block
+          if (triangle.minDepth >= m_blockMaxDepth[block])
+          {
+            ++statistics.blocksSkipped;
+            continue;
+          }
+
+          auto bx0 = std::max(x0, blockX);
+          auto by0 = std::max(y0, blockY);
+          auto bx1 = std::min(x1, blockX + blockSize - 1);
+          auto by1 = std::min(y1, blockY + blockSize - 1);
+          auto written = rasterizeBlock(triangle, bx0, by0, bx1, by1, uniforms);
+          if (!written)
+          {
+            continue;
+          }
+          statistics.fragments += written;
+
+          // the block's farthest depth can only have come closer
+          auto width = static_cast<int>(m_gBuffer->width());
+          auto height = static_cast<int>(m_gBuffer->height());
+          auto depth = m_gBuffer->depth();
+          float maxDepth = 0.0f;
+          for (auto y = blockY; y < std::min(blockY + blockSize, height); ++y)
+          {
+            for (auto x = blockX; x < std::min(blockX + blockSize, width); ++x)
+            {
+              maxDepth = std::max(maxDepth, depth[y * width + x]);
+            }
+          }
+          m_blockMaxDepth[block] = maxDepth;
+        }
+      }
+    }
+  }
+}
+
+size_t TileRasterizer::rasterizeBlock(const Triangle& triangle, int x0, int y0, int x1, int y1, const Uniforms& uniforms)
+{
+  // the whole rectangle outside one edge: the edge's largest value over its corners is negative
+  for (int k = 0; k < 3; ++k)
+  {
+    const auto& edge = triangle.edges[k];
+    auto x = (edge[0] > 0.0f ? x1 : x0) + 0.5f;
+    auto y = (edge[1] > 0.0f ? y1 : y0) + 0.5f;
+    if (edge[0] * x + edge[1] * y + edge[2] < 0.0f)
+    {
+      return 0;
+    }
+  }
+
+  auto width = m_gBuffer->width();
+  auto depthBuffer = m_gBuffer->depth();
+  float* diffuse[3];
+  float* positions[3];
+  float* normals[3];
+  for (size_t channel = 0; channel < SoftwareGBuffer::Channels; ++channel)
+  {
+    diffuse[channel] = m_gBuffer->channel(SoftwareGBuffer::Names::Diffuse, channel);
+    positions[channel] = m_gBuffer->channel(SoftwareGBuffer::Names::Position, channel);
+    normals[channel] = m_gBuffer->channel(SoftwareGBuffer::Names::Normals, channel);
+  }
+
+  __m128 edgeA[3], edgeB[3], edgeC[3], owned[3];
+  for (int k = 0; k < 3; ++k)
+  {
+    edgeA[k] = _mm_set1_ps(triangle.edges[k][0]);
+    edgeB[k] = _mm_set1_ps(triangle.edges[k][1]);
+    edgeC[k] = _mm_set1_ps(triangle.edges[k][2]);
+    owned[k] = _mm_castsi128_ps(_mm_set1_epi32(triangle.owned[k] ? -1 : 0));
+  }
+  auto depth0 = _mm_set1_ps(triangle.depth[0]);
+  auto depth1 = _mm_set1_ps(triangle.depth[1]);
+  auto depth2 = _mm_set1_ps(triangle.depth[2]);
+  auto zero = _mm_setzero_ps();
+  auto laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+  auto laneIndices = _mm_setr_epi32(0, 1, 2, 3);
+
+  size_t written = 0;
+  for (auto y = y0; y <= y1; ++y)
+  {
+    auto py = _mm_set1_ps(y + 0.5f);
+    float* depthRow = depthBuffer + static_cast<size_t>(y) * width;
+    for (auto x = x0; x <= x1; x += 4)
+    {
+      auto px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), laneOffsets);
+
+      // four pixels against the three edges; weights are the barycentrics
+      __m128 weights[3];
+      auto inside = _mm_cmplt_epi32(laneIndices, _mm_set1_epi32(x1 - x + 1));
+      auto insideMask = _mm_castsi128_ps(inside);
+      for (int k = 0; k < 3; ++k)
+      {
+        weights[k] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(edgeA[k], px), _mm_mul_ps(edgeB[k], py)), edgeC[k]);
+        auto positive = _mm_cmpgt_ps(weights[k], zero);
+        auto onEdge = _mm_and_ps(_mm_cmpeq_ps(weights[k], zero), owned[k]);
+        insideMask = _mm_and_ps(insideMask, _mm_or_ps(positive, onEdge));
+      }
+      if (!_mm_movemask_ps(insideMask))
+      {
+        continue;
+      }
+
+      // depth is linear in window space; GL_LESS
+      auto z = _mm_add_ps(_mm_add_ps(_mm_mul_ps(weights[0], depth0), _mm_mul_ps(weights[1], depth1)), _mm_mul_ps(weights[2], depth2));
+      float stored[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+      auto lanes = std::min(4, x1 - x + 1);
+      for (int lane = 0; lane < lanes; ++lane)
+      {
+        stored[lane] = depthRow[x + lane];
+      }
+      auto passMask = _mm_movemask_ps(_mm_and_ps(insideMask, _mm_cmplt_ps(z, _mm_loadu_ps(stored))));
+      if (!passMask)
+      {
+        continue;
+      }
+
+      float laneDepth[4], laneWeights[3][4];
+      _mm_storeu_ps(laneDepth, z);
+      for (int k = 0; k < 3; ++k)
+      {
+        _mm_storeu_ps(laneWeights[k], weights[k]);
+      }
+
+      for (int lane = 0; lane < 4; ++lane)
+      {
+        if (!(passMask & (1 << lane)))
+        {
+          continue;
+        }
+        auto index = static_cast<size_t>(y) * width + static_cast<size_t>(x + lane);
+        depthRow[x + lane] = laneDepth[lane];
+        ++written;
+
+        // perspective correct varyings
+        auto b0 = laneWeights[0][lane], b1 = laneWeights[1][lane], b2 = laneWeights[2][lane];
+        auto q = 1.0f / (b0 * triangle.inverseW[0] + b1 * triangle.inverseW[1] + b2 * triangle.inverseW[2]);
+        float position[3], normal[3];
+        for (int j = 0; j < 3; ++j)
+        {
+          position[j] = (b0 * triangle.position[0][j] + b1 * triangle.position[1][j] + b2 * triangle.position[2][j]) * q;
+          normal[j] = (b0 * triangle.normal[0][j] + b1 * triangle.normal[1][j] + b2 * triangle.normal[2][j]) * q;
+        }
+
+        // deferredPass0.frag
+        float color[3] = { triangle.color[0], triangle.color[1], triangle.color[2] };
+        float pv[3] = { position[0] - uniforms.surfacePosition[0], position[1] - uniforms.surfacePosition[1], position[2] - uniforms.surfacePosition[2] };
+        auto length = std::sqrt(pv[0] * pv[0] + pv[1] * pv[1] + pv[2] * pv[2]);
+        auto cosine = length > 0.0f ? (pv[0] * uniforms.surfaceDirection[0] + pv[1] * uniforms.surfaceDirection[1] + pv[2] * uniforms.surfaceDirection[2]) / length : 0.0f;
+        if (cosine > uniforms.projectorCosine)
+        {
+          auto texel = projectorTexel(100.0f * cosine);
+          color[0] = texel;
+          color[1] = 0.0f;
+          color[2] = texel;
+          normal[0] = normal[1] = normal[2] = texel > 0.0f ? 1.0f : -1.0f;
+        }
+
+        for (int j = 0; j < 3; ++j)
+        {
+          diffuse[j][index] = color[j];
+          positions[j][index] = position[j];
+          normals[j][index] = normal[j];
+        }
+      }
+    }
+  }
+  return written;
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "gbuffer.h"
+
+class JobSystem;
+
+// Binning rasterizer for the software G-buffer pass. Triangles are set up as they come, sorted into screen tiles
+// and the tiles are rasterized in parallel, each by one job, so no two threads ever write the same pixel. Edge
+// functions and the depth test run on four pixels at a time (SSE2); a per block maximum depth (hierarchical Z)
+// throws away whole 8 x 8 blocks a triangle is behind. Within a tile triangles keep their submission order,
+// so the result does not depend on the number of threads.
+class TileRasterizer
+{
+public:
+  static const size_t TileSize = 64;
+  static const size_t BlockSize = 8;
+
+  // after the perspective divide
+  struct Vertex
+  {
+    float window[3];    // x, y in pixels, depth in [0, 1]
+    float inverseW;
+    float position[3];  // world space
+    float normal[3];
+  };
+
+  // what deferredPass0 reads besides the vertices
+  struct Uniforms
+  {
+    float surfacePosition[3];
+    float surfaceDirection[3];  // unit length
+    float projectorCosine;      // of the projector's half angle
+  };
+
+  struct Statistics
+  {
+    size_t triangles = 0;
+    size_t fragments = 0;       // written to the G-buffer
+    size_t blocksSkipped = 0;   // by the hierarchical Z test
+    double milliseconds = 0.0;  // binning and rasterization
+  };
+
+  // starts a frame on a cleared G-buffer
+  void begin(SoftwareGBuffer& gBuffer);
+
+  // sets the triangle up and queues it; either winding, degenerate ones are dropped
+  void add(const Vertex& a, const Vertex& b, const Vertex& c, const float color[3]);
+
+  // bins and rasterizes everything added since begin(), on the job system if there is one
+  void flush(const Uniforms& uniforms, JobSystem* jobSystem);
+
+  const Statistics& statistics() const
+  {
+    return m_statistics;
+  }
+
+protected:
+  struct Triangle
+  {
+    // barycentric weight of vertex k = edges[k][0] * x + edges[k][1] * y + edges[k][2]
+    float edges[3][3];
+    bool owned[3];          // top-left rule: pixels exactly on the edge are inside
+    float depth[3];
+    float minDepth;
+    float inverseW[3];
+    float position[3][3];   // premultiplied by inverseW
+    float normal[3][3];
+    float color[3];
+    int bounds[4];          // pixel rectangle, inclusive: x0, y0, x1, y1
+  };
+
+  struct TileStatistics
+  {
+    size_t fragments = 0;
+    size_t blocksSkipped = 0;
+  };
+
+  void bin(size_t chunk);
+
+  void rasterizeTile(size_t tile, const Uniforms& uniforms);
+
+  // the part of the triangle inside the block; returns the number of fragments written
+  size_t rasterizeBlock(const Triangle& triangle, int x0, int y0, int x1, int y1, const Uniforms& uniforms);
+
+  SoftwareGBuffer* m_gBuffer = nullptr;
+  size_t m_tilesX = 0;
+  size_t m_tilesY = 0;
+  size_t m_blocksX = 0;
+
+  std::vector<Triangle> m_triangles;
+  // [chunk of triangles][tile] -> the chunk's triangles touching the tile, in order
+  std::vector<std::vector<std::vector<uint32_t>>> m_bins;
+  std::vector<float> m_blockMaxDepth;
+  std::vector<TileStatistics> m_tileStatistics;
+
+  Statistics m_statistics;
+};
@@ -0,0 +1,303 @@
+#include "videoencoder.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <sstream>
+#ifndef _WIN32
+#include <pthread.h>
+#include <signal.h>
+#endif
+
+#include "yuvconverter.h"
+#include "../utils/debugout.h"
+#include "../utils/jobsystem.h"
+#include "../utils/profiler.h"
+
+namespace {
+  // chroma rows per job, 32 rows of the frame
+  const size_t ConvertRows = 16;
+
+  bool endsWith(const std::string& text, const std::string& suffix)
+  {
+    return text.size() >= suffix.size() && std::equal(suffix.rbegin(), suffix.rend(), text.rbegin(), [](char a, char b)
+    {
+      return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b));
+    });
+  }
+
+  // path as one word the shell takes literally. sh expands nothing inside single quotes, only a quote has to be
+  // closed, escaped and reopened; cmd.exe has no escape inside double quotes, so paths with '"' or '%' are refused
+  bool shellQuote(const std::string& path, std::string& quoted)
+  {
+    // and a leading '-' would make an option of it
+    auto word = !path.empty() && path[0] == '-' ? "./" + path : path;
+#ifdef _WIN32
+    if (word.find_first_of("\"%") != std::string::npos)
+    {
+      return false;
+    }
+    quoted = "\"" + word + "\"";
+#else
+    quoted = "'";
+    for (auto c : word)
+    {
+      quoted += c == '\'' ? std::string("'\\''") : std::string(1, c);
+    }
+    quoted += "'";
+#endif
+    return true;
+  }
+}
+
+std::string VideoEncoder::ffmpegCommand(size_t width, size_t height, double frameRate, const std::string& path)
+{
+  std::string output;
+  if (!shellQuote(path, output))
+  {
+    return std::string();
+  }
+
+  std::ostringstream command;
+  command << "ffmpeg -hide_banner -loglevel error -y -f rawvideo -pix_fmt yuv420p -s " << width << "x" << height << " -r " << frameRate << " -i - -pix_fmt yuv420p " << output;
+  return command.str();
+}
+
+std::unique_ptr<VideoEncoder> VideoEncoder::createUnique(size_t width, size_t height, double frameRate, const std::string& path, JobSystem* jobSystem, size_t maxFrames)
+{
+  auto encoder = std::make_unique<VideoEncoder>();
+  encoder->m_width = width;
+  encoder->m_height = height;
+  encoder->m_jobSystem = jobSystem;
+  encoder->m_pool = std::make_unique<CapturedFramePool>(maxFrames);
+
+  if (endsWith(path, ".yuv"))
+  {
+    encoder->m_output = std::fopen(path.c_str(), "wb");
+  }
+  else
+  {
+    auto command = ffmpegCommand(width, height, frameRate, path);
+    if (command.empty())
+    {
+      debugLogAt(LogLevel::Error, "Video encoder: % can't be passed to the encoder", path);
+      return std::unique_ptr<VideoEncoder>();
+    }
+    debugLog("Video encoder: %", command);
+#ifdef _WIN32
+    encoder->m_output = _popen(command.c_str(), "wb");
+#else
+    encoder->m_output = popen(command.c_str(), "w");
+#endif
+    encoder->m_pipe = true;
+    if (encoder->m_output)
+    {
+      // frames go out whole from the writer thread; nothing is left buffered for pclose() to write on another one
+      setvbuf(encoder->m_output, nullptr, _IONBF, 0);
+    }
+  }
+  if (!encoder->m_output)
+  {
+    debugLog(">>> Video encoder: failed to open %", path);
+    return std::unique_ptr<VideoEncoder>();
+  }
+
+  encoder->m_convertThread = std::thread(&VideoEncoder::convertLoop, encoder.get());
+  encoder->m_writeThread = std::thread(&VideoEncoder::writeLoop, encoder.get());
+  return encoder;
+}
+
+VideoEncoder::VideoEncoder()
+{
+  m_width = 0;
+  m_height = 0;
+  m_jobSystem = nullptr;
+  m_output = nullptr;
+  m_pipe = false;
+  m_converting = false;
+  m_writing = false;
+  m_failed = false;
+  m_quit = false;
+}
+
+VideoEncoder::~VideoEncoder()
+{
+  close();
+}
+
+std::unique_ptr<CapturedFrame> VideoEncoder::acquire()
+{
+  bool stalled;
+  auto frame = m_pool->acquire(stalled);
+  if (stalled)
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_statistics.stalls;
+  }
+  return frame;
+}
+
+void VideoEncoder::submit(std::unique_ptr<CapturedFrame> frame)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_toConvert.push_back(std::move(frame));
+  }
+  m_changed.notify_all();
+}
+
+void VideoEncoder::flush()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_changed.wait(lock, [this]()
+  {
+    return m_toConvert.empty() && m_toWrite.empty() && !m_converting && !m_writing;
+  });
+}
+
+bool VideoEncoder::close()
+{
+  if (!m_output)
+  {
+    return false;
+  }
+
+  flush();
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_quit = true;
+  }
+  m_changed.notify_all();
+  m_convertThread.join();
+  m_writeThread.join();
+
+  // the encoder finishes the file once its input ends
+  int result;
+#ifdef _WIN32
+  result = m_pipe ? _pclose(m_output) : std::fclose(m_output);
+#else
+  result = m_pipe ? pclose(m_output) : std::fclose(m_output);
+#endif
+  m_output = nullptr;
+  if (result != 0)
+  {
+    debugLog(">>> Video encoder: the encoder failed (%)", result);
+    m_failed = true;
+  }
+  return !m_failed && !m_statistics.dropped;
+}
+
+VideoEncoder::Statistics VideoEncoder::statistics()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_statistics;
+}
+
+void VideoEncoder::convertLoop()
+{
+  using Clock = std::chrono::high_resolution_clock;
+  PROFILE_THREAD("Encoder converter");
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  for (;;)
+  {
+    m_changed.wait(lock, [this]()
+    {
+      return m_quit || !m_toConvert.empty();
+    });
+    if (m_toConvert.empty())
+    {
+      return;
+    }
+
+    auto frame = std::move(m_toConvert.front());
+    m_toConvert.pop_front();
+    if (frame->width != m_width || frame->height != m_height)
+    {
+      ++m_statistics.dropped;
+      m_pool->release(std::move(frame));
+      m_changed.notify_all();
+      continue;
+    }
+    m_converting = true;
+    lock.unlock();
+
+    PROFILE_SCOPE("Convert frame");
+    auto start = Clock::now();
+    frame->converted.resize(YuvConverter::frameSize(m_width, m_height));
+    auto planes = YuvConverter::planes(frame->converted.data(), m_width, m_height);
+    auto rgba = frame->rgba.data();
+    auto convert = [this, rgba, &planes](size_t begin, size_t end)
+    {
+      YuvConverter::convertSse2(rgba, m_width, m_height, begin, end, planes);
+    };
+    auto rows = YuvConverter::chromaHeight(m_height);
+    if (m_jobSystem)
+    {
+      m_jobSystem->parallelFor(rows, ConvertRows, convert);
+    }
+    else
+    {
+      convert(0, rows);
+    }
+    auto milliseconds = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    lock.lock();
+    m_statistics.convertMilliseconds += milliseconds;
+    m_toWrite.push_back(std::move(frame));
+    m_converting = false;
+    m_changed.notify_all();
+  }
+}
+
+void VideoEncoder::writeLoop()
+{
+  using Clock = std::chrono::high_resolution_clock;
+  PROFILE_THREAD("Encoder writer");
+
+#ifndef _WIN32
+  // writing to an encoder that exited early fails with EPIPE here rather than killing the process;
+  // blocked on this thread only, the rest of the process keeps its own handling
+  sigset_t pipeSignal;
+  sigemptyset(&pipeSignal);
+  sigaddset(&pipeSignal, SIGPIPE);
+  pthread_sigmask(SIG_BLOCK, &pipeSignal, nullptr);
+#endif
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  for (;;)
+  {
+    m_changed.wait(lock, [this]()
+    {
+      return (m_quit && !m_converting && m_toConvert.empty()) || !m_toWrite.empty();
+    });
+    if (m_toWrite.empty())
+    {
+      return;
+    }
+
+    auto frame = std::move(m_toWrite.front());
+    m_toWrite.pop_front();
+    auto failed = m_failed;
+    m_writing = true;
+    lock.unlock();
+
+    // once the encoder is gone frames are only counted, so the capture keeps going rather than waiting forever
+    PROFILE_SCOPE("Pipe frame");
+    auto start = Clock::now();
+    auto ok = !failed && std::fwrite(frame->converted.data(), 1, frame->converted.size(), m_output) == frame->converted.size();
+    auto milliseconds = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    if (!ok && !failed)
+    {
+      debugLog(">>> Video encoder: writing to the encoder failed, the rest of the frames are dropped");
+    }
+    m_pool->release(std::move(frame));
+
+    lock.lock();
+    m_failed = !ok;
+    ++(ok ? m_statistics.encoded : m_statistics.dropped);
+    m_statistics.writeMilliseconds += milliseconds;
+    m_writing = false;
+    m_changed.notify_all();
+  }
+}
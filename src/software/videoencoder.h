@@ -0,0 +1,79 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "framesink.h"
+
+class JobSystem;
+
+// Captured frames into a video: each frame is converted to YUV 4:2:0 on the job system's threads and piped, in
+// order, to an encoder process, ffmpeg, on a writer thread of its own. Only maxFrames frames exist, in whatever
+// stage; when the encoder falls behind, acquire() waits, and with it the capture, instead of memory growing.
+class VideoEncoder : public FrameSink
+{
+public:
+  struct Statistics
+  {
+    size_t encoded = 0;               // handed to the encoder
+    size_t dropped = 0;               // lost in the capture, of the wrong size, or after the encoder went away
+    size_t stalls = 0;                // acquire() calls that had to wait for a frame
+    double convertMilliseconds = 0.0;
+    double writeMilliseconds = 0.0;   // blocked on the pipe, the encoder's own time mostly
+  };
+
+  // ffmpeg reading raw yuv420p from its stdin into path, the codec picked by path's extension; path is quoted for
+  // the shell popen() runs it with. empty when it can't be
+  static std::string ffmpegCommand(size_t width, size_t height, double frameRate, const std::string& path);
+
+  // width x height frames to path through ffmpeg, or as raw yuv420p when path ends in .yuv, for when there is no
+  // ffmpeg; jobSystem is not owned, nullptr converts on the encoder's thread; nullptr if the output can't be opened
+  static std::unique_ptr<VideoEncoder> createUnique(size_t width, size_t height, double frameRate, const std::string& path, JobSystem* jobSystem, size_t maxFrames);
+
+  VideoEncoder();
+
+  // close()s
+  ~VideoEncoder();
+
+  std::unique_ptr<CapturedFrame> acquire() override;
+
+  void submit(std::unique_ptr<CapturedFrame> frame) override;
+
+  // waits until everything submitted is in the pipe
+  void flush() override;
+
+  // flushes and waits for the encoder to finish the file; false if anything was lost or the encoder failed
+  bool close();
+
+  Statistics statistics();
+
+protected:
+  void convertLoop();
+  void writeLoop();
+
+  size_t m_width;
+  size_t m_height;
+  JobSystem* m_jobSystem;
+  FILE* m_output;
+  bool m_pipe;   // popen()ed rather than fopen()ed
+
+  std::unique_ptr<CapturedFramePool> m_pool;
+  std::deque<std::unique_ptr<CapturedFrame>> m_toConvert;
+  std::deque<std::unique_ptr<CapturedFrame>> m_toWrite;
+  bool m_converting;
+  bool m_writing;
+  bool m_failed;
+  bool m_quit;
+  Statistics m_statistics;
+
+  std::thread m_convertThread;
+  std::thread m_writeThread;
+  std::mutex m_mutex;
+  std::condition_variable m_changed;
+};
@@ -0,0 +1,153 @@
+#include "yuvconverter.h"
+
+#include <emmintrin.h>
+
+#include <cstring>
+
+namespace {
+  uint8_t luma(const uint8_t* p)
+  {
+    return static_cast<uint8_t>(((66 * p[0] + 129 * p[1] + 25 * p[2] + 128) >> 8) + 16);
+  }
+
+  // r, g and b are sums of four pixels, >> 10 averages them with the fixed point's >> 8
+  uint8_t chromaU(int r, int g, int b)
+  {
+    return static_cast<uint8_t>(((-38 * r - 74 * g + 112 * b + 512) >> 10) + 128);
+  }
+
+  uint8_t chromaV(int r, int g, int b)
+  {
+    return static_cast<uint8_t>(((112 * r - 94 * g - 18 * b + 512) >> 10) + 128);
+  }
+
+  // chroma columns [columnBegin, chromaWidth) of one chroma row; luma1 is null when row1 repeats row0
+  void convertRowPair(const uint8_t* row0, const uint8_t* row1, size_t width, size_t columnBegin, uint8_t* luma0, uint8_t* luma1, uint8_t* u, uint8_t* v)
+  {
+    for (size_t column = columnBegin, columns = YuvConverter::chromaWidth(width); column < columns; ++column)
+    {
+      auto x0 = 2 * column;
+      auto x1 = x0 + 1 < width ? x0 + 1 : x0;
+      const uint8_t* pixels[4] = { row0 + x0 * 4, row0 + x1 * 4, row1 + x0 * 4, row1 + x1 * 4 };
+      luma0[x0] = luma(pixels[0]);
+      luma0[x1] = luma(pixels[1]);
+      if (luma1)
+      {
+        luma1[x0] = luma(pixels[2]);
+        luma1[x1] = luma(pixels[3]);
+      }
+
+      int r = 0, g = 0, b = 0;
+      for (auto pixel : pixels)
+      {
+        r += pixel[0];
+        g += pixel[1];
+        b += pixel[2];
+      }
+      u[column] = chromaU(r, g, b);
+      v[column] = chromaV(r, g, b);
+    }
+  }
+
+  // 8 pixels, a channel in each 16-bit lane
+  struct Channels
+  {
+    __m128i r;
+    __m128i g;
+    __m128i b;
+  };
+
+  Channels load(const uint8_t* p)
+  {
+    const auto mask = _mm_set1_epi32(0xFF);
+    auto low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    auto high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16));
+    Channels channels;
+    channels.r = _mm_packs_epi32(_mm_and_si128(low, mask), _mm_and_si128(high, mask));
+    channels.g = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(low, 8), mask), _mm_and_si128(_mm_srli_epi32(high, 8), mask));
+    channels.b = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(low, 16), mask), _mm_and_si128(_mm_srli_epi32(high, 16), mask));
+    return channels;
+  }
+
+  // at most 220 * 255 + 128, which overflows signed 16 bits but not unsigned ones
+  void storeLuma(uint8_t* target, const Channels& c)
+  {
+    auto sum = _mm_add_epi16(
+      _mm_add_epi16(_mm_mullo_epi16(c.r, _mm_set1_epi16(66)), _mm_mullo_epi16(c.g, _mm_set1_epi16(129))),
+      _mm_add_epi16(_mm_mullo_epi16(c.b, _mm_set1_epi16(25)), _mm_set1_epi16(128)));
+    auto y = _mm_add_epi16(_mm_srli_epi16(sum, 8), _mm_set1_epi16(16));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(target), _mm_packus_epi16(y, y));
+  }
+
+  // the two coefficients _mm_madd_epi16 multiplies the low and high halves of each 32-bit lane by
+  __m128i coefficients(short low, short high)
+  {
+    return _mm_set_epi16(high, low, high, low, high, low, high, low);
+  }
+
+  void storeChroma(uint8_t* target, __m128i rg, __m128i b1, __m128i rgCoefficients, __m128i b1Coefficients)
+  {
+    auto sum = _mm_add_epi32(_mm_madd_epi16(rg, rgCoefficients), _mm_madd_epi16(b1, b1Coefficients));
+    auto chroma = _mm_add_epi32(_mm_srai_epi32(sum, 10), _mm_set1_epi32(128));
+    chroma = _mm_packs_epi32(chroma, chroma);
+    auto bytes = _mm_cvtsi128_si32(_mm_packus_epi16(chroma, chroma));
+    std::memcpy(target, &bytes, 4);
+  }
+}
+
+void YuvConverter::convertScalar(const uint8_t* rgba, size_t width, size_t height, size_t chromaBegin, size_t chromaEnd, const Planes& planes)
+{
+  auto columns = chromaWidth(width);
+  for (size_t row = chromaBegin; row < chromaEnd; ++row)
+  {
+    auto y0 = 2 * row;
+    auto y1 = y0 + 1 < height ? y0 + 1 : y0;
+    convertRowPair(rgba + y0 * width * 4, rgba + y1 * width * 4, width, 0, planes.y + y0 * width, y1 != y0 ? planes.y + y1 * width : nullptr, planes.u + row * columns, planes.v + row * columns);
+  }
+}
+
+void YuvConverter::convertSse2(const uint8_t* rgba, size_t width, size_t height, size_t chromaBegin, size_t chromaEnd, const Planes& planes)
+{
+  const auto ones = _mm_set1_epi16(1);
+  const auto one = _mm_set1_epi32(1 << 16);
+  const auto uRG = coefficients(-38, -74);
+  const auto uB = coefficients(112, 512);
+  const auto vRG = coefficients(112, -94);
+  const auto vB = coefficients(-18, 512);
+
+  auto columns = chromaWidth(width);
+  for (size_t row = chromaBegin; row < chromaEnd; ++row)
+  {
+    auto y0 = 2 * row;
+    auto y1 = y0 + 1 < height ? y0 + 1 : y0;
+    auto row0 = rgba + y0 * width * 4;
+    auto row1 = rgba + y1 * width * 4;
+    auto luma0 = planes.y + y0 * width;
+    auto luma1 = y1 != y0 ? planes.y + y1 * width : nullptr;
+    auto u = planes.u + row * columns;
+    auto v = planes.v + row * columns;
+
+    // 8 pixels, 4 chroma samples at a time; the rest, an odd last column among them, by the scalar code
+    size_t x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+      auto top = load(row0 + x * 4);
+      auto bottom = load(row1 + x * 4);
+      storeLuma(luma0 + x, top);
+      if (luma1)
+      {
+        storeLuma(luma1 + x, bottom);
+      }
+
+      // sums of the 2x2 blocks, r and g packed into the halves of each lane, b with a 1 for the rounding term
+      auto r = _mm_add_epi32(_mm_madd_epi16(top.r, ones), _mm_madd_epi16(bottom.r, ones));
+      auto g = _mm_add_epi32(_mm_madd_epi16(top.g, ones), _mm_madd_epi16(bottom.g, ones));
+      auto b = _mm_add_epi32(_mm_madd_epi16(top.b, ones), _mm_madd_epi16(bottom.b, ones));
+      auto rg = _mm_or_si128(r, _mm_slli_epi32(g, 16));
+      auto b1 = _mm_or_si128(b, one);
+      storeChroma(u + x / 2, rg, b1, uRG, uB);
+      storeChroma(v + x / 2, rg, b1, vRG, vB);
+    }
+    convertRowPair(row0, row1, width, x / 2, luma0, luma1, u, v);
+  }
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// RGBA frames into planar YUV 4:2:0, what video encoders take: BT.601 limited range in the same 8-bit fixed
+// point ffmpeg uses, chroma from the average of each 2x2 block. Odd widths and heights repeat the last column
+// or row. The scalar version is the reference, the SSE2 one does the same arithmetic on 8 pixels at a time.
+class YuvConverter
+{
+public:
+  struct Planes
+  {
+    uint8_t* y;   // width * height
+    uint8_t* u;   // chromaWidth() * chromaHeight()
+    uint8_t* v;
+  };
+
+  static size_t chromaWidth(size_t width)
+  {
+    return (width + 1) / 2;
+  }
+
+  static size_t chromaHeight(size_t height)
+  {
+    return (height + 1) / 2;
+  }
+
+  // bytes for all three planes
+  static size_t frameSize(size_t width, size_t height)
+  {
+    return width * height + 2 * chromaWidth(width) * chromaHeight(height);
+  }
+
+  // the planes laid out one after the other in frame, as raw yuv420p files and pipes have them
+  static Planes planes(uint8_t* frame, size_t width, size_t height)
+  {
+    auto chroma = chromaWidth(width) * chromaHeight(height);
+    return { frame, frame + width * height, frame + width * height + chroma };
+  }
+
+  // the rows of chroma [chromaBegin, chromaEnd), luma rows twice that, of width x height rgba with the rows top
+  // down; separate row ranges can go to separate threads
+  static void convertScalar(const uint8_t* rgba, size_t width, size_t height, size_t chromaBegin, size_t chromaEnd, const Planes& planes);
+  static void convertSse2(const uint8_t* rgba, size_t width, size_t height, size_t chromaBegin, size_t chromaEnd, const Planes& planes);
+};
@@ -0,0 +1,154 @@
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "../utils/jobsystem.h"
+#include "tests.h"
+
+// JobSystem's parallelFor() and wait(): every item once, from the system's threads, from inside jobs and from
+// threads outside the system, and waiting on a handle whose slot has been reused.
+
+namespace {
+  // true when function's ranges cover [0, count) exactly once, each starting at a multiple of grain
+  bool coversOnce(JobSystem& jobSystem, size_t count, size_t grain)
+  {
+    std::vector<std::atomic<int>> visits(count);
+    for (auto& visit : visits)
+    {
+      visit = 0;
+    }
+    std::atomic<bool> aligned{ true };
+    jobSystem.parallelFor(count, grain, [&](size_t begin, size_t end)
+    {
+      if (begin % grain || end - begin > grain)
+      {
+        aligned = false;
+      }
+      for (auto i = begin; i < end; ++i)
+      {
+        ++visits[i];
+      }
+    });
+
+    for (auto& visit : visits)
+    {
+      if (visit != 1)
+      {
+        return false;
+      }
+    }
+    return aligned;
+  }
+
+  void parallelForCoversEachItemOnce()
+  {
+    const size_t threadCounts[] = { 1, 2, 4, 8 };
+    for (auto threads : threadCounts)
+    {
+      auto jobSystem = JobSystem::createUnique(threads);
+      EXPECT(jobSystem->threadCount() == threads);
+      EXPECT(coversOnce(*jobSystem, 0, 16));
+      EXPECT(coversOnce(*jobSystem, 1, 16));
+      EXPECT(coversOnce(*jobSystem, 1000, 1));
+      EXPECT(coversOnce(*jobSystem, 1000, 7));
+      // more jobs than a deque starts with, and than a ring block holds
+      EXPECT(coversOnce(*jobSystem, 10000, 1));
+    }
+  }
+
+  // jobs that wait on parallelFor()s of their own keep the workers busy rather than blocked
+  void nestedParallelFor()
+  {
+    auto jobSystem = JobSystem::createUnique(4);
+    const size_t outer = 64, inner = 100;
+    std::atomic<size_t> total{ 0 };
+    jobSystem->parallelFor(outer, 1, [&](size_t begin, size_t end)
+    {
+      for (auto i = begin; i < end; ++i)
+      {
+        jobSystem->parallelFor(inner, 3, [&](size_t first, size_t last)
+        {
+          total += last - first;
+        });
+      }
+    });
+    EXPECT(total == outer * inner);
+  }
+
+  // threads outside the system share its work with the ones inside
+  void parallelForFromOutside()
+  {
+    auto jobSystem = JobSystem::createUnique(3);
+    std::atomic<bool> outsideCovered{ true };
+    std::vector<std::thread> outside;
+    for (int thread = 0; thread < 2; ++thread)
+    {
+      outside.emplace_back([&]()
+      {
+        for (int run = 0; run < 20; ++run)
+        {
+          if (!coversOnce(*jobSystem, 500, 5))
+          {
+            outsideCovered = false;
+          }
+        }
+      });
+    }
+    auto insideCovered = true;
+    for (int run = 0; run < 20; ++run)
+    {
+      insideCovered = coversOnce(*jobSystem, 500, 5) && insideCovered;
+    }
+    for (auto& thread : outside)
+    {
+      thread.join();
+    }
+    EXPECT(insideCovered);
+    EXPECT(outsideCovered);
+  }
+
+  // a done job's slot goes to a later one; waiting on the old handle must not wait for the new job
+  void waitOnReusedSlot()
+  {
+    auto jobSystem = JobSystem::createUnique(2);
+    std::atomic<int> ran{ 0 };
+    auto first = jobSystem->create([&ran]()
+    {
+      ++ran;
+    });
+    jobSystem->run(first);
+    jobSystem->wait(first);
+    EXPECT(ran == 1);
+
+    // round the ring, the last one lands on the first one's slot and stays unfinished until it is run
+    std::vector<JobSystem::Handle> later;
+    for (size_t i = 0; i < JobSystem::JobsPerBlock; ++i)
+    {
+      later.push_back(jobSystem->create([&ran]()
+      {
+        ++ran;
+      }));
+    }
+    EXPECT(later.back().job == first.job);
+    EXPECT(later.back().generation != first.generation);
+    jobSystem->wait(first);
+
+    for (const auto& handle : later)
+    {
+      jobSystem->run(handle);
+    }
+    for (const auto& handle : later)
+    {
+      jobSystem->wait(handle);
+    }
+    EXPECT(ran == static_cast<int>(JobSystem::JobsPerBlock + 1));
+  }
+}
+
+void jobSystemTests()
+{
+  parallelForCoversEachItemOnce();
+  nestedParallelFor();
+  parallelForFromOutside();
+  waitOnReusedSlot();
+}
@@ -0,0 +1,118 @@
+#include <vector>
+
+#include "../opengl/geometryarena.h"
+#include "../utils/rangeallocator.h"
+#include "tests.h"
+
+// RangeAllocator on its own, and GeometryArena's defragment() over the two allocators it holds; the arena's
+// buffers live on MockGL.
+
+namespace {
+  // a mesh of count vertices and as many indices
+  GeometryArena::Handle allocateMesh(GeometryArena& arena, size_t count)
+  {
+    std::vector<vector3<float>> vertices(count);
+    std::vector<unsigned int> indices(count);
+    return arena.allocate(vertices, std::vector<vector3<float>>(), indices);
+  }
+
+  void exhaustion()
+  {
+    RangeAllocator allocator(100);
+    EXPECT(allocator.allocate(101) == RangeAllocator::InvalidOffset);
+    EXPECT(allocator.allocate(0) == RangeAllocator::InvalidOffset);
+
+    EXPECT(allocator.allocate(60) == 0);
+    EXPECT(allocator.allocate(40) == 60);
+    EXPECT(allocator.used() == 100);
+    EXPECT(allocator.freeBlocks() == 0);
+    EXPECT(allocator.allocate(1) == RangeAllocator::InvalidOffset);
+    // a failed allocation changes nothing
+    EXPECT(allocator.used() == 100);
+    EXPECT(allocator.allocations() == 2);
+
+    allocator.grow(110);
+    EXPECT(allocator.allocate(10) == 100);
+  }
+
+  void coalescing()
+  {
+    RangeAllocator allocator(100);
+    auto a = allocator.allocate(10);
+    auto b = allocator.allocate(20);
+    auto c = allocator.allocate(30);
+    auto d = allocator.allocate(40);
+    EXPECT(allocator.freeBlocks() == 0);
+
+    // no free neighbours, two blocks
+    allocator.free(a, 10);
+    allocator.free(c, 30);
+    EXPECT(allocator.freeBlocks() == 2);
+    EXPECT(allocator.largestFreeBlock() == 30);
+    EXPECT(allocator.fragmentation() > 0.0f);
+
+    // best fit: the smaller hole takes it, the larger one stays whole
+    EXPECT(allocator.allocate(8) == a);
+    EXPECT(allocator.largestFreeBlock() == 30);
+    allocator.free(a, 8);
+
+    // b joins the holes on both sides into one
+    allocator.free(b, 20);
+    EXPECT(allocator.freeBlocks() == 1);
+    EXPECT(allocator.largestFreeBlock() == 60);
+    EXPECT(allocator.fragmentation() == 0.0f);
+    EXPECT(allocator.allocate(60) == a);
+
+    // and into the space grow() adds behind the last block
+    allocator.free(a, 60);
+    allocator.free(d, 40);
+    allocator.grow(150);
+    EXPECT(allocator.freeBlocks() == 1);
+    EXPECT(allocator.largestFreeBlock() == 150);
+    EXPECT(allocator.used() == 0);
+    EXPECT(allocator.allocations() == 0);
+  }
+
+  void defragment()
+  {
+    GeometryArena arena(100, 100);
+    auto first = allocateMesh(arena, 20);
+    auto second = allocateMesh(arena, 30);
+    auto third = allocateMesh(arena, 25);
+    auto fourth = allocateMesh(arena, 15);
+    arena.free(first);
+    arena.free(third);
+
+    auto before = arena.statistics();
+    EXPECT(before.freeBlocks == 6);
+    EXPECT(before.fragmentation > 0.0f);
+    auto generation = arena.generation();
+
+    arena.defragment();
+
+    // the live ranges packed to the front in their order, all the free space in one block per pool
+    auto after = arena.statistics();
+    EXPECT(arena.generation() != generation);
+    EXPECT(arena.range(second).firstVertex == 0);
+    EXPECT(arena.range(second).firstIndex == 0);
+    EXPECT(arena.range(fourth).firstVertex == 30);
+    EXPECT(arena.range(fourth).firstIndex == 30);
+    EXPECT(arena.range(fourth).numVertices == 15);
+    EXPECT(after.freeBlocks == 2);
+    EXPECT(after.fragmentation == 0.0f);
+    EXPECT(after.verticesUsed == before.verticesUsed);
+    EXPECT(after.meshes == 2);
+
+    // a mesh no single hole could take before fits without growing the buffers
+    auto fifth = allocateMesh(arena, 55);
+    EXPECT(arena.range(fifth).firstVertex == 45);
+    EXPECT(arena.statistics().vertexCapacity == 100);
+  }
+}
+
+void rangeAllocatorTests()
+{
+  exhaustion();
+  coalescing();
+  defragment();
+}
@@ -0,0 +1,235 @@
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "../opengl/camera.h"
+#include "../opengl/deferredrenderer.h"
+#include "../opengl/gldispatch.h"
+#include "../opengl/mockgl.h"
+#include "../opengl/objects/cube.h"
+#include "../opengl/objects/plane.h"
+#include "../opengl/uniformringbuffer.h"
+#include "tests.h"
+
+// The GL renderer's frames on MockGL, checked by the GL calls they make, then the tests of the other files.
+// Runs from the repository's root, where res/shaders is; exits with 1 when a check fails.
+
+namespace {
+  const size_t Width = 1024;
+  const size_t Height = 768;
+
+  int s_failures = 0;
+
+  // a plane and a grid of cubes on it, all in view of the camera
+  struct Scene
+  {
+    std::unique_ptr<PlaneVBO> plane;
+    std::vector<std::unique_ptr<CubeVBO>> cubes;
+    std::vector<SceneObject*> objects;
+    Camera camera;
+  };
+
+  void buildScene(size_t numCubes, DeferredRenderer& renderer, Scene& scene)
+  {
+    scene.plane = PlaneVBO::createUnique(renderer.pass0());
+    scene.objects.push_back(scene.plane.get());
+    scene.cubes.resize(numCubes);
+    for (size_t i = 0; i < numCubes; ++i)
+    {
+      auto& cube = scene.cubes[i];
+      cube = CubeVBO::createUnique(renderer.pass0());
+      cube->position() = { -9.0f + 2.0f * static_cast<float>(i % 10), 1.0f, -2.0f * static_cast<float>(i / 10) };
+      scene.objects.push_back(cube.get());
+    }
+
+    scene.camera.mode() = Camera::Mode::PERSPECTIVE;
+    scene.camera.perspectiveData() = { 45.0f, static_cast<float>(Width) / static_cast<float>(Height), 0.1f, 1000.0f };
+    scene.camera.position() = { 0, 4, 20 };
+  }
+
+  struct Frame
+  {
+    size_t draws = 0;         // glDrawElementsBaseVertex, one per object drawn
+    size_t multiDraws = 0;    // glMultiDrawElementsIndirect
+    size_t uniforms = 0;
+    DeferredRenderer::Statistics statistics;
+  };
+
+  // the G-buffer pass of a frame, the calls counted from a clean slate
+  Frame drawFrame(DeferredRenderer& renderer, Scene& scene)
+  {
+    GLDispatch::resetCalls();
+    renderer.attach();
+    renderer.drawObjects(scene.objects, scene.camera);
+    renderer.detach();
+
+    Frame frame;
+    frame.draws = GLDispatch::calls("glDrawElementsBaseVertex");
+    frame.multiDraws = GLDispatch::calls("glMultiDrawElementsIndirect");
+    frame.uniforms = GLDispatch::calls().count(GLDispatch::Kind::Uniform);
+    frame.statistics = renderer.statistics();
+    return frame;
+  }
+
+  std::unique_ptr<DeferredRenderer> createRenderer(bool depthPrePass, bool multiDrawIndirect)
+  {
+    auto renderer = DeferredRenderer::createUnique(Width, Height, 8);
+    auto& options = renderer->options();
+    options.depthPrePass = depthPrePass;
+    options.multiDrawIndirect = multiDrawIndirect;
+    options.reuseCommands = false;
+    return renderer;
+  }
+
+  // cubes and the plane are drawn with different modes
+  const size_t DrawModes = 2;
+
+  void direct()
+  {
+    auto renderer = createRenderer(false, false);
+    Scene scene;
+    buildScene(40, *renderer, scene);
+
+    auto frame = drawFrame(*renderer, scene);
+    EXPECT(frame.statistics.drawnObjects == scene.objects.size());
+    EXPECT(frame.draws == frame.statistics.drawnObjects);
+    EXPECT(frame.statistics.drawCalls == frame.draws);
+    EXPECT(frame.multiDraws == 0);
+  }
+
+  void directWithPrePass()
+  {
+    auto renderer = createRenderer(true, false);
+    Scene scene;
+    buildScene(40, *renderer, scene);
+
+    auto frame = drawFrame(*renderer, scene);
+    EXPECT(frame.statistics.drawnObjects == scene.objects.size());
+    EXPECT(frame.draws == 2 * frame.statistics.drawnObjects);
+    EXPECT(frame.statistics.drawCalls == frame.draws);
+    EXPECT(frame.multiDraws == 0);
+  }
+
+  void indirect()
+  {
+    for (auto depthPrePass : { false, true })
+    {
+      auto renderer = createRenderer(depthPrePass, true);
+      Scene scene;
+      buildScene(40, *renderer, scene);
+
+      // one multi-draw per draw mode and pass, whatever the number of objects
+      auto passes = depthPrePass ? 2 : 1;
+      auto frame = drawFrame(*renderer, scene);
+      EXPECT(frame.statistics.drawnObjects == scene.objects.size());
+      EXPECT(frame.multiDraws == passes * DrawModes);
+      EXPECT(frame.statistics.drawCalls == frame.multiDraws);
+      EXPECT(frame.draws == 0);
+    }
+  }
+
+  // object constants come out of the uniform ring, so ten times the objects makes no more glUniform calls
+  void noUniformsPerObject()
+  {
+    struct Path
+    {
+      bool depthPrePass;
+      bool multiDrawIndirect;
+    };
+    for (auto path : { Path{ false, false }, Path{ true, false }, Path{ false, true } })
+    {
+      size_t uniforms[2] = {};
+      size_t drawn[2] = {};
+      size_t numCubes[2] = { 10, 100 };
+      for (size_t run = 0; run < 2; ++run)
+      {
+        auto renderer = createRenderer(path.depthPrePass, path.multiDrawIndirect);
+        Scene scene;
+        buildScene(numCubes[run], *renderer, scene);
+        auto frame = drawFrame(*renderer, scene);
+        uniforms[run] = frame.uniforms;
+        drawn[run] = frame.statistics.drawnObjects;
+      }
+      EXPECT(drawn[1] > drawn[0]);
+      EXPECT(uniforms[1] == uniforms[0]);
+    }
+  }
+
+  // the streams of the first frame are replayed while the camera stays, and recorded again once it moves
+  void reuseWhileStill()
+  {
+    for (auto multiDrawIndirect : { false, true })
+    {
+      auto renderer = createRenderer(false, multiDrawIndirect);
+      renderer->options().reuseCommands = true;
+      Scene scene;
+      buildScene(40, *renderer, scene);
+
+      auto first = drawFrame(*renderer, scene);
+      EXPECT(!first.statistics.commandsReused);
+      for (int still = 0; still < 3; ++still)
+      {
+        auto frame = drawFrame(*renderer, scene);
+        EXPECT(frame.statistics.commandsReused);
+        EXPECT(frame.statistics.recordMilliseconds == 0.0);
+        EXPECT(frame.draws == first.draws);
+        EXPECT(frame.multiDraws == first.multiDraws);
+      }
+
+      scene.camera.position() = { 30, 4, -30 };
+      auto moved = drawFrame(*renderer, scene);
+      EXPECT(!moved.statistics.commandsReused);
+    }
+  }
+
+  // without render() in between, every frame still fences the ring region the one before it wrote
+  void ringFencedWithoutRender()
+  {
+    auto renderer = createRenderer(false, false);
+    Scene scene;
+    buildScene(40, *renderer, scene);
+
+    GLDispatch::resetCalls();
+    const size_t frames = 5;
+    for (size_t i = 0; i < frames; ++i)
+    {
+      renderer->attach();
+      renderer->drawObjects(scene.objects, scene.camera);
+      renderer->detach();
+    }
+    EXPECT(GLDispatch::calls("glFenceSync") == frames - 1);
+    EXPECT(GLDispatch::calls("glClientWaitSync") == frames - UniformRingBuffer::Frames);
+  }
+}
+
+void expect(bool passed, const char* check, const char* test)
+{
+  if (!passed)
+  {
+    ++s_failures;
+    std::cout << test << ": failed " << check << std::endl;
+  }
+}
+
+int main()
+{
+  auto mock = MockGL::createUnique();
+
+  direct();
+  directWithPrePass();
+  indirect();
+  noUniformsPerObject();
+  reuseWhileStill();
+  ringFencedWithoutRender();
+  rangeAllocatorTests();
+  renderQueueTests();
+  jobSystemTests();
+
+  if (s_failures)
+  {
+    std::cout << s_failures << " checks failed" << std::endl;
+    return 1;
+  }
+  std::cout << "Renderer tests passed" << std::endl;
+  return 0;
+}
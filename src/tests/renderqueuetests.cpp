@@ -0,0 +1,122 @@
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "../opengl/renderqueue.h"
+#include "tests.h"
+
+// RenderQueue's radix sort against std::stable_sort, on keys packed by makeKey() and on raw ones.
+
+namespace {
+  // sorts the keys through a queue; the items carry their push order, to check the sort is stable
+  bool sortsLikeStableSort(const std::vector<uint64_t>& keys)
+  {
+    RenderQueue queue;
+    std::vector<RenderQueue::Item> expected;
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+      queue.push(keys[i], nullptr, static_cast<uint32_t>(i));
+      expected.push_back({ keys[i], nullptr, static_cast<uint32_t>(i) });
+    }
+    queue.sort();
+    std::stable_sort(expected.begin(), expected.end(), [](const RenderQueue::Item& a, const RenderQueue::Item& b)
+    {
+      return a.key < b.key;
+    });
+
+    const auto& items = queue.items();
+    return items.size() == expected.size() && std::equal(items.begin(), items.end(), expected.begin(), [](const RenderQueue::Item& a, const RenderQueue::Item& b)
+    {
+      return a.key == b.key && a.index == b.index;
+    });
+  }
+
+  void keyLayout()
+  {
+    auto key = RenderQueue::makeKey(RenderQueue::Pass::GBuffer, 0xabc, 0x123456, 50.0f, 100.0f);
+    EXPECT(RenderQueue::pass(key) == RenderQueue::Pass::GBuffer);
+    EXPECT((key >> (RenderQueue::MeshBits + RenderQueue::DepthBits) & 0xfff) == 0xabc);
+    EXPECT((key >> RenderQueue::DepthBits & 0xffffff) == 0x123456);
+    EXPECT((key & 0xffffff) == 0x7fffff);
+
+    // fields too wide are cut to their bits rather than spilling into the next one
+    auto wide = RenderQueue::makeKey(RenderQueue::Pass::DepthPrePass, 0x1fff, 0x1ffffff, 1000.0f, 100.0f);
+    EXPECT(wide == (uint64_t(0xfff) << 48 | uint64_t(0xffffff) << 24 | 0xffffff));
+    EXPECT(RenderQueue::makeKey(RenderQueue::Pass::Shadow, 0, 0, -1.0f, 100.0f) == uint64_t(2) << 60);
+  }
+
+  void sortMatchesStableSort()
+  {
+    std::mt19937_64 random(7);
+
+    const size_t counts[] = { 0, 1, 2, 3, 255, 256, 1000, 4097 };
+    for (auto count : counts)
+    {
+      std::vector<uint64_t> keys(count);
+
+      // raw keys, every digit in play
+      for (auto& key : keys)
+      {
+        key = random();
+      }
+      EXPECT(sortsLikeStableSort(keys));
+
+      // as the renderer packs them: few passes, programs and meshes, many depths
+      std::uniform_int_distribution<int> passes(0, static_cast<int>(RenderQueue::Pass::Num) - 1);
+      std::uniform_int_distribution<uint32_t> programs(1, 6), meshes(1, 40);
+      std::uniform_real_distribution<float> depths(0.0f, 120.0f);
+      for (auto& key : keys)
+      {
+        key = RenderQueue::makeKey(static_cast<RenderQueue::Pass>(passes(random)), programs(random), meshes(random), depths(random), 100.0f);
+      }
+      EXPECT(sortsLikeStableSort(keys));
+
+      // the same low bits everywhere, only pass and program differ: every pass below the top ones is skipped
+      for (auto& key : keys)
+      {
+        key = RenderQueue::makeKey(static_cast<RenderQueue::Pass>(passes(random)), programs(random), 17, 42.0f, 100.0f);
+      }
+      EXPECT(sortsLikeStableSort(keys));
+
+      // only the top bit differs
+      for (auto& key : keys)
+      {
+        key = (random() & 1) << 63 | 0x0123456789abcdefull;
+      }
+      EXPECT(sortsLikeStableSort(keys));
+
+      // a handful of distinct keys, most items tied
+      for (auto& key : keys)
+      {
+        key = RenderQueue::makeKey(RenderQueue::Pass::GBuffer, programs(random) % 2, 3, 10.0f, 100.0f);
+      }
+      EXPECT(sortsLikeStableSort(keys));
+    }
+  }
+
+  void rangeByPass()
+  {
+    RenderQueue queue;
+    for (uint32_t i = 0; i < 30; ++i)
+    {
+      auto pass = i % 3 ? RenderQueue::Pass::GBuffer : RenderQueue::Pass::DepthPrePass;
+      queue.push(RenderQueue::makeKey(pass, i % 4, i, static_cast<float>(i), 100.0f), nullptr, i);
+    }
+    queue.sort();
+
+    auto prePass = queue.range(RenderQueue::Pass::DepthPrePass);
+    auto gBuffer = queue.range(RenderQueue::Pass::GBuffer);
+    auto shadow = queue.range(RenderQueue::Pass::Shadow);
+    EXPECT(prePass.second - prePass.first == 10);
+    EXPECT(gBuffer.second - gBuffer.first == 20);
+    EXPECT(prePass.second == gBuffer.first);
+    EXPECT(shadow.first == shadow.second);
+  }
+}
+
+void renderQueueTests()
+{
+  keyLayout();
+  sortMatchesStableSort();
+  rangeByPass();
+}
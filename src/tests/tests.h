@@ -0,0 +1,12 @@
+#pragma once
+
+// The checks the test files share; main() is in renderertests.cpp and runs every file's tests.
+
+// counts a failed check and prints it
+void expect(bool passed, const char* check, const char* test);
+
+#define EXPECT(condition) expect((condition), #condition, __func__)
+
+void rangeAllocatorTests();
+void renderQueueTests();
+void jobSystemTests();
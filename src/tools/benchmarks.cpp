@@ -0,0 +1,282 @@
+#include "benchmarks.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include "scenes.h"
+#include "../motionModel/cameraPath.h"
+#include "../opengl/deferredrenderer.h"
+#include "../opengl/glutils.h"
+#include "../opengl/mockgl.h"
+#include "../platform/platform.h"
+#include "../software/softwarerenderer.h"
+#include "../utils/debugout.h"
+#include "../utils/jobsystem.h"
+#include "../utils/logger.h"
+#include "../utils/percentiles.h"
+
+namespace {
+  // frames drawn from the first pose before a camera path benchmark starts timing: shader compilation, first
+  // uploads and the driver's lazy allocations land in these
+  const size_t PathWarmupFrames = 10;
+
+  void logPercentiles(const char* label, const Percentiles& percentiles)
+  {
+    debugLog("%: p50 % ms, p95 % ms, p99 % ms, mean % ms", label, percentiles.p50, percentiles.p95, percentiles.p99, percentiles.mean);
+  }
+
+  // G-buffer passes per thread count when benchmarking the software rasterizer
+  const size_t RasterBenchmarkFrames = 20;
+
+  // frames averaged when counting GL calls on the mock
+  const size_t GLCallsBenchmarkFrames = 60;
+
+  // a job of a few microseconds, about the size of culling or transforming a handful of objects
+  float fineGrainedWork(size_t seed)
+  {
+    auto value = static_cast<float>(seed);
+    for (int i = 0; i < 256; ++i)
+    {
+      value = std::sqrt(value * value + 1.0f);
+    }
+    return value;
+  }
+
+  // lines that go nowhere, so that only what a call costs its caller is timed
+  class NullLogSink : public LogSink
+  {
+  public:
+    void write(LogLevel, const std::string&) override
+    {
+    }
+  };
+
+  // calls between flushes, well within a ring, so that none is dropped
+  const size_t LogBurst = 512;
+  const size_t LogBursts = 200;
+}
+
+int benchmarkCameraPath(size_t numCubes, unsigned int seed, bool hiZ, const CameraPath& cameraPath)
+{
+  auto platform = Platform::createHeadless(WindowSetup::WIDTH, WindowSetup::HEIGHT);
+  if (!platform)
+  {
+    debugLogAt(LogLevel::Error, "Failed to create a headless GL context");
+    return -1;
+  }
+
+  auto jobSystem = JobSystem::createUnique(0);
+  auto deferredRenderer = DeferredRenderer::createUnique(WindowSetup::WIDTH, WindowSetup::HEIGHT, 8);
+  deferredRenderer->jobSystem() = jobSystem.get();
+  deferredRenderer->options().multiDrawIndirect = true;
+  deferredRenderer->options().hiZCulling = hiZ;
+
+  GLScene scene;
+  buildGLScene(numCubes, seed, *deferredRenderer, scene);
+
+  using Clock = std::chrono::high_resolution_clock;
+  auto milliseconds = [](Clock::time_point begin, Clock::time_point end)
+  {
+    return std::chrono::duration<double, std::milli>(end - begin).count();
+  };
+
+  auto frames = cameraPath.frames();
+  std::vector<double> frameTimes, cullTimes, gBufferTimes, lightingTimes;
+  frameTimes.reserve(frames);
+  cullTimes.reserve(frames);
+  gBufferTimes.reserve(frames);
+  lightingTimes.reserve(frames);
+  DeferredRenderer::Visibility visibility;
+  for (size_t frame = 0; frame < PathWarmupFrames + frames; ++frame)
+  {
+    auto pose = frame < PathWarmupFrames ? 0 : frame - PathWarmupFrames;
+    cameraPath.apply(pose, scene.camera);
+
+    auto start = Clock::now();
+    deferredRenderer->cull(scene.objects, scene.camera, visibility);
+    auto culled = Clock::now();
+    deferredRenderer->attach();
+    deferredRenderer->drawObjects(scene.objects, scene.camera, &visibility);
+    deferredRenderer->detach();
+    glFinish();
+    auto gBuffer = Clock::now();
+    deferredRenderer->render(scene.camera);
+    glFinish();
+    auto lit = Clock::now();
+    platform->swapBuffers();
+
+    if (frame >= PathWarmupFrames)
+    {
+      frameTimes.push_back(milliseconds(start, lit));
+      cullTimes.push_back(milliseconds(start, culled));
+      gBufferTimes.push_back(milliseconds(culled, gBuffer));
+      lightingTimes.push_back(milliseconds(gBuffer, lit));
+    }
+  }
+
+  debugLog("Camera path: % frames, % objects, Hi-Z %", frames, scene.objects.size(), hiZ ? "on" : "off");
+  logPercentiles("Frame", Percentiles::of(frameTimes));
+  logPercentiles("Cull", Percentiles::of(cullTimes));
+  logPercentiles("G-buffer pass", Percentiles::of(gBufferTimes));
+  logPercentiles("Lighting pass", Percentiles::of(lightingTimes));
+  return 0;
+}
+
+void benchmarkRaster(size_t numCubes, unsigned int seed)
+{
+  SoftwareScene scene;
+  buildSoftwareScene(numCubes, seed, scene);
+
+  auto renderer = SoftwareRenderer::createUnique(WindowSetup::WIDTH, WindowSetup::HEIGHT);
+  auto maxThreads = std::max<size_t>(1, std::thread::hardware_concurrency());
+  for (size_t threads = 1; threads <= maxThreads; ++threads)
+  {
+    auto jobSystem = JobSystem::createUnique(threads);
+    renderer->jobSystem() = jobSystem.get();
+
+    size_t triangles = 0;
+    double rasterMilliseconds = 0.0;
+    double gBufferMilliseconds = 0.0;
+    for (size_t frame = 0; frame < RasterBenchmarkFrames; ++frame)
+    {
+      renderer->drawObjects(scene.objects, scene.camera);
+      const auto& statistics = renderer->statistics();
+      triangles += statistics.triangles;
+      rasterMilliseconds += statistics.rasterMilliseconds;
+      gBufferMilliseconds += statistics.gBufferMilliseconds;
+    }
+    renderer->jobSystem() = nullptr;
+
+    auto trianglesPerSecond = rasterMilliseconds > 0.0 ? triangles / (rasterMilliseconds / 1000.0) : 0.0;
+    debugLog("Software raster on % threads: % triangles/s, raster % ms, G-buffer pass % ms per frame", threads, trianglesPerSecond, rasterMilliseconds / RasterBenchmarkFrames, gBufferMilliseconds / RasterBenchmarkFrames);
+  }
+}
+
+void benchmarkGLCalls(size_t numCubes, unsigned int seed)
+{
+  auto mock = MockGL::createUnique();
+  auto deferredRenderer = DeferredRenderer::createUnique(WindowSetup::WIDTH, WindowSetup::HEIGHT, 8);
+
+  GLScene scene;
+  buildGLScene(numCubes, seed, *deferredRenderer, scene);
+
+  struct Path
+  {
+    const char* label;
+    bool depthPrePass;
+    bool multiDrawIndirect;
+  };
+  for (auto path : { Path{ "direct", false, false }, Path{ "direct with pre-pass", true, false }, Path{ "indirect", false, true } })
+  {
+    auto& options = deferredRenderer->options();
+    options.depthPrePass = path.depthPrePass;
+    options.multiDrawIndirect = path.multiDrawIndirect;
+    options.reuseCommands = false;
+
+    GLDispatch::resetCalls();
+    for (size_t frame = 0; frame < GLCallsBenchmarkFrames; ++frame)
+    {
+      deferredRenderer->attach();
+      deferredRenderer->drawObjects(scene.objects, scene.camera);
+      deferredRenderer->detach();
+      deferredRenderer->render(scene.camera);
+    }
+    logGLCalls(path.label, GLDispatch::calls(), GLCallsBenchmarkFrames);
+  }
+}
+
+void benchmarkJobs()
+{
+  using Clock = std::chrono::high_resolution_clock;
+
+  auto jobSystem = JobSystem::createUnique(0);
+  for (size_t numJobs : { 1000, 4000, 16000 })
+  {
+    std::vector<float> results(numJobs);
+
+    auto start = Clock::now();
+    jobSystem->parallelFor(numJobs, 1, [&results](size_t begin, size_t end)
+    {
+      for (auto i = begin; i < end; ++i)
+      {
+        results[i] = fineGrainedWork(i);
+      }
+    });
+    auto jobsMilliseconds = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    start = Clock::now();
+    std::vector<std::future<void>> futures;
+    futures.reserve(numJobs);
+    for (size_t i = 0; i < numJobs; ++i)
+    {
+      futures.push_back(std::async(std::launch::async, [&results, i]()
+      {
+        results[i] = fineGrainedWork(i);
+      }));
+    }
+    for (auto& future : futures)
+    {
+      future.wait();
+    }
+    auto asyncMilliseconds = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    debugLog("% jobs on % threads: job system % ms, std::async % ms", numJobs, jobSystem->threadCount(), jobsMilliseconds, asyncMilliseconds);
+  }
+}
+
+void benchmarkLogger()
+{
+  using Clock = std::chrono::high_resolution_clock;
+
+  auto& logger = Logger::instance();
+  std::vector<std::unique_ptr<LogSink>> nullSinks;
+  nullSinks.push_back(std::make_unique<NullLogSink>());
+  auto sinks = logger.replaceSinks(std::move(nullSinks));
+  auto droppedBefore = logger.dropped();
+
+  auto maxThreads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+  std::vector<std::pair<size_t, double>> results;
+  for (size_t threads = 1; threads <= maxThreads; threads = threads < maxThreads ? maxThreads : threads + 1)
+  {
+    std::vector<double> nanoseconds(threads, 0.0);
+    std::vector<std::thread> loggers;
+    for (size_t thread = 0; thread < threads; ++thread)
+    {
+      loggers.emplace_back([&logger, &nanoseconds, thread]()
+      {
+        for (size_t burst = 0; burst < LogBursts; ++burst)
+        {
+          auto start = Clock::now();
+          for (size_t call = 0; call < LogBurst; ++call)
+          {
+            debugLog("Benchmark: thread %, call %, % ms, %", thread, call, 0.25 * static_cast<double>(call), "done");
+          }
+          nanoseconds[thread] += std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+          logger.flush();
+        }
+      });
+    }
+    for (auto& thread : loggers)
+    {
+      thread.join();
+    }
+
+    double total = 0.0;
+    for (auto perThread : nanoseconds)
+    {
+      total += perThread;
+    }
+    results.emplace_back(threads, total / static_cast<double>(threads * LogBursts * LogBurst));
+  }
+  logger.replaceSinks(std::move(sinks));
+
+  for (const auto& result : results)
+  {
+    debugLog("Logger on % threads: % ns per call", result.first, result.second);
+  }
+  debugLog("Logger: % messages dropped", logger.dropped() - droppedBefore);
+}
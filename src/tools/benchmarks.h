@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+
+class CameraPath;
+
+// replays cameraPath through the GL renderer on a headless context, the same scene and the same views every
+// run, and reports the percentiles of the frame time and of each pass. every pass is finished before the next
+// starts, so that its time includes the GPU's share; the frames run slower than pipelined ones but compare
+int benchmarkCameraPath(size_t numCubes, unsigned int seed, bool hiZ, const CameraPath& cameraPath);
+
+// the headless scene's G-buffer pass with 1 .. hardware concurrency threads; the rasterizer's throughput is
+// counted over binning and tile rasterization, the serial vertex work is left out
+void benchmarkRaster(size_t numCubes, unsigned int seed);
+
+// the GL renderer's frames on MockGL, no window or driver: what each path costs in GL calls, the same on every
+// machine, for keeping track of regressions
+void benchmarkGLCalls(size_t numCubes, unsigned int seed);
+
+// the same batches of fine-grained jobs on the job system and through std::async, which starts a thread a job
+void benchmarkJobs();
+
+// the time a debugLog call takes on the thread making it, with one thread and with every core logging at once
+void benchmarkLogger();
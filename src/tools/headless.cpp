@@ -0,0 +1,261 @@
+#include "headless.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+
+#include "scenes.h"
+#include "../motionModel/cameraPath.h"
+#include "../opengl/deferredrenderer.h"
+#include "../opengl/framecapture.h"
+#include "../opengl/glutils.h"
+#include "../opengl/gputimer.h"
+#include "../platform/platform.h"
+#include "../software/imagewriter.h"
+#include "../software/softwarerenderer.h"
+#include "../software/videoencoder.h"
+#include "../utils/debugout.h"
+#include "../utils/jobsystem.h"
+#include "../utils/profiler.h"
+
+namespace {
+  // 0 if image matches the reference, or there is none; 1 if it differs, -1 if the reference couldn't be read
+  int compareWithReference(const Image& image, const std::string& referencePath)
+  {
+    if (referencePath.empty())
+    {
+      return 0;
+    }
+
+    Image reference;
+    int maxDifference = 0;
+    size_t differentPixels = 0;
+    if (!reference.readPPM(referencePath) || !Image::compare(image, reference, 1, maxDifference, differentPixels))
+    {
+      debugLogAt(LogLevel::Error, "Failed to read % or its size differs", referencePath);
+      return -1;
+    }
+    debugLog("% pixels differ from %, by up to %", differentPixels, referencePath, maxDifference);
+    return differentPixels ? 1 : 0;
+  }
+
+  // frames the offscreen capture can have waiting for the disk or the encoder before the GL thread waits too
+  const size_t CaptureQueuedFrames = 8;
+
+  // captures to .png and .ppm are saved frame by frame, anything else is a video
+  bool isImagePath(const std::string& path)
+  {
+    auto dot = path.find_last_of('.');
+    if (dot == std::string::npos)
+    {
+      return false;
+    }
+    auto extension = path.substr(dot);
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](char c)
+    {
+      return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    });
+    return extension == ".png" || extension == ".ppm";
+  }
+
+  // path with the frame number before the extension, frames/frame.png -> frames/frame0042.png
+  std::string framePath(const std::string& path, size_t frame)
+  {
+    auto dot = path.find_last_of('.');
+    auto slash = path.find_last_of("/\\");
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+    {
+      dot = path.size();
+    }
+    auto number = std::to_string(frame);
+    number.insert(0, number.size() < 4 ? 4 - number.size() : 0, '0');
+    return path.substr(0, dot) + number + path.substr(dot);
+  }
+}
+
+int renderHeadless(size_t numCubes, unsigned int seed, bool hiZ, const std::string& imagePath, const std::string& referencePath)
+{
+  SoftwareScene scene;
+  buildSoftwareScene(numCubes, seed, scene);
+
+  auto jobSystem = JobSystem::createUnique(0);
+  auto renderer = SoftwareRenderer::createUnique(WindowSetup::WIDTH, WindowSetup::HEIGHT);
+  renderer->jobSystem() = jobSystem.get();
+  renderer->occlusionCulling() = hiZ;
+  renderer->drawObjects(scene.objects, scene.camera);
+  if (hiZ)
+  {
+    renderer->drawObjects(scene.objects, scene.camera);
+  }
+  renderer->render(scene.camera);
+
+  const auto& statistics = renderer->statistics();
+  auto lightingKernel = LightingKernel::name(renderer->lightingIsa());
+  debugLog("Software renderer: % triangles, % fragments, G-buffer % ms, lighting % ms (%)", statistics.triangles, statistics.fragments, statistics.gBufferMilliseconds, statistics.lightingMilliseconds, lightingKernel);
+  if (hiZ)
+  {
+    debugLog("Hi-Z: % objects deferred, % of them drawn in the second phase, % ms", statistics.hiZDeferred, statistics.hiZRecovered, statistics.hiZMilliseconds);
+  }
+
+  if (!renderer->image().writePPM(imagePath))
+  {
+    debugLogAt(LogLevel::Error, "Failed to write %", imagePath);
+    return -1;
+  }
+  return compareWithReference(renderer->image(), referencePath);
+}
+
+int renderHeadlessGL(size_t numCubes, unsigned int seed, bool hiZ, size_t frames, const std::string& imagePath, const std::string& capturePath, const std::string& referencePath, const CameraPath* cameraPath)
+{
+  auto platform = Platform::createHeadless(WindowSetup::WIDTH, WindowSetup::HEIGHT);
+  if (!platform)
+  {
+    debugLogAt(LogLevel::Error, "Failed to create a headless GL context");
+    return -1;
+  }
+  auto glRenderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+  auto glVersion = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+  debugLog("Headless GL on %: %, %", platform->name(), glRenderer, glVersion);
+
+  auto jobSystem = JobSystem::createUnique(0);
+  auto deferredRenderer = DeferredRenderer::createUnique(WindowSetup::WIDTH, WindowSetup::HEIGHT, 8);
+  deferredRenderer->jobSystem() = jobSystem.get();
+  deferredRenderer->options().multiDrawIndirect = true;
+  deferredRenderer->options().hiZCulling = hiZ;
+
+  GLScene scene;
+  buildGLScene(numCubes, seed, *deferredRenderer, scene);
+  auto gpuTimer = GpuTimer::createUnique();
+
+  std::unique_ptr<ImageWriter> writer;
+  std::unique_ptr<VideoEncoder> encoder;
+  std::unique_ptr<FrameCapture> capture;
+  if (!capturePath.empty())
+  {
+    FrameSink* sink;
+    if (isImagePath(capturePath))
+    {
+      writer = ImageWriter::createUnique(CaptureQueuedFrames);
+      sink = writer.get();
+    }
+    else
+    {
+      encoder = VideoEncoder::createUnique(WindowSetup::WIDTH, WindowSetup::HEIGHT, WindowSetup::REFRESH_RATE, capturePath, jobSystem.get(), CaptureQueuedFrames);
+      if (!encoder)
+      {
+        debugLogAt(LogLevel::Error, "Failed to start the video encoder");
+        return -1;
+      }
+      sink = encoder.get();
+    }
+    capture = FrameCapture::createUnique(WindowSetup::WIDTH, WindowSetup::HEIGHT, sink);
+    if (!capture)
+    {
+      debugLogAt(LogLevel::Error, "Failed to create the capture framebuffer");
+      return -1;
+    }
+  }
+
+  using Clock = std::chrono::high_resolution_clock;
+  auto start = Clock::now();
+  for (size_t frame = 0; frame < frames; ++frame)
+  {
+    PROFILE_SCOPE("Frame");
+    if (cameraPath)
+    {
+      cameraPath->apply(frame, scene.camera);
+    }
+    if (gpuTimer)
+    {
+      gpuTimer->beginFrame();
+    }
+    {
+      PROFILE_SCOPE("Draw objects");
+      GpuTimer::Scope gpuScope(gpuTimer.get(), "GPU G-buffer pass");
+      deferredRenderer->attach();
+      deferredRenderer->drawObjects(scene.objects, scene.camera);
+      deferredRenderer->detach();
+    }
+    if (capture)
+    {
+      {
+        PROFILE_SCOPE("Render");
+        GpuTimer::Scope gpuScope(gpuTimer.get(), "GPU lighting pass");
+        capture->attach();
+        deferredRenderer->render(scene.camera);
+        capture->detach();
+      }
+      PROFILE_SCOPE("Capture");
+      capture->capture(writer ? framePath(capturePath, frame) : capturePath);
+    }
+    else
+    {
+      {
+        PROFILE_SCOPE("Render");
+        GpuTimer::Scope gpuScope(gpuTimer.get(), "GPU lighting pass");
+        deferredRenderer->render(scene.camera);
+      }
+      PROFILE_SCOPE("Swap");
+      platform->swapBuffers();
+      glFinish();
+    }
+    Profiler::frame();
+  }
+  if (capture)
+  {
+    capture->finish();
+  }
+  auto frameMilliseconds = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / std::max<size_t>(frames, 1);
+
+  const auto& statistics = deferredRenderer->statistics();
+  debugLog("Headless GL: % frames, % ms per frame, % objects drawn, % draw calls", frames, frameMilliseconds, statistics.drawnObjects, statistics.drawCalls);
+  if (gpuTimer)
+  {
+    // all but the last GpuTimer::QueryLatency frames
+    logGpuPasses(*gpuTimer);
+  }
+  if (capture)
+  {
+    const auto& captured = capture->statistics();
+    debugLog("Capture: % frames, % readback stalls, % ms per frame mapping", captured.captured, captured.stalls, captured.mapMilliseconds / std::max<size_t>(frames, 1));
+    bool failed;
+    if (writer)
+    {
+      writer->flush();
+      auto written = writer->statistics();
+      debugLog("Writer: % written (% failed) in % ms per frame, % stalls", written.written, written.failed, written.writeMilliseconds / std::max<size_t>(written.written, 1), written.stalls);
+      failed = written.failed != 0;
+    }
+    else
+    {
+      failed = !encoder->close();
+      auto encoded = encoder->statistics();
+      auto perFrame = std::max<size_t>(encoded.encoded + encoded.dropped, 1);
+      debugLog("Encoder: % encoded (% dropped), % ms per frame converting, % ms per frame writing, % stalls", encoded.encoded, encoded.dropped, encoded.convertMilliseconds / perFrame, encoded.writeMilliseconds / perFrame, encoded.stalls);
+    }
+    if (imagePath.empty())
+    {
+      return failed ? -1 : 0;
+    }
+  }
+
+  // GL's rows go bottom up
+  Image image;
+  image.resize(WindowSetup::WIDTH, WindowSetup::HEIGHT);
+  std::vector<uint8_t> pixels(image.pixels.size());
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, capture ? capture->framebuffer() : 0);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glReadPixels(0, 0, WindowSetup::WIDTH, WindowSetup::HEIGHT, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+  auto rowBytes = image.width * 3;
+  for (size_t y = 0; y < image.height; ++y)
+  {
+    std::copy_n(pixels.data() + (image.height - 1 - y) * rowBytes, rowBytes, image.row(y));
+  }
+
+  if (!image.write(imagePath))
+  {
+    debugLogAt(LogLevel::Error, "Failed to write %", imagePath);
+    return -1;
+  }
+  return compareWithReference(image, referencePath);
+}
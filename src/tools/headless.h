@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+class CameraPath;
+
+// the first frame through the software renderer; with hiZ drawn twice, the second time in two phases against
+// the pyramid of the first, which has to come out the same
+int renderHeadless(size_t numCubes, unsigned int seed, bool hiZ, const std::string& imagePath, const std::string& referencePath);
+
+// frames through the GL renderer on a context without a window, EGL on Linux; llvmpipe renders them where
+// there's no GPU. the time per frame includes waiting for the GPU, the last frame is read back and saved.
+// with capturePath every frame is drawn offscreen instead and streamed to disk, or to a video encoder, without
+// waiting on the GPU. with cameraPath the camera follows it, frame by frame
+int renderHeadlessGL(size_t numCubes, unsigned int seed, bool hiZ, size_t frames, const std::string& imagePath, const std::string& capturePath, const std::string& referencePath, const CameraPath* cameraPath);
@@ -0,0 +1,82 @@
+#include "scenes.h"
+
+#include <cstdlib>
+
+#include "../opengl/deferredrenderer.h"
+#include "../opengl/gputimer.h"
+#include "../utils/debugout.h"
+
+const float WindowSetup::ASPECT = static_cast<float>(WIDTH) / static_cast<float>(HEIGHT);
+
+const vector3<float> PlaneColor = { 230, 149, 18 };
+
+void placeCube(SceneObject& cube)
+{
+  auto r0 = rand() / static_cast<float>(RAND_MAX);
+  auto r1 = rand() / static_cast<float>(RAND_MAX);
+  auto r2 = rand() / static_cast<float>(RAND_MAX);
+
+  cube.color() = { 214.0f * r0, 64.0f * r0, 187.0f * r0 };
+  cube.color() = { 255, 200, 0 };
+  cube.position() = {-100.0f + (200.0f * r1), 1, -100.0f + (200.0f * r2)};
+}
+
+void buildSoftwareScene(size_t numCubes, unsigned int seed, SoftwareScene& scene)
+{
+  srand(seed);
+
+  scene.plane = MeshObject::createUnique(MeshData::plane());
+  scene.plane->color() = PlaneColor;
+  scene.objects.push_back(scene.plane.get());
+
+  scene.cubes.resize(numCubes);
+  for (auto& cube : scene.cubes)
+  {
+    cube = MeshObject::createUnique(MeshData::cube());
+    placeCube(*cube);
+    scene.objects.push_back(cube.get());
+  }
+
+  scene.camera.mode() = Camera::Mode::PERSPECTIVE;
+  scene.camera.perspectiveData() = { 45.0f, WindowSetup::ASPECT, 0.1f, 1000.0f };
+  scene.camera.position() = { 0, 4, 20 };
+}
+
+void buildGLScene(size_t numCubes, unsigned int seed, DeferredRenderer& renderer, GLScene& scene)
+{
+  srand(seed);
+
+  scene.cubes.resize(numCubes);
+  for (auto& cube : scene.cubes)
+  {
+    cube = CubeVBO::createUnique(renderer.pass0());
+    placeCube(*cube);
+  }
+
+  scene.plane = PlaneVBO::createUnique(renderer.pass0());
+  scene.plane->color() = PlaneColor;
+  scene.objects.push_back(scene.plane.get());
+  for (auto& cube : scene.cubes)
+  {
+    scene.objects.push_back(cube.get());
+  }
+
+  scene.camera.mode() = Camera::Mode::PERSPECTIVE;
+  scene.camera.perspectiveData() = { 45.0f, WindowSetup::ASPECT, 0.1f, 1000.0f };
+  scene.camera.position() = { 0, 4, 20 };
+}
+
+void logGpuPasses(GpuTimer& gpuTimer)
+{
+  for (const auto& pass : gpuTimer.averages())
+  {
+    debugLog("%: % ms", pass.name, pass.milliseconds);
+  }
+  gpuTimer.resetAverages();
+}
+
+void logGLCalls(const char* label, const GLDispatch::Calls& calls, size_t frames)
+{
+  auto perFrame = [&](GLDispatch::Kind kind) { return calls.count(kind) / frames; };
+  debugLog("GL calls, %: % per frame, % binds, % uniforms, % draws", label, calls.total() / frames, perFrame(GLDispatch::Kind::Bind), perFrame(GLDispatch::Kind::Uniform), perFrame(GLDispatch::Kind::Draw));
+}
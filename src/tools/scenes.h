@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "../linearAlgebra/vector3.h"
+#include "../opengl/camera.h"
+#include "../opengl/gldispatch.h"
+#include "../opengl/objects/cube.h"
+#include "../opengl/objects/plane.h"
+#include "../opengl/objects/meshobject.h"
+
+class DeferredRenderer;
+class GpuTimer;
+
+struct WindowSetup {
+  static const int REFRESH_RATE = 60;// Hz
+  static const int WIDTH = 1024;
+  static const int HEIGHT = 768;
+  static const float ASPECT;
+};
+
+extern const vector3<float> PlaneColor;
+
+// scatters a cube over the plane; the same rand() sequence gives the same scene, with GL or without
+void placeCube(SceneObject& cube);
+
+// the scene of the interactive mode from the starting eye, built for the software renderer
+struct SoftwareScene
+{
+  std::unique_ptr<MeshObject> plane;
+  std::vector<std::unique_ptr<MeshObject>> cubes;
+  std::vector<SceneObject*> objects;
+  Camera camera;
+};
+
+void buildSoftwareScene(size_t numCubes, unsigned int seed, SoftwareScene& scene);
+
+// the scene of the interactive mode from the starting eye, built for the GL renderer
+struct GLScene
+{
+  std::unique_ptr<PlaneVBO> plane;
+  std::vector<std::unique_ptr<CubeVBO>> cubes;
+  std::vector<SceneObject*> objects;
+  Camera camera;
+};
+
+void buildGLScene(size_t numCubes, unsigned int seed, DeferredRenderer& renderer, GLScene& scene);
+
+// the GPU time of each pass over the frames read back since the last call
+void logGpuPasses(GpuTimer& gpuTimer);
+
+void logGLCalls(const char* label, const GLDispatch::Calls& calls, size_t frames);
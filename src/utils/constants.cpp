@@ -1,5 +1,7 @@
 #include "constants.h"
 
+#include <cmath>
+
 const double constants::math::deg_to_rad= 0.017453292519943295769236907684886;
 const double constants::math::rad_to_deg = 57.295779513082320876798154814105;
 const double constants::math::pi = 3.14159265358979323846264338327950288419716939937510582097494459230781640628620899862803482534211706;
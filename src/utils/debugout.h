@@ -1,50 +1,48 @@
 #ifndef __DEBUG_OUT_H__
 #define __DEBUG_OUT_H__
 
+#ifdef _WIN32
 #include <Windows.h>
-#include <sstream>
-
-inline void debugLogi(const char* format, std::stringstream& text) // base function
-{
-  text << format << "\n";
-}
+#else
+#include <cstdio>
+#endif
 
-template<typename T, typename... Targs>
-inline void debugLogi(const char* format, std::stringstream& text, T value, Targs... Fargs)
-{
-  for (; *format != '\0'; format++) 
-  {
-    if (*format == '%') 
-    {
-      text << value;
-      debugLogi(format + 1, text, Fargs...); // recursive call
-      return;
-    }
-    text << *format;
-  }
-}
+#include "logformat.h"
+#include "logger.h"
 
-template<typename T, typename... Targs>
-inline void debugLog(const char* format, T value, Targs... Fargs)
+// the debugger's output window on Windows, stderr elsewhere
+inline void debugOutput(const char* text)
 {
-#ifdef DOUT
-  std::stringstream text;
-  debugLogi(format, text, value, Fargs...);
-  OutputDebugStringA(text.str().c_str());
-#else // DOUT
-  UNREFERENCED_PARAMETER(format);
-  UNREFERENCED_PARAMETER(value);
-  ;
+#ifdef _WIN32
+  OutputDebugStringA(text);
+#else
+  fputs(text, stderr);
 #endif
 }
-inline void debugLog(const char* format)
+
+// what debugLog() expands to; format comes again after Text, the arguments with it, so that the macros don't need
+// to split them off
+template<typename Text, typename... Targs>
+inline void debugLogFormatted(LogLevel level, Text, const char* format, const Targs&... Fargs)
 {
+  static_assert(StaticLogFormat<Text>::format.argumentCount == sizeof...(Targs), "debugLog: the format needs a '%' per argument, '%%' prints one");
+  (void)format;
 #ifdef DOUT
-  OutputDebugStringA(format);
-  OutputDebugStringA("\n");
+  Logger::log(level, StaticLogFormat<Text>::format, Fargs...);
 #else // DOUT
-  UNREFERENCED_PARAMETER(format);
+  (void)level;
+  ((void)Fargs, ...);
 #endif
 }
 
+// the extra expansion is for MSVC's preprocessor, which otherwise passes __VA_ARGS__ on as a single argument
+#define DEBUG_LOG_EXPAND(x) x
+#define DEBUG_LOG_FORMAT(format, ...) format
+#define DEBUG_LOG_FIRST(...) DEBUG_LOG_EXPAND(DEBUG_LOG_FORMAT(__VA_ARGS__, ~))
+
+// debugLog("format", values...): each '%' in the literal format is replaced by the next value, and how many there
+// are is checked when compiling; the line is written later, by the Logger's thread
+#define debugLogAt(level, ...) debugLogFormatted(level, LOG_FORMAT(DEBUG_LOG_FIRST(__VA_ARGS__)), __VA_ARGS__)
+#define debugLog(...) debugLogAt(LogLevel::Info, __VA_ARGS__)
+
 #endif // !__DEBUG_OUT_H__
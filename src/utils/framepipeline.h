@@ -0,0 +1,120 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "profiler.h"
+
+// Two-stage frame pipeline: a simulation thread fills the snapshot of frame N + 1 while the caller submits
+// frame N from the other one. The stages hand the two snapshots back and forth, so neither is ever written
+// while the other stage reads it. With pipelining off the simulation runs inline in acquire() instead, which
+// gives the same frames one after the other.
+template<typename Snapshot>
+class FramePipeline
+{
+public:
+  using Simulate = std::function<void(Snapshot&)>;
+
+  static std::unique_ptr<FramePipeline> createUnique(Simulate simulate, bool pipelined)
+  {
+    std::unique_ptr<FramePipeline> pipeline(new FramePipeline());
+    pipeline->m_simulate = std::move(simulate);
+    if (pipelined)
+    {
+      pipeline->m_thread = std::thread(&FramePipeline::simulateLoop, pipeline.get());
+    }
+    return pipeline;
+  }
+
+  ~FramePipeline()
+  {
+    if (m_thread.joinable())
+    {
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+      }
+      m_changed.notify_all();
+      m_thread.join();
+    }
+  }
+
+  bool pipelined() const
+  {
+    return m_thread.joinable();
+  }
+
+  // the next simulated frame; stays valid, and untouched by the simulation, until the following acquire().
+  // the simulation of the frame after it starts right away
+  const Snapshot& acquire()
+  {
+    if (!pipelined())
+    {
+      m_simulate(m_snapshots[0]);
+      return m_snapshots[0];
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    // the first frame has nothing to overlap with
+    if (!m_started)
+    {
+      m_started = true;
+      m_simulating = true;
+      m_changed.notify_all();
+    }
+    m_changed.wait(lock, [this]()
+    {
+      return !m_simulating;
+    });
+
+    // the snapshot just finished goes to the caller, the one it was done with goes back to the simulation
+    m_current = m_next;
+    m_next = 1 - m_next;
+    m_simulating = true;
+    m_changed.notify_all();
+    return m_snapshots[m_current];
+  }
+
+protected:
+  FramePipeline() = default;
+
+  void simulateLoop()
+  {
+    PROFILE_THREAD("Simulation");
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;)
+    {
+      m_changed.wait(lock, [this]()
+      {
+        return m_quit || m_simulating;
+      });
+      if (m_quit)
+      {
+        return;
+      }
+
+      auto& snapshot = m_snapshots[m_next];
+      lock.unlock();
+      m_simulate(snapshot);
+      lock.lock();
+
+      m_simulating = false;
+      m_changed.notify_all();
+    }
+  }
+
+  Simulate m_simulate;
+  Snapshot m_snapshots[2];
+  size_t m_current = 1;
+  size_t m_next = 0;        // the one being simulated, or done and waiting for acquire()
+
+  std::thread m_thread;
+  std::mutex m_mutex;
+  std::condition_variable m_changed;
+  bool m_started = false;
+  bool m_simulating = false;
+  bool m_quit = false;
+};
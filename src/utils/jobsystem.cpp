@@ -0,0 +1,318 @@
+#include "jobsystem.h"
+
+#include <algorithm>
+
+#include "debugout.h"
+#include "profiler.h"
+
+namespace {
+  // which system the current thread works for, and as which worker
+  thread_local uint64_t t_system = 0;
+  thread_local size_t t_worker = 0;
+
+  std::atomic<uint64_t> s_nextSystem{ 1 };
+
+  // failed attempts at finding a job before a worker goes to sleep
+  const int IdleSpins = 64;
+
+  // jobs a deque holds before it first grows
+  const size_t DequeCapacity = 1024;
+}
+
+std::unique_ptr<JobSystem> JobSystem::createUnique(size_t numThreads)
+{
+  if (!numThreads)
+  {
+    numThreads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+  }
+
+  std::unique_ptr<JobSystem> system(new JobSystem());
+  system->m_id = s_nextSystem++;
+  for (size_t i = 0; i < numThreads; ++i)
+  {
+    auto worker = std::make_unique<Worker>();
+    worker->ring.blocks.push_back(newBlock());
+    system->m_workers.push_back(std::move(worker));
+  }
+  system->m_outsideRing.blocks.push_back(newBlock());
+
+  // the creating thread is the first one
+  t_system = system->m_id;
+  t_worker = 0;
+  for (size_t i = 1; i < numThreads; ++i)
+  {
+    system->m_threads.emplace_back(&JobSystem::work, system.get(), i);
+  }
+  return system;
+}
+
+std::unique_ptr<JobSystem::Job[]> JobSystem::newBlock()
+{
+  std::unique_ptr<Job[]> block(new Job[JobsPerBlock]);
+  for (size_t i = 0; i < JobsPerBlock; ++i)
+  {
+    block[i].unfinished = 0;
+    block[i].generation = 0;
+  }
+  return block;
+}
+
+JobSystem::~JobSystem()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_sleepMutex);
+    m_quit = true;
+  }
+  m_wake.notify_all();
+  for (auto& thread : m_threads)
+  {
+    thread.join();
+  }
+}
+
+void JobSystem::run(const Handle& handle)
+{
+  if (handle.job->generation != handle.generation)
+  {
+    debugLogAt(LogLevel::Error, "Job system: run() of a job whose slot has been reused");
+    return;
+  }
+
+  if (auto own = worker())
+  {
+    own->deque.push(handle.job);
+  }
+  else
+  {
+    std::lock_guard<std::mutex> lock(m_outsideMutex);
+    m_outsideQueue.push_back(handle.job);
+    ++m_outsideQueued;
+  }
+  ++m_queued;
+
+  // a sleeper either shows up here or sees m_queued when it checks before waiting
+  if (m_sleeping)
+  {
+    std::lock_guard<std::mutex> lock(m_sleepMutex);
+    m_wake.notify_one();
+  }
+}
+
+void JobSystem::wait(const Handle& handle)
+{
+  auto job = handle.job;
+  while (job->generation == handle.generation && job->unfinished > 0)
+  {
+    if (auto other = next())
+    {
+      execute(other);
+    }
+    else
+    {
+      std::this_thread::yield();
+    }
+  }
+}
+
+JobSystem::Job* JobSystem::allocate()
+{
+  if (auto own = worker())
+  {
+    return own->ring.allocate();
+  }
+
+  std::lock_guard<std::mutex> lock(m_outsideMutex);
+  return m_outsideRing.allocate();
+}
+
+JobSystem::Job* JobSystem::Ring::allocate()
+{
+  // carry on round the ring from the last job handed out, stepping over the ones still in flight
+  auto numJobs = blocks.size() * JobsPerBlock;
+  for (size_t i = 0; i < numJobs; ++i)
+  {
+    auto index = cursor++ % numJobs;
+    auto job = &blocks[index / JobsPerBlock][index % JobsPerBlock];
+    if (job->unfinished == 0)
+    {
+      return job;
+    }
+  }
+
+  // all in flight; waiting for one to finish could wait on the very jobs this thread is in the middle of
+  blocks.push_back(newBlock());
+  cursor = numJobs + 1;
+  return &blocks.back()[0];
+}
+
+JobSystem::Deque::Deque() : m_top(0), m_bottom(0)
+{
+  m_arrays.push_back(std::make_unique<Array>(DequeCapacity));
+  m_array = m_arrays.back().get();
+}
+
+void JobSystem::Deque::push(Job* job)
+{
+  auto bottom = m_bottom.load(std::memory_order_relaxed);
+  auto top = m_top.load(std::memory_order_acquire);
+  auto array = m_array.load(std::memory_order_relaxed);
+  if (bottom - top > static_cast<int64_t>(array->mask))
+  {
+    auto grown = std::make_unique<Array>((array->mask + 1) * 2);
+    for (auto i = top; i < bottom; ++i)
+    {
+      grown->at(i).store(array->at(i).load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+    array = grown.get();
+    m_arrays.push_back(std::move(grown));
+    m_array.store(array, std::memory_order_release);
+  }
+
+  array->at(bottom).store(job, std::memory_order_relaxed);
+  // publishes the slot, and the job written before it, to the thieves
+  m_bottom.store(bottom + 1, std::memory_order_release);
+}
+
+JobSystem::Job* JobSystem::Deque::pop()
+{
+  // claim the bottom slot first, then look at the top: a thief either sees the claim or wins the CAS below
+  auto bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+  auto array = m_array.load(std::memory_order_relaxed);
+  m_bottom.store(bottom, std::memory_order_seq_cst);
+  auto top = m_top.load(std::memory_order_seq_cst);
+
+  if (top > bottom)
+  {
+    m_bottom.store(bottom + 1, std::memory_order_release);
+    return nullptr;
+  }
+
+  auto job = array->at(bottom).load(std::memory_order_relaxed);
+  if (top == bottom)
+  {
+    // the last one, thieves may be after it as well
+    if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+    {
+      job = nullptr;
+    }
+    m_bottom.store(bottom + 1, std::memory_order_release);
+  }
+  return job;
+}
+
+JobSystem::Job* JobSystem::Deque::steal()
+{
+  auto top = m_top.load(std::memory_order_seq_cst);
+  auto bottom = m_bottom.load(std::memory_order_seq_cst);
+  if (top >= bottom)
+  {
+    return nullptr;
+  }
+
+  // read before the CAS: once the top moves on, the owner may write the slot again
+  auto job = m_array.load(std::memory_order_acquire)->at(top).load(std::memory_order_relaxed);
+  if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+  {
+    return nullptr;
+  }
+  return job;
+}
+
+void JobSystem::execute(Job* job)
+{
+  job->function(job);
+  finish(job);
+}
+
+void JobSystem::finish(Job* job)
+{
+  // the last one out finishes the parent. a done job may be handed out again right away, so nothing of it
+  // can be read after the count drops
+  while (job)
+  {
+    auto parent = job->parent;
+    if (--job->unfinished)
+    {
+      return;
+    }
+    job = parent;
+  }
+}
+
+JobSystem::Job* JobSystem::next()
+{
+  auto own = worker();
+  if (own)
+  {
+    if (auto job = own->deque.pop())
+    {
+      --m_queued;
+      return job;
+    }
+  }
+
+  // looked at without the lock first, the workers come by here on every idle spin
+  if (m_outsideQueued)
+  {
+    std::lock_guard<std::mutex> lock(m_outsideMutex);
+    if (!m_outsideQueue.empty())
+    {
+      auto job = m_outsideQueue.front();
+      m_outsideQueue.pop_front();
+      --m_outsideQueued;
+      --m_queued;
+      return job;
+    }
+  }
+
+  // steal the oldest job, which tends to be the biggest piece of work left
+  auto index = own ? t_worker : 0;
+  for (size_t i = own ? 1 : 0; i < m_workers.size(); ++i)
+  {
+    auto& victim = *m_workers[(index + i) % m_workers.size()];
+    if (auto job = victim.deque.steal())
+    {
+      --m_queued;
+      return job;
+    }
+  }
+  return nullptr;
+}
+
+JobSystem::Worker* JobSystem::worker() const
+{
+  return t_system == m_id ? m_workers[t_worker].get() : nullptr;
+}
+
+void JobSystem::work(size_t index)
+{
+  t_system = m_id;
+  t_worker = index;
+  PROFILE_THREAD("Job worker");
+
+  int idle = 0;
+  while (!m_quit)
+  {
+    if (auto job = next())
+    {
+      execute(job);
+      idle = 0;
+      continue;
+    }
+
+    if (++idle < IdleSpins)
+    {
+      std::this_thread::yield();
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(m_sleepMutex);
+    ++m_sleeping;
+    m_wake.wait(lock, [this]()
+    {
+      return m_quit || m_queued > 0;
+    });
+    --m_sleeping;
+    idle = 0;
+  }
+}
@@ -0,0 +1,225 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Work-stealing job system. Every thread of the system has a Chase-Lev deque of runnable jobs: it pushes and pops
+// its own at the bottom without taking a lock and, when that runs dry, steals from the top of another thread's.
+// A job counts its unfinished children, and is done once it has run and all of them are; wait() keeps running
+// jobs until the one waited on is done, so waiting from inside a job doesn't block a worker.
+//
+// The thread that creates the system is its first thread and runs jobs only while it waits. Threads outside the
+// system queue their jobs on a shared, locked deque, which every thread takes from before stealing. Jobs come from
+// a ring per thread, which grows by a block when all of them are in flight; a job's slot is reused once it is
+// done, and the handle create() returns tells that use of the slot from the later ones.
+class JobSystem
+{
+public:
+  static const size_t JobsPerBlock = 4096;
+
+  struct alignas(64) Job
+  {
+    static const size_t PayloadSize = 96;
+
+    void (*function)(Job*);
+    Job* parent;
+    std::atomic<int32_t> unfinished;  // itself plus its unfinished children
+    std::atomic<uint32_t> generation; // bumped every time the slot is handed out
+    alignas(16) unsigned char payload[PayloadSize];
+  };
+
+  // a job as create() handed it out
+  struct Handle
+  {
+    Job* job = nullptr;
+    uint32_t generation = 0;
+  };
+
+  // 0 threads means one per hardware thread; the count includes the creating thread
+  static std::unique_ptr<JobSystem> createUnique(size_t numThreads);
+
+  ~JobSystem();
+
+  size_t threadCount() const
+  {
+    return m_workers.size();
+  }
+
+  // a job running function(), which is stored in the job and has to fit its payload
+  template<typename Function>
+  Handle create(Function&& function)
+  {
+    return create(nullptr, std::forward<Function>(function));
+  }
+
+  // as create(), the parent is not done until the child is; call before running the parent
+  template<typename Function>
+  Handle createChild(const Handle& parent, Function&& function)
+  {
+    return create(parent.job, std::forward<Function>(function));
+  }
+
+  // queues the job on the calling thread's deque; a handle whose slot has been reused is refused
+  void run(const Handle& handle);
+
+  // runs other jobs until the job is done; returns at once when its slot has been reused, which it only is once
+  // the job is done
+  void wait(const Handle& handle);
+
+  // function(begin, end) over [0, count) in ranges of grain items, each starting at a multiple of grain;
+  // returns when all of them have returned
+  template<typename Function>
+  void parallelFor(size_t count, size_t grain, const Function& function)
+  {
+    if (!count)
+    {
+      return;
+    }
+    grain = grain ? grain : 1;
+    if (count <= grain || m_workers.size() == 1)
+    {
+      // the same ranges in order, callers may keep per-range results
+      for (size_t begin = 0; begin < count; begin += grain)
+      {
+        function(begin, begin + grain < count ? begin + grain : count);
+      }
+      return;
+    }
+
+    auto root = create([]() {});
+    for (size_t begin = 0; begin < count; begin += grain)
+    {
+      auto end = begin + grain < count ? begin + grain : count;
+      run(createChild(root, [&function, begin, end]()
+      {
+        function(begin, end);
+      }));
+    }
+    run(root);
+    wait(root);
+  }
+
+protected:
+  // the jobs one thread hands out
+  struct Ring
+  {
+    std::vector<std::unique_ptr<Job[]>> blocks;
+    size_t cursor = 0;
+
+    Job* allocate();
+  };
+
+  // Chase-Lev: the owner pushes and pops at the bottom, any thread steals at the top; only the last job left
+  // is raced for, with a CAS on the top
+  class Deque
+  {
+  public:
+    Deque();
+
+    // owner only
+    void push(Job* job);
+
+    // owner only; the newest job, or null
+    Job* pop();
+
+    // the oldest job, or null when there is none or another thread got it first
+    Job* steal();
+
+  protected:
+    struct Array
+    {
+      explicit Array(size_t capacity) : mask(capacity - 1), slots(new std::atomic<Job*>[capacity])
+      {
+      }
+
+      std::atomic<Job*>& at(int64_t index)
+      {
+        return slots[static_cast<size_t>(index) & mask];
+      }
+
+      size_t mask;
+      std::unique_ptr<std::atomic<Job*>[]> slots;
+    };
+
+    alignas(64) std::atomic<int64_t> m_top;
+    alignas(64) std::atomic<int64_t> m_bottom;
+    std::atomic<Array*> m_array;
+    std::vector<std::unique_ptr<Array>> m_arrays;  // the outgrown ones stay, a thief may still be reading one
+  };
+
+  struct alignas(64) Worker
+  {
+    Ring ring;
+    Deque deque;
+  };
+
+  JobSystem() = default;
+
+  template<typename Function>
+  Handle create(Job* parent, Function&& function)
+  {
+    using Stored = typename std::decay<Function>::type;
+    static_assert(sizeof(Stored) <= Job::PayloadSize, "the job's function doesn't fit its payload");
+    static_assert(alignof(Stored) <= 16, "the job's function is over-aligned");
+
+    auto job = allocate();
+    new (job->payload) Stored(std::forward<Function>(function));
+    job->function = [](Job* job)
+    {
+      auto stored = reinterpret_cast<Stored*>(job->payload);
+      (*stored)();
+      stored->~Stored();
+    };
+    job->parent = parent;
+    auto generation = job->generation.load(std::memory_order_relaxed) + 1;
+    job->generation = generation;
+    job->unfinished = 1;
+    if (parent)
+    {
+      ++parent->unfinished;
+    }
+    return { job, generation };
+  }
+
+  Job* allocate();
+
+  static std::unique_ptr<Job[]> newBlock();
+
+  void execute(Job* job);
+
+  void finish(Job* job);
+
+  // the calling thread's own job first, then one from outside the system, then one stolen from the others
+  Job* next();
+
+  // the calling thread's worker, or null for a thread outside the system
+  Worker* worker() const;
+
+  void work(size_t index);
+
+  uint64_t m_id = 0;   // tells the systems apart for the threads, even one created where another one was
+  std::vector<std::unique_ptr<Worker>> m_workers;
+  std::vector<std::thread> m_threads;
+
+  // threads outside the system
+  std::mutex m_outsideMutex;
+  Ring m_outsideRing;
+  std::deque<Job*> m_outsideQueue;
+  std::atomic<size_t> m_outsideQueued{ 0 };
+
+  std::atomic<size_t> m_queued{ 0 };   // jobs sitting in the deques
+  std::atomic<size_t> m_sleeping{ 0 };
+  std::mutex m_sleepMutex;
+  std::condition_variable m_wake;
+  std::atomic<bool> m_quit{ false };
+};
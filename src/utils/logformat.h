@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// A log format string split at compile time into the literal text around its '%'s, each but the last followed by
+// an argument. "%%" is a '%' of the text's own and takes no argument.
+struct LogFormat
+{
+  struct Segment
+  {
+    uint32_t begin;
+    uint32_t length;
+    bool argument;   // the next argument goes after the text
+  };
+
+  const char* text;
+  const Segment* segments;
+  uint32_t segmentCount;
+  uint32_t argumentCount;
+};
+
+constexpr size_t logFormatArguments(const char* text)
+{
+  size_t arguments = 0;
+  for (; *text; ++text)
+  {
+    if (*text == '%')
+    {
+      if (text[1] == '%')
+      {
+        ++text;
+      }
+      else
+      {
+        ++arguments;
+      }
+    }
+  }
+  return arguments;
+}
+
+// arguments and escapes each end a segment, and there's always the one after the last of them
+constexpr size_t logFormatSegments(const char* text)
+{
+  size_t segments = 1;
+  for (; *text; ++text)
+  {
+    if (*text == '%')
+    {
+      ++segments;
+      if (text[1] == '%')
+      {
+        ++text;
+      }
+    }
+  }
+  return segments;
+}
+
+template<size_t Count>
+struct LogFormatSegments
+{
+  LogFormat::Segment segments[Count];
+};
+
+template<size_t Count>
+constexpr LogFormatSegments<Count> splitLogFormat(const char* text)
+{
+  LogFormatSegments<Count> result = {};
+  size_t segment = 0;
+  uint32_t begin = 0;
+  uint32_t index = 0;
+  for (; text[index]; ++index)
+  {
+    if (text[index] != '%')
+    {
+      continue;
+    }
+    // an escaped '%' stays at the end of its segment, the one escaping it starts the next
+    auto escaped = text[index + 1] == '%';
+    result.segments[segment++] = { begin, index - begin + (escaped ? 1 : 0), !escaped };
+    if (escaped)
+    {
+      ++index;
+    }
+    begin = index + 1;
+  }
+  result.segments[segment] = { begin, index - begin, false };
+  return result;
+}
+
+// the split of Text::get(), made once per format, in static storage
+template<typename Text>
+struct StaticLogFormat
+{
+  static constexpr auto segments = splitLogFormat<logFormatSegments(Text::get())>(Text::get());
+  static constexpr LogFormat format = {
+    Text::get(),
+    segments.segments,
+    static_cast<uint32_t>(logFormatSegments(Text::get())),
+    static_cast<uint32_t>(logFormatArguments(Text::get())),
+  };
+};
+
+// a value of a type of its own for the string literal, which is how it gets to be split by StaticLogFormat
+#define LOG_FORMAT(literal)                                                                                    \
+  ([]()                                                                                                        \
+  {                                                                                                            \
+    struct Text                                                                                                \
+    {                                                                                                          \
+      static constexpr const char* get()                                                                       \
+      {                                                                                                        \
+        return literal;                                                                                        \
+      }                                                                                                        \
+    };                                                                                                         \
+    return Text();                                                                                             \
+  }())
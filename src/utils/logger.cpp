@@ -0,0 +1,337 @@
+#include "logger.h"
+
+#include <chrono>
+#include <utility>
+
+#include "debugout.h"
+
+namespace {
+  // the longest a line waits for the logger's thread when nothing wakes it; flush() and a ring filling up do
+  const auto PollInterval = std::chrono::milliseconds(100);
+
+  class DebugOutputSink : public LogSink
+  {
+  public:
+    void write(LogLevel level, const std::string& line) override
+    {
+      (void)level;
+      debugOutput(line.c_str());
+    }
+  };
+}
+
+std::atomic<LogLevel> Logger::s_level{ LogLevel::Debug };
+std::atomic<bool> Logger::s_destroyed{ false };
+
+Logger& Logger::instance()
+{
+  static Logger s_logger;
+  return s_logger;
+}
+
+Logger::Logger()
+{
+  m_sinks.push_back(std::make_unique<DebugOutputSink>());
+  m_thread = std::thread(&Logger::run, this);
+}
+
+Logger::~Logger()
+{
+  // whatever logs from here on, other statics going away, writes on the spot
+  s_destroyed.store(true, std::memory_order_relaxed);
+  {
+    std::lock_guard<std::mutex> lock(m_wakeMutex);
+    m_quit = true;
+  }
+  m_wake.notify_one();
+  m_thread.join();
+}
+
+void Logger::addSink(std::unique_ptr<LogSink> sink)
+{
+  std::lock_guard<std::mutex> lock(m_sinksMutex);
+  m_sinks.push_back(std::move(sink));
+}
+
+std::vector<std::unique_ptr<LogSink>> Logger::replaceSinks(std::vector<std::unique_ptr<LogSink>> sinks)
+{
+  std::lock_guard<std::mutex> lock(m_sinksMutex);
+  std::swap(sinks, m_sinks);
+  return sinks;
+}
+
+void Logger::flush()
+{
+  if (std::this_thread::get_id() == m_thread.get_id())
+  {
+    return;
+  }
+
+  std::vector<std::pair<const Ring*, uint64_t>> written;
+  {
+    std::lock_guard<std::mutex> lock(m_ringsMutex);
+    for (const auto& ring : m_rings)
+    {
+      written.emplace_back(ring.get(), ring->head.load(std::memory_order_acquire));
+    }
+  }
+
+  std::unique_lock<std::mutex> lock(m_wakeMutex);
+  m_wake.notify_one();
+  m_drained.wait(lock, [&written]()
+  {
+    for (const auto& ring : written)
+    {
+      if (ring.first->tail.load(std::memory_order_acquire) < ring.second)
+      {
+        return false;
+      }
+    }
+    return true;
+  });
+}
+
+size_t Logger::dropped()
+{
+  std::lock_guard<std::mutex> lock(m_ringsMutex);
+  uint64_t dropped = 0;
+  for (const auto& ring : m_rings)
+  {
+    dropped += ring->dropped.load(std::memory_order_relaxed);
+  }
+  return static_cast<size_t>(dropped);
+}
+
+void Logger::writeNow(const char* record)
+{
+  std::ostringstream text;
+  format(record, text);
+  debugOutput(text.str().c_str());
+}
+
+Logger::Ring* Logger::threadRing()
+{
+  // the ring goes back when the thread ends; the logger's thread drains it before handing it on
+  struct Slot
+  {
+    Ring* ring = nullptr;
+
+    ~Slot()
+    {
+      if (ring)
+      {
+        ring->owned.store(false, std::memory_order_release);
+      }
+    }
+  };
+  thread_local Slot t_slot;
+
+  if (!t_slot.ring)
+  {
+    t_slot.ring = takeRing();
+  }
+  return t_slot.ring;
+}
+
+Logger::Ring* Logger::takeRing()
+{
+  std::lock_guard<std::mutex> lock(m_ringsMutex);
+  for (auto& ring : m_rings)
+  {
+    bool owned = false;
+    if (ring->tail.load(std::memory_order_acquire) == ring->head.load(std::memory_order_acquire) &&
+        ring->owned.compare_exchange_strong(owned, true, std::memory_order_acquire))
+    {
+      return ring.get();
+    }
+  }
+  m_rings.push_back(std::make_unique<Ring>());
+  return m_rings.back().get();
+}
+
+void Logger::run()
+{
+  std::unique_lock<std::mutex> lock(m_wakeMutex);
+  while (!m_quit)
+  {
+    m_wake.wait_for(lock, PollInterval);
+    lock.unlock();
+    drain();
+    lock.lock();
+    m_drained.notify_all();
+  }
+  lock.unlock();
+  drain();
+}
+
+bool Logger::drain()
+{
+  std::lock_guard<std::mutex> sinksLock(m_sinksMutex);
+
+  // rings are only ever added, and live as long as the logger; the list is copied so that threads taking a ring
+  // don't wait for the sinks
+  {
+    std::lock_guard<std::mutex> ringsLock(m_ringsMutex);
+    m_draining.clear();
+    for (const auto& ring : m_rings)
+    {
+      m_draining.push_back(ring.get());
+    }
+  }
+
+  // tails only move once the lines are flushed, so that flush() returning means they are out
+  m_heads.resize(m_draining.size());
+  bool drained = false;
+  uint64_t dropped = 0;
+  for (size_t index = 0; index < m_draining.size(); ++index)
+  {
+    auto& ring = *m_draining[index];
+    auto tail = ring.tail.load(std::memory_order_relaxed);
+    auto head = ring.head.load(std::memory_order_acquire);
+    m_heads[index] = head;
+    dropped += ring.dropped.load(std::memory_order_relaxed);
+    while (tail != head)
+    {
+      auto record = ring.bytes.get() + tail % RingBytes;
+      Header header;
+      memcpy(&header, record, sizeof(header));
+      if (header.format)
+      {
+        m_text.str(std::string());
+        format(record, m_text);
+        m_line = m_text.str();
+        for (auto& sink : m_sinks)
+        {
+          sink->write(header.level, m_line);
+        }
+      }
+      tail += header.size;
+      drained = true;
+    }
+  }
+
+  if (dropped > m_reportedDrops)
+  {
+    m_text.str(std::string());
+    m_text << ">>> Logger: " << dropped - m_reportedDrops << " messages dropped, the rings were full\n";
+    m_line = m_text.str();
+    for (auto& sink : m_sinks)
+    {
+      sink->write(LogLevel::Warning, m_line);
+    }
+    m_reportedDrops = dropped;
+    drained = true;
+  }
+
+  if (drained)
+  {
+    for (auto& sink : m_sinks)
+    {
+      sink->flush();
+    }
+  }
+  for (size_t index = 0; index < m_draining.size(); ++index)
+  {
+    m_draining[index]->tail.store(m_heads[index], std::memory_order_release);
+  }
+  return drained;
+}
+
+void Logger::format(const char* record, std::ostringstream& text)
+{
+  Header header;
+  memcpy(&header, record, sizeof(header));
+  auto cursor = record + sizeof(header);
+
+  // the segments were split when compiling, and there is an argument for every one that wants one
+  const auto& format = *header.format;
+  for (uint32_t index = 0; index < format.segmentCount; ++index)
+  {
+    const auto& segment = format.segments[index];
+    text.write(format.text + segment.begin, segment.length);
+    if (!segment.argument)
+    {
+      continue;
+    }
+
+    auto type = static_cast<Type>(*cursor++);
+    if (type == Type::String)
+    {
+      uint32_t length;
+      memcpy(&length, cursor, sizeof(length));
+      text.write(cursor + sizeof(length), length);
+      cursor += sizeof(length) + length;
+      continue;
+    }
+
+    uint64_t bits;
+    memcpy(&bits, cursor, sizeof(bits));
+    cursor += sizeof(bits);
+    switch (type)
+    {
+    case Type::Int:
+      text << static_cast<int64_t>(bits);
+      break;
+    case Type::UInt:
+      text << bits;
+      break;
+    case Type::Double:
+    {
+      double value;
+      memcpy(&value, &bits, sizeof(value));
+      text << value;
+      break;
+    }
+    case Type::Char:
+      text << static_cast<char>(bits);
+      break;
+    case Type::Pointer:
+      text << reinterpret_cast<const void*>(static_cast<uintptr_t>(bits));
+      break;
+    default:
+      break;
+    }
+  }
+  text << '\n';
+}
+
+void ConsoleLogSink::write(LogLevel level, const std::string& line)
+{
+  fwrite(line.data(), 1, line.size(), level == LogLevel::Error ? stderr : stdout);
+}
+
+void ConsoleLogSink::flush()
+{
+  fflush(stdout);
+}
+
+std::unique_ptr<FileLogSink> FileLogSink::createUnique(const std::string& path)
+{
+  auto file = fopen(path.c_str(), "w");
+  if (!file)
+  {
+    return std::unique_ptr<FileLogSink>();
+  }
+  auto sink = std::make_unique<FileLogSink>();
+  sink->m_file = file;
+  return sink;
+}
+
+FileLogSink::~FileLogSink()
+{
+  if (m_file)
+  {
+    fclose(m_file);
+  }
+}
+
+void FileLogSink::write(LogLevel level, const std::string& line)
+{
+  (void)level;
+  fwrite(line.data(), 1, line.size(), m_file);
+}
+
+void FileLogSink::flush()
+{
+  fflush(m_file);
+}
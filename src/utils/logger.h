@@ -0,0 +1,368 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "logformat.h"
+
+enum class LogLevel : uint8_t
+{
+  Debug,
+  Info,
+  Warning,
+  Error,
+};
+
+// Where the logger's thread sends the lines it formats, one call per line, '\n' included
+class LogSink
+{
+public:
+  virtual ~LogSink() = default;
+
+  virtual void write(LogLevel level, const std::string& line) = 0;
+
+  // after every batch of lines
+  virtual void flush()
+  {
+  }
+};
+
+// Logging that neither formats nor writes on the calling thread. A call copies the format string's pointer and
+// its arguments, raw, into a ring of the calling thread's own, with no lock; the logger's thread formats them,
+// each '%' replaced by the next argument, and hands the lines to the sinks. A ring that is full drops the
+// message, counted, instead of waiting. Formats are split at compile time (LogFormat) and kept by pointer; string
+// arguments are copied, up to MaxStringBytes.
+class Logger
+{
+public:
+  static const size_t RingBytes = 1 << 16;     // per thread
+  static const size_t MaxStringBytes = 4096;   // of a string argument, the rest is cut
+
+  static Logger& instance();
+
+  ~Logger();
+
+  // messages below level are dropped by the call itself; Debug by default
+  static void setLevel(LogLevel level)
+  {
+    s_level.store(level, std::memory_order_relaxed);
+  }
+
+  static LogLevel level()
+  {
+    return s_level.load(std::memory_order_relaxed);
+  }
+
+  // once the logger is gone, during static destruction, messages are formatted and written on the spot to the
+  // debugger's output window or stderr
+  template<typename... Args>
+  static void log(LogLevel level, const LogFormat& format, const Args&... args)
+  {
+    if (level < s_level.load(std::memory_order_relaxed))
+    {
+      return;
+    }
+    if (s_destroyed.load(std::memory_order_relaxed))
+    {
+      writeNow(level, &format, prepare(args)...);
+      return;
+    }
+    instance().write(level, &format, prepare(args)...);
+  }
+
+  // the debugger's output window on Windows, stderr elsewhere, is there from the start
+  void addSink(std::unique_ptr<LogSink> sink);
+
+  // the sinks in place of the current ones, which are returned
+  std::vector<std::unique_ptr<LogSink>> replaceSinks(std::vector<std::unique_ptr<LogSink>> sinks);
+
+  // waits until everything logged before the call has reached the sinks
+  void flush();
+
+  // messages lost to full rings so far
+  size_t dropped();
+
+protected:
+  enum class Type : uint8_t
+  {
+    Int,
+    UInt,
+    Double,
+    Char,
+    Pointer,
+    String,
+  };
+
+  // a message in a ring; records are padded to its size, and one with no format pads the ring's end
+  struct Header
+  {
+    const LogFormat* format;
+    uint32_t size;
+    LogLevel level;
+    uint8_t reserved[3];
+  };
+  static_assert(sizeof(Header) == 16, "records are laid out in 16 byte steps");
+
+  struct alignas(64) Ring
+  {
+    std::unique_ptr<char[]> bytes{ new char[RingBytes] };
+    std::atomic<uint64_t> head{ 0 };   // written up to, by its thread
+    std::atomic<uint64_t> tail{ 0 };   // read up to, by the logger's
+    std::atomic<uint64_t> dropped{ 0 };
+    std::atomic<bool> owned{ true };   // a thread writes to it; one that's left is given to the next new thread
+  };
+
+  Logger();
+
+  template<typename T>
+  using Decayed = typename std::decay<T>::type;
+
+  // char pointers print as the strings they point to, as they do on streams
+  template<typename T>
+  static constexpr bool isString()
+  {
+    using Pointer = typename std::remove_cv<typename std::remove_pointer<Decayed<T>>::type>::type;
+    return std::is_pointer<Decayed<T>>::value && (std::is_same<Pointer, char>::value || std::is_same<Pointer, signed char>::value || std::is_same<Pointer, unsigned char>::value);
+  }
+
+  // what the logger's thread prints the way debugLog always did; anything else is formatted here, on the calling
+  // thread, and copied as a string
+  template<typename T>
+  static constexpr bool raw()
+  {
+    return std::is_arithmetic<Decayed<T>>::value || std::is_enum<Decayed<T>>::value || std::is_pointer<Decayed<T>>::value || std::is_same<Decayed<T>, std::string>::value;
+  }
+
+  template<typename T>
+  static decltype(auto) prepare(const T& value)
+  {
+    if constexpr (raw<T>())
+    {
+      return (value);
+    }
+    else
+    {
+      std::ostringstream text;
+      text << value;
+      return text.str();
+    }
+  }
+
+  template<typename T>
+  static const char* asText(const T& value)
+  {
+    return reinterpret_cast<const char*>(static_cast<const typename std::remove_pointer<Decayed<T>>::type*>(value));
+  }
+
+  static size_t clampedLength(size_t length)
+  {
+    return length < MaxStringBytes ? length : MaxStringBytes;
+  }
+
+  template<typename T>
+  static size_t encodedSize(const T& value)
+  {
+    if constexpr (std::is_same<Decayed<T>, std::string>::value)
+    {
+      return 1 + sizeof(uint32_t) + clampedLength(value.size());
+    }
+    else if constexpr (isString<T>())
+    {
+      auto text = asText(value);
+      return 1 + sizeof(uint32_t) + (text ? clampedLength(strlen(text)) : 6);
+    }
+    else
+    {
+      return 1 + sizeof(uint64_t);
+    }
+  }
+
+  static void encodeString(char*& cursor, const char* text, size_t length)
+  {
+    *cursor++ = static_cast<char>(Type::String);
+    auto length32 = static_cast<uint32_t>(length);
+    memcpy(cursor, &length32, sizeof(length32));
+    memcpy(cursor + sizeof(length32), text, length);
+    cursor += sizeof(length32) + length;
+  }
+
+  template<typename Value>
+  static void encodeValue(char*& cursor, Type type, Value value)
+  {
+    static_assert(sizeof(Value) == sizeof(uint64_t), "arguments are stored in 8 bytes");
+    *cursor++ = static_cast<char>(type);
+    memcpy(cursor, &value, sizeof(value));
+    cursor += sizeof(value);
+  }
+
+  template<typename T>
+  static void encode(char*& cursor, const T& value)
+  {
+    if constexpr (std::is_same<Decayed<T>, std::string>::value)
+    {
+      encodeString(cursor, value.data(), clampedLength(value.size()));
+    }
+    else if constexpr (isString<T>())
+    {
+      auto text = asText(value);
+      encodeString(cursor, text ? text : "(null)", text ? clampedLength(strlen(text)) : 6);
+    }
+    else if constexpr (std::is_pointer<Decayed<T>>::value)
+    {
+      encodeValue(cursor, Type::Pointer, static_cast<uint64_t>(reinterpret_cast<uintptr_t>(value)));
+    }
+    else if constexpr (std::is_enum<Decayed<T>>::value)
+    {
+      encode(cursor, static_cast<typename std::underlying_type<Decayed<T>>::type>(value));
+    }
+    else if constexpr (std::is_floating_point<Decayed<T>>::value)
+    {
+      encodeValue(cursor, Type::Double, static_cast<double>(value));
+    }
+    else if constexpr (std::is_same<Decayed<T>, char>::value || std::is_same<Decayed<T>, signed char>::value || std::is_same<Decayed<T>, unsigned char>::value)
+    {
+      encodeValue(cursor, Type::Char, static_cast<uint64_t>(static_cast<unsigned char>(value)));
+    }
+    else if constexpr (std::is_signed<Decayed<T>>::value)
+    {
+      encodeValue(cursor, Type::Int, static_cast<int64_t>(value));
+    }
+    else
+    {
+      encodeValue(cursor, Type::UInt, static_cast<uint64_t>(value));
+    }
+  }
+
+  template<typename... Args>
+  static size_t recordSize(const Args&... args)
+  {
+    return (sizeof(Header) + (size_t(0) + ... + encodedSize(args)) + 15) & ~size_t(15);
+  }
+
+  template<typename... Args>
+  static void encodeRecord(char* target, size_t size, LogLevel level, const LogFormat* format, const Args&... args)
+  {
+    Header header = { format, static_cast<uint32_t>(size), level, {} };
+    memcpy(target, &header, sizeof(header));
+    target += sizeof(header);
+    (encode(target, args), ...);
+  }
+
+  template<typename... Args>
+  void write(LogLevel level, const LogFormat* format, const Args&... args)
+  {
+    auto size = recordSize(args...);
+    auto ring = threadRing();
+    if (size > RingBytes / 4)
+    {
+      ring->dropped.store(ring->dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      return;
+    }
+
+    // only this thread moves head and the logger's only ever frees more room behind it
+    auto head = ring->head.load(std::memory_order_relaxed);
+    auto offset = static_cast<size_t>(head % RingBytes);
+    auto contiguous = RingBytes - offset;
+    auto needed = contiguous < size ? contiguous + size : size;
+    if (RingBytes - static_cast<size_t>(head - ring->tail.load(std::memory_order_acquire)) < needed)
+    {
+      ring->dropped.store(ring->dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      return;
+    }
+    if (contiguous < size)
+    {
+      Header padding = { nullptr, static_cast<uint32_t>(contiguous), level, {} };
+      memcpy(ring->bytes.get() + offset, &padding, sizeof(padding));
+      head += contiguous;
+      offset = 0;
+    }
+    encodeRecord(ring->bytes.get() + offset, size, level, format, args...);
+    ring->head.store(head + size, std::memory_order_release);
+
+    // the logger's thread polls; a ring filling up faster than that wakes it
+    if (head + size - ring->tail.load(std::memory_order_relaxed) > RingBytes / 2)
+    {
+      m_wake.notify_one();
+    }
+  }
+
+  template<typename... Args>
+  static void writeNow(LogLevel level, const LogFormat* format, const Args&... args)
+  {
+    auto size = recordSize(args...);
+    std::unique_ptr<char[]> record(new char[size]);
+    encodeRecord(record.get(), size, level, format, args...);
+    writeNow(record.get());
+  }
+
+  static void writeNow(const char* record);
+
+  // the calling thread's ring, taken on its first message
+  Ring* threadRing();
+  Ring* takeRing();
+
+  void run();
+
+  // formats everything written so far, hands it to the sinks and flushes them; false when there was nothing
+  bool drain();
+
+  // the record as a line, '\n' included
+  static void format(const char* record, std::ostringstream& text);
+
+  static std::atomic<LogLevel> s_level;
+  static std::atomic<bool> s_destroyed;
+
+  std::mutex m_ringsMutex;
+  std::vector<std::unique_ptr<Ring>> m_rings;
+
+  std::mutex m_sinksMutex;   // held by the logger's thread while it drains
+  std::vector<std::unique_ptr<LogSink>> m_sinks;
+  uint64_t m_reportedDrops = 0;
+  std::ostringstream m_text;
+  std::string m_line;
+  std::vector<Ring*> m_draining;
+  std::vector<uint64_t> m_heads;
+
+  std::mutex m_wakeMutex;
+  std::condition_variable m_wake;
+  std::condition_variable m_drained;
+  bool m_quit = false;
+  std::thread m_thread;
+};
+
+// Lines to the console: stdout, errors to stderr
+class ConsoleLogSink : public LogSink
+{
+public:
+  void write(LogLevel level, const std::string& line) override;
+
+  void flush() override;
+};
+
+// Lines to a file, created or truncated
+class FileLogSink : public LogSink
+{
+public:
+  // nullptr if the file can't be opened
+  static std::unique_ptr<FileLogSink> createUnique(const std::string& path);
+
+  ~FileLogSink();
+
+  void write(LogLevel level, const std::string& line) override;
+
+  void flush() override;
+
+protected:
+  FILE* m_file = nullptr;
+};
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+// Where a set of timings sits beyond its average: the median and the slow tail
+struct Percentiles
+{
+  double p50 = 0.0;
+  double p95 = 0.0;
+  double p99 = 0.0;
+  double mean = 0.0;
+
+  // nearest rank: the smallest sample that fraction of them are at or below
+  static Percentiles of(std::vector<double> samples)
+  {
+    Percentiles percentiles;
+    if (samples.empty())
+    {
+      return percentiles;
+    }
+    std::sort(samples.begin(), samples.end());
+    auto rank = [&samples](double fraction)
+    {
+      auto index = static_cast<size_t>(std::ceil(fraction * static_cast<double>(samples.size())));
+      return samples[index ? index - 1 : 0];
+    };
+    percentiles.p50 = rank(0.50);
+    percentiles.p95 = rank(0.95);
+    percentiles.p99 = rank(0.99);
+    double sum = 0.0;
+    for (auto sample : samples)
+    {
+      sum += sample;
+    }
+    percentiles.mean = sum / static_cast<double>(samples.size());
+    return percentiles;
+  }
+};
@@ -0,0 +1,264 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "debugout.h"
+
+namespace {
+  struct ThreadBuffer
+  {
+    std::unique_ptr<Profiler::Event[]> events{ new Profiler::Event[Profiler::EventsPerThread] };
+    std::atomic<uint64_t> written{ 0 };
+    uint64_t folded = 0;                 // by frame()
+    std::atomic<bool> inUse{ true };
+  };
+
+  using Histograms = std::unordered_map<const char*, Profiler::Histogram>;
+
+  // buffers outlive their threads and go to the next new one, so threads that come and go, the job systems the
+  // benchmarks make, don't add up
+  struct State
+  {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    std::map<uint32_t, const char*> threadNames;
+    std::atomic<uint32_t> threads{ 0 };
+
+    Histograms current;
+    Histograms previous;
+    size_t frames = 0;
+  };
+
+  State& state()
+  {
+    static State s_state;
+    return s_state;
+  }
+
+  struct ThreadSlot
+  {
+    ThreadBuffer* buffer = nullptr;
+    uint32_t thread = state().threads++;
+
+    ~ThreadSlot()
+    {
+      if (buffer)
+      {
+        buffer->inUse.store(false, std::memory_order_release);
+      }
+    }
+  };
+
+  thread_local ThreadSlot t_slot;
+
+  ThreadBuffer* takeBuffer()
+  {
+    auto& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    for (auto& buffer : s.buffers)
+    {
+      bool idle = false;
+      if (buffer->inUse.compare_exchange_strong(idle, true, std::memory_order_acquire))
+      {
+        return buffer.get();
+      }
+    }
+    s.buffers.push_back(std::make_unique<ThreadBuffer>());
+    return s.buffers.back().get();
+  }
+
+  double toMilliseconds(uint64_t nanoseconds)
+  {
+    return static_cast<double>(nanoseconds) / 1000000.0;
+  }
+
+  void writeEscaped(FILE* file, const char* text)
+  {
+    for (; *text; ++text)
+    {
+      if (*text == '"' || *text == '\\')
+      {
+        fputc('\\', file);
+      }
+      fputc(*text, file);
+    }
+  }
+}
+
+void Profiler::Histogram::add(uint64_t nanoseconds)
+{
+  size_t bucket = 0;
+  for (auto microseconds = nanoseconds / 2000; microseconds && bucket + 1 < HistogramBuckets; microseconds >>= 1)
+  {
+    ++bucket;
+  }
+  ++counts[bucket];
+  ++count;
+  totalNanoseconds += nanoseconds;
+  maxNanoseconds = std::max(maxNanoseconds, nanoseconds);
+}
+
+void Profiler::Histogram::merge(const Histogram& other)
+{
+  for (size_t bucket = 0; bucket < HistogramBuckets; ++bucket)
+  {
+    counts[bucket] += other.counts[bucket];
+  }
+  count += other.count;
+  totalNanoseconds += other.totalNanoseconds;
+  maxNanoseconds = std::max(maxNanoseconds, other.maxNanoseconds);
+}
+
+double Profiler::Histogram::percentile(double fraction) const
+{
+  size_t below = 0;
+  for (size_t bucket = 0; bucket < HistogramBuckets; ++bucket)
+  {
+    below += counts[bucket];
+    if (static_cast<double>(below) >= fraction * static_cast<double>(count))
+    {
+      // no more than the longest one seen, the bound of the last, open ended, bucket too
+      auto bound = static_cast<double>(uint64_t(2) << bucket) / 1000.0;
+      return bucket + 1 < HistogramBuckets ? std::min(bound, toMilliseconds(maxNanoseconds)) : toMilliseconds(maxNanoseconds);
+    }
+  }
+  return toMilliseconds(maxNanoseconds);
+}
+
+uint64_t Profiler::now()
+{
+  using Clock = std::chrono::steady_clock;
+  static const auto s_epoch = Clock::now();
+  return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - s_epoch).count());
+}
+
+void Profiler::record(const char* name, uint64_t begin, uint64_t end)
+{
+  record(name, begin, end, t_slot.thread);
+}
+
+void Profiler::record(const char* name, uint64_t begin, uint64_t end, uint32_t lane)
+{
+  auto& slot = t_slot;
+  if (!slot.buffer)
+  {
+    slot.buffer = takeBuffer();
+  }
+  // only this thread writes the buffer; the release publishes the event to frame() and writeTrace()
+  auto index = slot.buffer->written.load(std::memory_order_relaxed);
+  slot.buffer->events[index % EventsPerThread] = { name, begin, end, lane };
+  slot.buffer->written.store(index + 1, std::memory_order_release);
+}
+
+void Profiler::nameThread(const char* name)
+{
+  auto& s = state();
+  std::lock_guard<std::mutex> lock(s.mutex);
+  s.threadNames[t_slot.thread] = name;
+}
+
+uint32_t Profiler::lane(const char* name)
+{
+  auto& s = state();
+  auto lane = s.threads++;
+  std::lock_guard<std::mutex> lock(s.mutex);
+  s.threadNames[lane] = name;
+  return lane;
+}
+
+void Profiler::frame()
+{
+  auto& s = state();
+  std::lock_guard<std::mutex> lock(s.mutex);
+  for (auto& buffer : s.buffers)
+  {
+    auto written = buffer->written.load(std::memory_order_acquire);
+    // whatever a thread managed to overwrite since the last frame is lost to the histograms
+    auto first = std::max(buffer->folded, written > EventsPerThread ? written - EventsPerThread : 0);
+    for (auto index = first; index < written; ++index)
+    {
+      const auto& event = buffer->events[index % EventsPerThread];
+      s.current[event.name].add(event.end - event.begin);
+    }
+    buffer->folded = written;
+  }
+
+  if (++s.frames == HistogramFrames)
+  {
+    s.previous = std::move(s.current);
+    s.current.clear();
+    s.frames = 0;
+  }
+}
+
+void Profiler::logHistograms()
+{
+  auto& s = state();
+  std::map<std::string, Histogram> scopes;
+  {
+    std::lock_guard<std::mutex> lock(s.mutex);
+    // the same name may come from literals at different addresses
+    for (auto histograms : { &s.previous, &s.current })
+    {
+      for (const auto& scope : *histograms)
+      {
+        scopes[scope.first].merge(scope.second);
+      }
+    }
+  }
+
+  std::vector<std::pair<std::string, Histogram>> sorted(scopes.begin(), scopes.end());
+  std::sort(sorted.begin(), sorted.end(), [](const std::pair<std::string, Histogram>& a, const std::pair<std::string, Histogram>& b)
+  {
+    return a.second.totalNanoseconds > b.second.totalNanoseconds;
+  });
+  for (const auto& scope : sorted)
+  {
+    const auto& histogram = scope.second;
+    debugLog("Profile %: % calls, mean % ms, p50 < % ms, p95 < % ms, p99 < % ms, max % ms", scope.first, histogram.count, toMilliseconds(histogram.totalNanoseconds) / static_cast<double>(std::max<size_t>(histogram.count, 1)), histogram.percentile(0.50), histogram.percentile(0.95), histogram.percentile(0.99), toMilliseconds(histogram.maxNanoseconds));
+  }
+}
+
+bool Profiler::writeTrace(const std::string& path)
+{
+  auto file = fopen(path.c_str(), "w");
+  if (!file)
+  {
+    return false;
+  }
+
+  auto& s = state();
+  std::lock_guard<std::mutex> lock(s.mutex);
+  fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", file);
+  bool first = true;
+  for (const auto& thread : s.threadNames)
+  {
+    fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"", first ? "" : ",\n", thread.first);
+    writeEscaped(file, thread.second);
+    fputs("\"}}", file);
+    first = false;
+  }
+  for (const auto& buffer : s.buffers)
+  {
+    auto written = buffer->written.load(std::memory_order_acquire);
+    for (auto index = written > EventsPerThread ? written - EventsPerThread : 0; index < written; ++index)
+    {
+      const auto& event = buffer->events[index % EventsPerThread];
+      // complete events, microseconds
+      fprintf(file, "%s{\"name\":\"", first ? "" : ",\n");
+      writeEscaped(file, event.name);
+      fprintf(file, "\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", event.thread, static_cast<double>(event.begin) / 1000.0, static_cast<double>(event.end - event.begin) / 1000.0);
+      first = false;
+    }
+  }
+  fputs("\n]}\n", file);
+  return fclose(file) == 0;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Scopes timed from any thread: PROFILE_SCOPE("name") times the rest of the enclosing block. Each thread appends
+// to a ring of its own, with no lock and no allocation after its first scope; once a frame, frame() folds what's
+// new into a histogram per scope, and writeTrace() saves what the rings still hold for chrome://tracing or
+// Perfetto. Without ENABLE_PROFILING the macros are empty and the scopes cost nothing.
+#ifdef ENABLE_PROFILING
+#define PROFILE_CONCATENATE_(a, b) a##b
+#define PROFILE_CONCATENATE(a, b) PROFILE_CONCATENATE_(a, b)
+#define PROFILE_SCOPE(name) Profiler::Scope PROFILE_CONCATENATE(profileScope, __LINE__)(name)
+#define PROFILE_THREAD(name) Profiler::nameThread(name)
+#else
+#define PROFILE_SCOPE(name)
+#define PROFILE_THREAD(name)
+#endif
+
+class Profiler
+{
+public:
+  static const size_t EventsPerThread = 1 << 16;
+  static const size_t HistogramBuckets = 24;   // powers of two microseconds, the last one holds anything longer
+  static const size_t HistogramFrames = 600;   // the histograms cover the last this to twice this many frames
+
+  struct Event
+  {
+    const char* name;   // a string literal, only the pointer is kept
+    uint64_t begin;     // nanoseconds since the first now()
+    uint64_t end;
+    uint32_t thread;
+  };
+
+  // durations by power of two, bucket i up to 2^(i + 1) microseconds
+  struct Histogram
+  {
+    size_t counts[HistogramBuckets] = {};
+    size_t count = 0;
+    uint64_t totalNanoseconds = 0;
+    uint64_t maxNanoseconds = 0;
+
+    void add(uint64_t nanoseconds);
+    void merge(const Histogram& other);
+
+    // an upper bound of the fraction percentile, in milliseconds
+    double percentile(double fraction) const;
+  };
+
+  class Scope
+  {
+  public:
+    explicit Scope(const char* name) :
+      m_name(name),
+      m_begin(now())
+    {
+    }
+
+    ~Scope()
+    {
+      record(m_name, m_begin, now());
+    }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+  protected:
+    const char* m_name;
+    uint64_t m_begin;
+  };
+
+  static constexpr bool enabled()
+  {
+#ifdef ENABLE_PROFILING
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  static uint64_t now();
+
+  static void record(const char* name, uint64_t begin, uint64_t end);
+
+  // as if another thread had recorded it, lane() says which; for timelines that aren't threads, the GPU's
+  static void record(const char* name, uint64_t begin, uint64_t end, uint32_t lane);
+
+  // how the calling thread shows in the trace; name has to outlive the profiler, a literal
+  static void nameThread(const char* name);
+
+  // a timeline of its own, named name in the trace, to record() on
+  static uint32_t lane(const char* name);
+
+  // folds the events recorded since the last call into the histograms; from one thread, once a frame
+  static void frame();
+
+  // a line per scope through debugLog, slowest first
+  static void logHistograms();
+
+  // the last EventsPerThread events of every thread as Chrome trace_event JSON; the threads should be idle, or the
+  // oldest events of a busy one may be half overwritten
+  static bool writeTrace(const std::string& path);
+};
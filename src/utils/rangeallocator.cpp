@@ -0,0 +1,117 @@
+#include "rangeallocator.h"
+
+#include <iterator>
+
+size_t RangeAllocator::allocate(size_t size)
+{
+  if (!size)
+  {
+    return InvalidOffset;
+  }
+
+  auto best = m_freeBySize.lower_bound(size);
+  if (best == m_freeBySize.end())
+  {
+    return InvalidOffset;
+  }
+
+  auto offset = best->second;
+  auto blockSize = best->first;
+  eraseFree(m_freeByOffset.find(offset));
+  if (blockSize > size)
+  {
+    insertFree(offset + size, blockSize - size);
+  }
+
+  m_used += size;
+  ++m_allocations;
+  return offset;
+}
+
+void RangeAllocator::free(size_t offset, size_t size)
+{
+  if (offset == InvalidOffset || !size)
+  {
+    return;
+  }
+
+  m_used -= size;
+  --m_allocations;
+
+  // merge with the free neighbours on both sides
+  auto next = m_freeByOffset.lower_bound(offset);
+  if (next != m_freeByOffset.begin())
+  {
+    auto previous = std::prev(next);
+    if (previous->first + previous->second == offset)
+    {
+      offset = previous->first;
+      size += previous->second;
+      eraseFree(previous);
+    }
+  }
+  if (next != m_freeByOffset.end() && offset + size == next->first)
+  {
+    size += next->second;
+    eraseFree(next);
+  }
+
+  insertFree(offset, size);
+}
+
+void RangeAllocator::grow(size_t newCapacity)
+{
+  if (newCapacity <= m_capacity)
+  {
+    return;
+  }
+
+  auto offset = m_capacity;
+  auto size = newCapacity - m_capacity;
+  m_capacity = newCapacity;
+
+  // extend a free block that ends at the old capacity
+  if (!m_freeByOffset.empty())
+  {
+    auto last = std::prev(m_freeByOffset.end());
+    if (last->first + last->second == offset)
+    {
+      offset = last->first;
+      size += last->second;
+      eraseFree(last);
+    }
+  }
+  insertFree(offset, size);
+}
+
+void RangeAllocator::reset(size_t used, size_t allocations)
+{
+  m_freeByOffset.clear();
+  m_freeBySize.clear();
+  m_used = used;
+  m_allocations = allocations;
+  if (m_capacity > used)
+  {
+    insertFree(used, m_capacity - used);
+  }
+}
+
+void RangeAllocator::insertFree(size_t offset, size_t size)
+{
+  m_freeByOffset[offset] = size;
+  m_freeBySize.insert({ size, offset });
+}
+
+void RangeAllocator::eraseFree(std::map<size_t, size_t>::iterator block)
+{
+  auto sized = m_freeBySize.equal_range(block->second);
+  for (auto it = sized.first; it != sized.second; ++it)
+  {
+    if (it->second == block->first)
+    {
+      m_freeBySize.erase(it);
+      break;
+    }
+  }
+  m_freeByOffset.erase(block);
+}
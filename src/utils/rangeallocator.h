@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+
+// Hands out [offset, offset + size) ranges of a linear address space; best fit over a free list kept sorted both
+// by offset (to coalesce neighbours on free) and by size (to find the best fit in log time). Knows nothing about
+// what the space holds: units are whatever the owner counts in.
+class RangeAllocator
+{
+public:
+  static const size_t InvalidOffset = ~static_cast<size_t>(0);
+
+  explicit RangeAllocator(size_t capacity = 0)
+  {
+    m_capacity = 0;
+    m_used = 0;
+    m_allocations = 0;
+    grow(capacity);
+  }
+
+  // InvalidOffset if no free range is large enough
+  size_t allocate(size_t size);
+
+  void free(size_t offset, size_t size);
+
+  // appends [capacity, newCapacity) to the free space
+  void grow(size_t newCapacity);
+
+  // forgets every range; afterwards [0, used) is one allocated block and the rest is free. for compaction
+  void reset(size_t used, size_t allocations);
+
+  size_t capacity() const
+  {
+    return m_capacity;
+  }
+
+  size_t used() const
+  {
+    return m_used;
+  }
+
+  size_t allocations() const
+  {
+    return m_allocations;
+  }
+
+  size_t freeBlocks() const
+  {
+    return m_freeByOffset.size();
+  }
+
+  size_t largestFreeBlock() const
+  {
+    return m_freeBySize.empty() ? 0 : m_freeBySize.rbegin()->first;
+  }
+
+  // 0 when all the free space is one block, close to 1 when it is scattered in small pieces
+  float fragmentation() const
+  {
+    auto freeSpace = m_capacity - m_used;
+    return freeSpace ? 1.0f - static_cast<float>(largestFreeBlock()) / static_cast<float>(freeSpace) : 0.0f;
+  }
+
+protected:
+  void insertFree(size_t offset, size_t size);
+
+  void eraseFree(std::map<size_t, size_t>::iterator block);
+
+  std::map<size_t, size_t> m_freeByOffset;     // offset -> size
+  std::multimap<size_t, size_t> m_freeBySize;  // size -> offset
+
+  size_t m_capacity;
+  size_t m_used;
+  size_t m_allocations;
+};